@@ -0,0 +1,37 @@
+# Run a driver and compare the iteration and evaluation counts of its final
+# statistics with the recorded ones, see cg_add_check in CMakeLists.txt.
+# EXE is the driver, ARGS its arguments separated by spaces, and COUNTS
+# holds "iter nfunc ngrad" for each solve, separated by commas.
+separate_arguments (args UNIX_COMMAND "${ARGS}")
+execute_process (COMMAND ${EXE} ${args} OUTPUT_VARIABLE out RESULT_VARIABLE rc)
+if (NOT rc EQUAL 0)
+    message (FATAL_ERROR "${EXE} returned ${rc}\n${out}")
+endif ()
+
+string (REGEX MATCHALL "iterations: *[0-9]+" iter "${out}")
+string (REGEX MATCHALL "function evaluations: *[0-9]+" nfunc "${out}")
+string (REGEX MATCHALL "gradient evaluations: *[0-9]+" ngrad "${out}")
+list (LENGTH iter n)
+set (found "")
+if (n GREATER 0)
+    math (EXPR last "${n} - 1")
+    foreach (k RANGE ${last})
+        set (run "")
+        foreach (count iter nfunc ngrad)
+            list (GET ${count} ${k} c)
+            string (REGEX REPLACE "[^0-9]" "" c "${c}")
+            list (APPEND run ${c})
+        endforeach ()
+        string (REPLACE ";" " " run "${run}")
+        if (found STREQUAL "")
+            set (found "${run}")
+        else ()
+            set (found "${found},${run}")
+        endif ()
+    endforeach ()
+endif ()
+
+if (NOT found STREQUAL COUNTS)
+    message (FATAL_ERROR "counts changed\n  expected: ${COUNTS}\n  found:    ${found}\n${out}")
+endif ()
+message ("counts: ${found}")
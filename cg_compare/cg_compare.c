@@ -0,0 +1,92 @@
+/* Run the versions 1.1, 3.0, 4.0, 5.0, and 6.0 of cg_descent, each with the
+   default parameters of its version, on the test problems of
+   cg_descent_6.0/cg_test.c and report the iterations, evaluations, and wall
+   time side by side:
+
+   cg_compare [n]
+
+   n is the problem dimension (default 1000). The summary gives, for each
+   version, the number of problems solved (status 0) and the totals over
+   the problems solved by every version. Version 1.1 reads the parameter
+   file cg_compare/cg_descent.parm. */
+
+#include <math.h>
+#include <time.h>
+#include "cg_test.h"
+#include "cg_compare.h"
+
+#define NENGINE 5
+
+static double cg_wtime (void)
+{
+#ifdef CLOCK_MONOTONIC
+    struct timespec t ;
+    clock_gettime (CLOCK_MONOTONIC, &t) ;
+    return ((double) t.tv_sec + 1.e-9*t.tv_nsec) ;
+#else
+    return ((double) clock ()/CLOCKS_PER_SEC) ;
+#endif
+}
+
+int main (int argc, char **argv)
+{
+    double *x, t, time [NENGINE], total [NENGINE][4] ;
+    INT n, dim ;
+    int e, k, p, nprob, solved [NENGINE], status [NENGINE] ;
+    cg_problem *P ;
+    cg_result R [NENGINE] ;
+    char *name [NENGINE] = {"1.1", "3.0", "4.0", "5.0", "6.0"} ;
+    cg_engine_run run [NENGINE] = {cg_engine1, cg_engine3, cg_engine4,
+                                   cg_engine5, cg_engine6} ;
+
+    n = 1000 ;
+    if ( argc > 1 ) n = atol (argv [1]) ;
+    x = (double *) malloc (n*sizeof (double)) ;
+    for (e = 0; e < NENGINE; e++)
+    {
+        solved [e] = 0 ;
+        for (k = 0; k < 4; k++) total [e][k] = 0. ;
+    }
+
+    printf ("problem         n version status  iter nfunc ngrad        time"
+            "              f\n") ;
+    for (p = 0; cg_problems [p].name != NULL; p++)
+    {
+        P = cg_problems + p ;
+        dim = cg_test_dim (P, n) ;
+        for (e = 0; e < NENGINE; e++)
+        {
+            P->start (x, dim) ;
+            t = cg_wtime () ;
+            run [e] (R+e, x, dim, 1.e-6, P->value, P->grad, P->valgrad) ;
+            time [e] = cg_wtime () - t ;
+            status [e] = R [e].status ;
+            if ( status [e] == 0 ) solved [e]++ ;
+            printf ("%-10s %6ld %7s %6i %5ld %5ld %5ld %11.4e %14.6e\n",
+                    P->name, (long) dim, name [e], R [e].status, R [e].iter,
+                    R [e].nfunc, R [e].ngrad, time [e], R [e].f) ;
+        }
+        /* totals over the problems solved by every version */
+        for (e = 0; e < NENGINE; e++) if ( status [e] ) break ;
+        if ( e < NENGINE ) continue ;
+        for (e = 0; e < NENGINE; e++)
+        {
+            total [e][0] += R [e].iter ;
+            total [e][1] += R [e].nfunc ;
+            total [e][2] += R [e].ngrad ;
+            total [e][3] += time [e] ;
+        }
+    }
+    nprob = p ;
+
+    printf ("\nversion solved   iter  nfunc  ngrad        time"
+            "  (totals over problems solved by all)\n") ;
+    for (e = 0; e < NENGINE; e++)
+    {
+        printf ("%7s %3i/%-2i %6.0f %6.0f %6.0f %11.4e\n", name [e],
+                solved [e], nprob, total [e][0], total [e][1], total [e][2],
+                total [e][3]) ;
+    }
+    free (x) ;
+    return (0) ;
+}
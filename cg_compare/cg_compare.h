@@ -0,0 +1,52 @@
+/* =========================================================================
+   ============================= CG_COMPARE ================================
+   =========================================================================
+   Common interface to the versions 1.1, 3.0, 4.0, 5.0, and 6.0 of
+   cg_descent. Each version is compiled in its own adapter (cg_engine1.c,
+   ..., cg_engine6.c) with its external routines renamed, so that all the
+   versions can be linked in one program. Every adapter solves the problem
+   with the default parameters of its version (no printing) and returns
+   the statistics in a cg_result. This header does not include any
+   cg_user.h, since the versions define different parameter structures. */
+
+typedef struct cg_result_struct /* statistics of one run */
+{
+    int         status ; /* status returned by cg_descent */
+    long          iter ; /* number of iterations */
+    long         nfunc ; /* number of function evaluations */
+    long         ngrad ; /* number of gradient evaluations */
+    double           f ; /* final function value */
+    double       gnorm ; /* final gradient sup-norm */
+} cg_result ;
+
+typedef void (*cg_engine_run) /* run one version of cg_descent */
+(
+    cg_result     *R, /* statistics of the run */
+    double        *x, /* input: starting guess, output: solution */
+    long           n, /* problem dimension */
+    double  grad_tol, /* convergence tolerance */
+    double        (*value) (double *, long),  /* f = value (x, n) */
+    void           (*grad) (double *, double *, long), /* grad (g, x, n) */
+    double      (*valgrad) (double *, double *, long)  /* f = valgrad (g,x,n)*/
+) ;
+
+void cg_engine1 (cg_result *, double *, long, double,
+                 double (*) (double *, long),
+                 void (*) (double *, double *, long),
+                 double (*) (double *, double *, long)) ;
+void cg_engine3 (cg_result *, double *, long, double,
+                 double (*) (double *, long),
+                 void (*) (double *, double *, long),
+                 double (*) (double *, double *, long)) ;
+void cg_engine4 (cg_result *, double *, long, double,
+                 double (*) (double *, long),
+                 void (*) (double *, double *, long),
+                 double (*) (double *, double *, long)) ;
+void cg_engine5 (cg_result *, double *, long, double,
+                 double (*) (double *, long),
+                 void (*) (double *, double *, long),
+                 double (*) (double *, double *, long)) ;
+void cg_engine6 (cg_result *, double *, long, double,
+                 double (*) (double *, long),
+                 void (*) (double *, double *, long),
+                 double (*) (double *, double *, long)) ;
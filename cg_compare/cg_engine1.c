@@ -0,0 +1,61 @@
+/* Adapter for cg_descent 1.1 (see cg_compare.h). Version 1.1 reads its
+   parameters from the file CG_PARM_FILE (cg_compare/cg_descent.parm, which
+   has PrintFinal = 0) and its routines value (x) and grad (g, x) have no
+   dimension argument, so the problem is kept in static variables. */
+
+#define cg_descent      cg_descent_1
+#define cg_descent_init cg_descent_init_1
+#define cg_Wolfe        cg_Wolfe_1
+#define cg_tol          cg_tol_1
+#define cg_dot          cg_dot_1
+#define cg_step         cg_step_1
+#define cg_line         cg_line_1
+#define cg_lineW        cg_lineW_1
+#define cg_update       cg_update_1
+#define cg_updateW      cg_updateW_1
+#include "../cg_descent_1.1/cg_descent.c"
+#include "cg_compare.h"
+
+static long    cg_n ;
+static double (*cg_uvalue) (double *, long) ;
+static void   (*cg_ugrad) (double *, double *, long) ;
+
+static double cg_value1 (double *x)
+{
+    return (cg_uvalue (x, cg_n)) ;
+}
+
+static void cg_grad1 (double *g, double *x)
+{
+    cg_ugrad (g, x, cg_n) ;
+}
+
+void cg_engine1
+(
+    cg_result     *R,
+    double        *x,
+    long           n,
+    double  grad_tol,
+    double        (*value) (double *, long),
+    void           (*grad) (double *, double *, long),
+    double      (*valgrad) (double *, double *, long)
+)
+{
+    double *work ;
+    cg_stats Stats ;
+    (void) valgrad ; /* version 1.1 has no valgrad */
+    cg_n = n ;
+    cg_uvalue = value ;
+    cg_ugrad = grad ;
+    work = (double *) malloc (4*n*sizeof (double)) ;
+    Stats.f = Stats.gnorm = 0. ;
+    Stats.iter = Stats.nfunc = Stats.ngrad = 0 ;
+    R->status = cg_descent (grad_tol, x, (int) n, cg_value1, cg_grad1, work,
+                            0., &Stats) ;
+    free (work) ;
+    R->iter = Stats.iter ;
+    R->nfunc = Stats.nfunc ;
+    R->ngrad = Stats.ngrad ;
+    R->f = Stats.f ;
+    R->gnorm = Stats.gnorm ;
+}
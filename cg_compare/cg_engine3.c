@@ -0,0 +1,45 @@
+/* Adapter for cg_descent 3.0 (see cg_compare.h) */
+
+#define cg_descent      cg_descent_3
+#define cg_default      cg_default_3
+#define cg_printParms   cg_printParms_3
+#define cg_Wolfe        cg_Wolfe_3
+#define cg_tol          cg_tol_3
+#define cg_dot          cg_dot_3
+#define cg_copy         cg_copy_3
+#define cg_step         cg_step_3
+#define cg_f            cg_f_3
+#define cg_g            cg_g_3
+#define cg_fg           cg_fg_3
+#define cg_line         cg_line_3
+#define cg_lineW        cg_lineW_3
+#define cg_update       cg_update_3
+#define cg_updateW      cg_updateW_3
+#include "../cg_descent_3.0/cg_descent.c"
+#include "cg_compare.h"
+
+void cg_engine3
+(
+    cg_result     *R,
+    double        *x,
+    long           n,
+    double  grad_tol,
+    double        (*value) (double *, long),
+    void           (*grad) (double *, double *, long),
+    double      (*valgrad) (double *, double *, long)
+)
+{
+    cg_parameter Parm ;
+    cg_stats Stats ;
+    cg_default (&Parm) ;
+    Parm.PrintFinal = FALSE ;
+    Stats.f = Stats.gnorm = 0. ;
+    Stats.iter = Stats.nfunc = Stats.ngrad = 0 ;
+    R->status = cg_descent (x, n, &Stats, &Parm, grad_tol, value, grad,
+                            valgrad, NULL) ;
+    R->iter = Stats.iter ;
+    R->nfunc = Stats.nfunc ;
+    R->ngrad = Stats.ngrad ;
+    R->f = Stats.f ;
+    R->gnorm = Stats.gnorm ;
+}
@@ -0,0 +1,32 @@
+/* Adapter for cg_descent 5.0 (see cg_compare.h) */
+
+#define cg_descent      cg_descent_5
+#define cg_default      cg_default_5
+#include "../cg_descent_5.0/cg_descent.c"
+#include "cg_compare.h"
+
+void cg_engine5
+(
+    cg_result     *R,
+    double        *x,
+    long           n,
+    double  grad_tol,
+    double        (*value) (double *, long),
+    void           (*grad) (double *, double *, long),
+    double      (*valgrad) (double *, double *, long)
+)
+{
+    cg_parameter Parm ;
+    cg_stats Stats ;
+    cg_default (&Parm) ;
+    Parm.PrintFinal = FALSE ;
+    Stats.f = Stats.gnorm = 0. ;
+    Stats.iter = Stats.nfunc = Stats.ngrad = 0 ;
+    R->status = cg_descent (x, n, &Stats, &Parm, grad_tol, value, grad,
+                            valgrad, NULL) ;
+    R->iter = Stats.iter ;
+    R->nfunc = Stats.nfunc ;
+    R->ngrad = Stats.ngrad ;
+    R->f = Stats.f ;
+    R->gnorm = Stats.gnorm ;
+}
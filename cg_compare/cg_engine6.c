@@ -0,0 +1,31 @@
+/* Adapter for cg_descent 6.0 (see cg_compare.h). Version 6.0 is linked
+   without renaming since its routines are only used here. */
+
+#include "cg_user.h"
+#include "cg_compare.h"
+
+void cg_engine6
+(
+    cg_result     *R,
+    double        *x,
+    long           n,
+    double  grad_tol,
+    double        (*value) (double *, long),
+    void           (*grad) (double *, double *, long),
+    double      (*valgrad) (double *, double *, long)
+)
+{
+    cg_parameter Parm ;
+    cg_stats Stats ;
+    cg_default (&Parm) ;
+    Parm.PrintFinal = FALSE ;
+    Stats.f = Stats.gnorm = 0. ;
+    Stats.iter = Stats.nfunc = Stats.ngrad = 0 ;
+    R->status = cg_descent (x, n, &Stats, &Parm, grad_tol, value, grad,
+                            valgrad, NULL) ;
+    R->iter = Stats.iter ;
+    R->nfunc = Stats.nfunc ;
+    R->ngrad = Stats.ngrad ;
+    R->f = Stats.f ;
+    R->gnorm = Stats.gnorm ;
+}
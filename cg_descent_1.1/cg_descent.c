@@ -34,6 +34,11 @@
       |________________________________________________________________|
 */
 
+/* location of the parameter file, can be set with -DCG_PARM_FILE=... */
+#ifndef CG_PARM_FILE
+#define CG_PARM_FILE "F:/workspace/VC_workspace/vcpkg_project/cg_descent/cg_descent_1.1/cg_descent.parm"
+#endif
+
 int cg_descent /*  return  0 (convergence tolerance satisfied)
                            1 (change in func <= feps*|f|)
                            2 (total iterations exceeded maxit)
@@ -693,7 +698,7 @@ int  cg_descent_init
     Parm->nf = 0 ;
     Parm->ng = 0 ;
 
-    ParmFile = fopen ("F:/workspace/VC_workspace/vcpkg_project/cg_descent/cg_descent_1.1/cg_descent.parm", "r") ;
+    ParmFile = fopen (CG_PARM_FILE, "r") ;
     if ( ParmFile == NULL ) return (-1) ;
 
     info = fscanf (ParmFile, "%lg", &(Parm->delta)) ;
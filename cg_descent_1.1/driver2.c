@@ -39,7 +39,7 @@ void mygrad
     double    *x
 ) ;
 
-void main (int argc, char *argv [])
+int main (int argc, char *argv [])
 {
     extern int mydim ;
     double *x, *work, step ;
@@ -55,6 +55,7 @@ void main (int argc, char *argv [])
     status = cg_descent (1.e-8, x, mydim, myvalue, mygrad, work, step, &Stats) ;
     free (x) ;
     free (work) ;
+    return (0) ;
 }
 
 double myvalue
@@ -0,0 +1,434 @@
+/* =========================================================================
+   ================================ CG_AD ==================================
+   =========================================================================
+   Reverse mode automatic differentiation front end for cg_descent (C++).
+   The objective is written once as a function object with a template
+   operator over the scalar type,
+
+       struct myobjective
+       {
+           template <class T> T operator() (const T *x, INT n) const
+           {
+               T f = 0. ;
+               for (INT i = 0; i < n; i++)
+               {
+                   f += exp (x [i]) - sqrt (i+1.)*x [i] ;
+               }
+               return (f) ;
+           }
+       } ;
+
+   and cg_ad_descent (x, n, Stats, Parm, grad_tol, myobjective ()) solves
+   the problem. The value routine calls the template with T = double. The
+   grad and valgrad routines call it with T = cg_adouble, which records
+   each operation with its partial derivatives on a tape, and one reverse
+   sweep over the tape gives the gradient; f and g come from the same
+   evaluation (a fused valgrad).
+
+   The tape keeps its storage between evaluations: it is cleared, not
+   freed, so once it has grown to the length of the evaluation (the first
+   one, unless branches make a later one longer) the evaluations do not
+   allocate. Supplying a cg_tape to cg_ad_descent keeps it across solves,
+   and cg_tape::ngrow counts its reallocations.
+
+   The operations on cg_adouble are +, -, *, / (also with a double on
+   either side), unary -, the compound assignments, the comparisons (on
+   the values), and exp, log, sqrt, sin, cos, tan, sinh, cosh, tanh, atan,
+   fabs, and pow. Each thread has its own current tape, so solves can run
+   in parallel threads. */
+
+#ifndef CG_AD_HPP
+#define CG_AD_HPP
+
+#include <math.h>
+#include <vector>
+extern "C"
+{
+#include "cg_user.h"
+}
+
+/* an operation on the tape: the value was computed from the entries a and
+   b (-1 => none) with the partial derivatives da and db */
+struct cg_tape_node
+{
+    INT           a ;
+    INT           b ;
+    double       da ;
+    double       db ;
+} ;
+
+class cg_tape
+{
+public:
+    std::vector<cg_tape_node> node ; /* the first n entries are x */
+    std::vector<double>        adj ; /* adjoints in the reverse sweep */
+    INT                       ngrow ; /* reallocations of node and adj */
+
+    cg_tape () : ngrow (0) { }
+
+    /* start a new recording with the n independent variables */
+    void reset (INT n)
+    {
+        cg_tape_node v = {-1, -1, 0., 0.} ;
+        node.clear () ;
+        if ( (size_t) n > node.capacity () ) ngrow++ ;
+        node.resize (n, v) ;
+    }
+
+    /* record an operation, return its entry */
+    INT push (INT a, double da, INT b, double db)
+    {
+        cg_tape_node v = {a, b, da, db} ;
+        if ( node.size () == node.capacity () ) ngrow++ ;
+        node.push_back (v) ;
+        return ((INT) node.size () - 1) ;
+    }
+
+    /* g = gradient of the entry out with respect to the first n entries */
+    void gradient (double *g, INT out, INT n)
+    {
+        INT i, k ;
+        double t ;
+        if ( node.size () > adj.capacity () ) ngrow++ ;
+        adj.assign (node.size (), 0.) ;
+        if ( out >= 0 ) adj [out] = 1. ;
+        for (k = out; k >= n; k--)
+        {
+            t = adj [k] ;
+            if ( t == 0. ) continue ;
+            const cg_tape_node &v = node [k] ;
+            adj [v.a] += t*v.da ;
+            if ( v.b >= 0 ) adj [v.b] += t*v.db ;
+        }
+        for (i = 0; i < n; i++) g [i] = adj [i] ;
+    }
+} ;
+
+/* the tape of the evaluation in progress in this thread */
+inline cg_tape *&cg_ad_tape ()
+{
+    static thread_local cg_tape *T = NULL ;
+    return (T) ;
+}
+
+/* a value and its entry on the tape, -1 => a constant */
+struct cg_adouble
+{
+    double        v ;
+    INT           i ;
+
+    cg_adouble () : v (0.), i (-1) { }
+    cg_adouble (double c) : v (c), i (-1) { }
+    cg_adouble (double c, INT k) : v (c), i (k) { }
+
+    cg_adouble &operator+= (const cg_adouble &y) ;
+    cg_adouble &operator-= (const cg_adouble &y) ;
+    cg_adouble &operator*= (const cg_adouble &y) ;
+    cg_adouble &operator/= (const cg_adouble &y) ;
+} ;
+
+/* the result v of an operation on x with df/dx = dx */
+inline cg_adouble cg_ad_unary (double v, const cg_adouble &x, double dx)
+{
+    if ( x.i < 0 ) return (cg_adouble (v)) ;
+    return (cg_adouble (v, cg_ad_tape ()->push (x.i, dx, -1, 0.))) ;
+}
+
+/* the result v of an operation on x and y with partials dx and dy */
+inline cg_adouble cg_ad_binary (double v, const cg_adouble &x, double dx,
+                                const cg_adouble &y, double dy)
+{
+    if ( x.i < 0 ) return (cg_ad_unary (v, y, dy)) ;
+    if ( y.i < 0 ) return (cg_ad_unary (v, x, dx)) ;
+    return (cg_adouble (v, cg_ad_tape ()->push (x.i, dx, y.i, dy))) ;
+}
+
+inline cg_adouble operator+ (const cg_adouble &x, const cg_adouble &y)
+{
+    return (cg_ad_binary (x.v + y.v, x, 1., y, 1.)) ;
+}
+
+inline cg_adouble operator- (const cg_adouble &x, const cg_adouble &y)
+{
+    return (cg_ad_binary (x.v - y.v, x, 1., y, -1.)) ;
+}
+
+inline cg_adouble operator* (const cg_adouble &x, const cg_adouble &y)
+{
+    return (cg_ad_binary (x.v*y.v, x, y.v, y, x.v)) ;
+}
+
+inline cg_adouble operator/ (const cg_adouble &x, const cg_adouble &y)
+{
+    double t = 1./y.v ;
+    return (cg_ad_binary (x.v/y.v, x, t, y, -x.v*t*t)) ;
+}
+
+inline cg_adouble operator+ (const cg_adouble &x, double c)
+{
+    return (cg_ad_unary (x.v + c, x, 1.)) ;
+}
+
+inline cg_adouble operator+ (double c, const cg_adouble &x)
+{
+    return (cg_ad_unary (c + x.v, x, 1.)) ;
+}
+
+inline cg_adouble operator- (const cg_adouble &x, double c)
+{
+    return (cg_ad_unary (x.v - c, x, 1.)) ;
+}
+
+inline cg_adouble operator- (double c, const cg_adouble &x)
+{
+    return (cg_ad_unary (c - x.v, x, -1.)) ;
+}
+
+inline cg_adouble operator* (const cg_adouble &x, double c)
+{
+    return (cg_ad_unary (x.v*c, x, c)) ;
+}
+
+inline cg_adouble operator* (double c, const cg_adouble &x)
+{
+    return (cg_ad_unary (c*x.v, x, c)) ;
+}
+
+inline cg_adouble operator/ (const cg_adouble &x, double c)
+{
+    return (cg_ad_unary (x.v/c, x, 1./c)) ;
+}
+
+inline cg_adouble operator/ (double c, const cg_adouble &x)
+{
+    double t = 1./x.v ;
+    return (cg_ad_unary (c/x.v, x, -c*t*t)) ;
+}
+
+inline cg_adouble operator- (const cg_adouble &x)
+{
+    return (cg_ad_unary (-x.v, x, -1.)) ;
+}
+
+inline cg_adouble operator+ (const cg_adouble &x)
+{
+    return (x) ;
+}
+
+inline cg_adouble &cg_adouble::operator+= (const cg_adouble &y)
+{
+    return (*this = *this + y) ;
+}
+
+inline cg_adouble &cg_adouble::operator-= (const cg_adouble &y)
+{
+    return (*this = *this - y) ;
+}
+
+inline cg_adouble &cg_adouble::operator*= (const cg_adouble &y)
+{
+    return (*this = *this * y) ;
+}
+
+inline cg_adouble &cg_adouble::operator/= (const cg_adouble &y)
+{
+    return (*this = *this / y) ;
+}
+
+inline bool operator<  (const cg_adouble &x, const cg_adouble &y)
+{
+    return (x.v < y.v) ;
+}
+
+inline bool operator<= (const cg_adouble &x, const cg_adouble &y)
+{
+    return (x.v <= y.v) ;
+}
+
+inline bool operator>  (const cg_adouble &x, const cg_adouble &y)
+{
+    return (x.v > y.v) ;
+}
+
+inline bool operator>= (const cg_adouble &x, const cg_adouble &y)
+{
+    return (x.v >= y.v) ;
+}
+
+inline bool operator== (const cg_adouble &x, const cg_adouble &y)
+{
+    return (x.v == y.v) ;
+}
+
+inline bool operator!= (const cg_adouble &x, const cg_adouble &y)
+{
+    return (x.v != y.v) ;
+}
+
+inline cg_adouble exp (const cg_adouble &x)
+{
+    double e = ::exp (x.v) ;
+    return (cg_ad_unary (e, x, e)) ;
+}
+
+inline cg_adouble log (const cg_adouble &x)
+{
+    return (cg_ad_unary (::log (x.v), x, 1./x.v)) ;
+}
+
+inline cg_adouble sqrt (const cg_adouble &x)
+{
+    double s = ::sqrt (x.v) ;
+    return (cg_ad_unary (s, x, .5/s)) ;
+}
+
+inline cg_adouble sin (const cg_adouble &x)
+{
+    return (cg_ad_unary (::sin (x.v), x, ::cos (x.v))) ;
+}
+
+inline cg_adouble cos (const cg_adouble &x)
+{
+    return (cg_ad_unary (::cos (x.v), x, -::sin (x.v))) ;
+}
+
+inline cg_adouble tan (const cg_adouble &x)
+{
+    double t = ::tan (x.v) ;
+    return (cg_ad_unary (t, x, 1. + t*t)) ;
+}
+
+inline cg_adouble sinh (const cg_adouble &x)
+{
+    return (cg_ad_unary (::sinh (x.v), x, ::cosh (x.v))) ;
+}
+
+inline cg_adouble cosh (const cg_adouble &x)
+{
+    return (cg_ad_unary (::cosh (x.v), x, ::sinh (x.v))) ;
+}
+
+inline cg_adouble tanh (const cg_adouble &x)
+{
+    double t = ::tanh (x.v) ;
+    return (cg_ad_unary (t, x, 1. - t*t)) ;
+}
+
+inline cg_adouble atan (const cg_adouble &x)
+{
+    return (cg_ad_unary (::atan (x.v), x, 1./(1. + x.v*x.v))) ;
+}
+
+/* the derivative at 0 is taken as 0 */
+inline cg_adouble fabs (const cg_adouble &x)
+{
+    return (cg_ad_unary (::fabs (x.v), x, (x.v > 0.) ? 1. :
+                                          (x.v < 0.) ? -1. : 0.)) ;
+}
+
+inline cg_adouble pow (const cg_adouble &x, double p)
+{
+    return (cg_ad_unary (::pow (x.v, p), x, p*::pow (x.v, p-1.))) ;
+}
+
+inline cg_adouble pow (double c, const cg_adouble &x)
+{
+    double t = ::pow (c, x.v) ;
+    return (cg_ad_unary (t, x, t*::log (c))) ;
+}
+
+inline cg_adouble pow (const cg_adouble &x, const cg_adouble &y)
+{
+    double t = ::pow (x.v, y.v) ;
+    return (cg_ad_binary (t, x, y.v*::pow (x.v, y.v-1.), y,
+                          (x.v > 0.) ? t*::log (x.v) : 0.)) ;
+}
+
+/* the independent variables of the evaluations in this thread */
+inline std::vector<cg_adouble> &cg_ad_x ()
+{
+    static thread_local std::vector<cg_adouble> xa ;
+    return (xa) ;
+}
+
+/* the objective of the solve in progress in this thread */
+template <class F> const F *&cg_ad_objective ()
+{
+    static thread_local const F *f = NULL ;
+    return (f) ;
+}
+
+/* the routines given to cg_descent */
+template <class F> double cg_ad_value (double *x, INT n)
+{
+    const double *xc = x ;
+    return ((*cg_ad_objective<F> ()) (xc, n)) ;
+}
+
+template <class F> double cg_ad_valgrad (double *g, double *x, INT n)
+{
+    INT i ;
+    cg_tape *T ;
+    std::vector<cg_adouble> &xa = cg_ad_x () ;
+    T = cg_ad_tape () ;
+    T->reset (n) ;
+    xa.resize (n) ;
+    for (i = 0; i < n; i++) xa [i] = cg_adouble (x [i], i) ;
+    const cg_adouble *xc = xa.data () ;
+    cg_adouble f = (*cg_ad_objective<F> ()) (xc, n) ;
+    T->gradient (g, f.i, n) ;
+    return (f.v) ;
+}
+
+template <class F> void cg_ad_grad (double *g, double *x, INT n)
+{
+    cg_ad_valgrad<F> (g, x, n) ;
+}
+
+/* =========================================================================
+   ==== cg_ad_descent ======================================================
+   =========================================================================
+   Minimize the objective f with cg_descent and gradients by reverse mode
+   automatic differentiation. The tape T is kept by the caller, the
+   second form uses a tape for this solve.
+   ========================================================================= */
+template <class F> int cg_ad_descent /* return the status of cg_descent */
+(
+    double          *x, /* input: starting guess, output: the solution */
+    INT              n, /* problem dimension */
+    cg_stats    *Stats, /* structure with statistics, can be NULL */
+    cg_parameter *Parm, /* user parameters, NULL = use default parameters */
+    double    grad_tol, /* convergence tolerance, see cg_descent */
+    const F         &f, /* objective, f (x, n) for T = double, cg_adouble */
+    cg_tape         &T  /* tape of the gradient evaluations */
+)
+{
+    int status ;
+    const F *fsave ;
+    cg_tape *Tsave ;
+    fsave = cg_ad_objective<F> () ;
+    Tsave = cg_ad_tape () ;
+    cg_ad_objective<F> () = &f ;
+    cg_ad_tape () = &T ;
+    status = cg_descent (x, n, Stats, Parm, grad_tol, cg_ad_value<F>,
+                         cg_ad_grad<F>, cg_ad_valgrad<F>, NULL) ;
+    cg_ad_objective<F> () = fsave ;
+    cg_ad_tape () = Tsave ;
+    return (status) ;
+}
+
+template <class F> int cg_ad_descent
+(
+    double          *x,
+    INT              n,
+    cg_stats    *Stats,
+    cg_parameter *Parm,
+    double    grad_tol,
+    const F         &f
+)
+{
+    cg_tape T ;
+    return (cg_ad_descent (x, n, Stats, Parm, grad_tol, f, T)) ;
+}
+
+#endif
@@ -0,0 +1,142 @@
+/* Benchmark harness: run cg_descent on the test problems of cg_test.c with
+   three configurations, memory = 0 (the original CG_DESCENT), memory = 11
+   (limited memory CG), and L-BFGS with memory = 11, and print the
+   Dolan-More performance profiles for time, nfunc, and ngrad.
+
+   cg_bench [n [ProfileFile]]
+
+   n is the problem dimension (default 1000). For each problem p and
+   configuration s, the ratio r_ps = t_ps/min_s t_ps compares the
+   configuration to the best one on the problem (a failure, status != 0,
+   gives r_ps = infinity). The profile of configuration s at tau is the
+   fraction of problems with r_ps <= tau (E. D. Dolan and J. J. More,
+   Benchmarking optimization software with performance profiles,
+   Mathematical Programming, 91 (2002), 201-213). When ProfileFile is given,
+   the profiles are also written to it, one line per metric and tau:
+
+   metric tau cg lmcg lbfgs */
+
+#include <math.h>
+#include "cg_test.h"
+
+#define NCONFIG 3
+#define NTAU 9
+#define NMETRIC 3
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+
+int main (int argc, char **argv)
+{
+    double *x, tau, best, r, prof [NCONFIG], **M [NMETRIC] ;
+    INT i, n, nprob, dim ;
+    int k, m, p, status ;
+    cg_problem *P ;
+    cg_parameter Parm ;
+    cg_stats Stats ;
+    FILE *file ;
+    char *config [NCONFIG] = {"cg", "lmcg", "lbfgs"} ;
+    char *metric [NMETRIC] = {"time", "nfunc", "ngrad"} ;
+    double Tau [NTAU] = {1., 1.1, 1.25, 1.5, 2., 3., 5., 10., 100.} ;
+
+    n = 1000 ;
+    if ( argc > 1 ) n = atol (argv [1]) ;
+    file = NULL ;
+    if ( argc > 2 )
+    {
+        file = fopen (argv [2], "w") ;
+        if ( file == NULL )
+        {
+            printf ("cannot open %s\n", argv [2]) ;
+            return (1) ;
+        }
+    }
+
+    for (nprob = 0; cg_problems [nprob].name != NULL; nprob++) ;
+    x = (double *) malloc (n*sizeof (double)) ;
+    for (m = 0; m < NMETRIC; m++)
+    {
+        M [m] = (double **) malloc (nprob*sizeof (double *)) ;
+        for (p = 0; p < nprob; p++)
+        {
+            M [m][p] = (double *) malloc (NCONFIG*sizeof (double)) ;
+        }
+    }
+
+    printf ("problem         n config status  iter nfunc ngrad        time"
+            "              f\n") ;
+    for (p = 0; p < nprob; p++)
+    {
+        P = cg_problems + p ;
+        dim = cg_test_dim (P, n) ;
+        for (k = 0; k < NCONFIG; k++)
+        {
+            cg_default (&Parm) ;
+            Parm.PrintFinal = FALSE ;
+            Parm.Timing = TRUE ;
+            Parm.memory = (k == 0) ? 0 : 11 ;
+            Parm.LBFGS = (k == 2) ;
+            P->start (x, dim) ;
+            status = cg_descent (x, dim, &Stats, &Parm, 1.e-6, P->value,
+                                 P->grad, P->valgrad, NULL) ;
+            printf ("%-10s %6ld %6s %6i %5ld %5ld %5ld %11.4e %14.6e\n",
+                    P->name, (long) dim, config [k], status, (long)Stats.iter,
+                    (long) Stats.nfunc, (long) Stats.ngrad, Stats.time.total,
+                    Stats.f) ;
+            if ( status )
+            {
+                M [0][p][k] = M [1][p][k] = M [2][p][k] = INF ;
+            }
+            else
+            {
+                M [0][p][k] = Stats.time.total ;
+                M [1][p][k] = (double) Stats.nfunc ;
+                M [2][p][k] = (double) Stats.ngrad ;
+            }
+        }
+    }
+
+    /* performance profiles */
+    printf ("\nperformance profiles (fraction of problems with ratio <= tau)"
+            "\nmetric     tau") ;
+    for (k = 0; k < NCONFIG; k++) printf (" %6s", config [k]) ;
+    printf ("\n") ;
+    for (m = 0; m < NMETRIC; m++)
+    {
+        for (i = 0; i < NTAU; i++)
+        {
+            tau = Tau [i] ;
+            for (k = 0; k < NCONFIG; k++) prof [k] = 0. ;
+            for (p = 0; p < nprob; p++)
+            {
+                best = INF ;
+                for (k = 0; k < NCONFIG; k++) best = MIN (best, M [m][p][k]);
+                if ( best == INF ) continue ; /* every configuration failed */
+                for (k = 0; k < NCONFIG; k++)
+                {
+                    if ( M [m][p][k] == INF ) continue ;
+                    /* a time of zero is below the clock resolution */
+                    if ( best > 0. ) r = M [m][p][k]/best ;
+                    else             r = (M [m][p][k] > 0.) ? INF : 1. ;
+                    if ( r <= tau ) prof [k] += 1./nprob ;
+                }
+            }
+            printf ("%-6s %7.2f", metric [m], tau) ;
+            for (k = 0; k < NCONFIG; k++) printf (" %6.3f", prof [k]) ;
+            printf ("\n") ;
+            if ( file != NULL )
+            {
+                fprintf (file, "%s %g", metric [m], tau) ;
+                for (k = 0; k < NCONFIG; k++) fprintf (file, " %g", prof [k]);
+                fprintf (file, "\n") ;
+            }
+        }
+    }
+
+    if ( file != NULL ) fclose (file) ;
+    for (m = 0; m < NMETRIC; m++)
+    {
+        for (p = 0; p < nprob; p++) free (M [m][p]) ;
+        free (M [m]) ;
+    }
+    free (x) ;
+    return (0) ;
+}
@@ -8,9 +8,11 @@
    performing low dimensional operations with threaded BLAS can be
    less efficient than the cg_descent unrolled loops. Hence,
    START parameters should be specified to determine when to start
-   using the BLAS. */
+   using the BLAS. Compiling with -DCG_USE_BLAS also turns on the BLAS. */
 
+#ifndef CG_USE_BLAS
 #define NOBLAS
+#endif
 
 /* if BLAS are used, specify the integer precision */
 #define BLAS_INT long int
@@ -0,0 +1,519 @@
+/* Performance regression check, run by CTest. The problem of driver1.c
+   is solved with the parameter settings of driver1.c - driver6.c, and the
+   problems of cg_test.c (n = 1000) with memory = 0, limited memory CG, and
+   L-BFGS. The problem of driver6.c is also solved in the truncated Newton
+   mode, and as a partially separable objective with one element per
+   variable (cg_psep.c), which must give the counts of driver1, and with
+   memory = 0 in the sparse mode (Parm.sparsegrad), also with hessvec,
+   with the finite difference gradient (grad and valgrad NULL), with the
+   line search based on function values (GradCost large), and with the
+   diagonal preconditioner 1/(i+1) given as PrecondDiag and as a precond
+   routine (memory = 0, the two must agree) and in L-BFGS. The test
+   problems are also solved with the predicted initial step (PredictStep),
+   with the adapted memory (AdaptMemory, rated by AdaptEvals), and with
+   the compact representation of L-BFGS (LBFGSCompact).
+   The iteration and evaluation counts are compared with a baseline file,
+   and optionally the run time with a reference file.
+
+   cg_check                         print the counts in the baseline format
+   cg_check -ref                    print the scaled time for RefFile
+   cg_check BaseFile                compare the counts with BaseFile
+   cg_check BaseFile RefFile tol    also compare the time with RefFile
+
+   The counts must match exactly; a change in cg_line or in the kernels
+   that changes the rounding shows up here. After an intended change,
+   regenerate the baseline with "cg_check > cg_check.base". The time is
+   the smallest over NTIME runs of the total solve time (Parm.Timing),
+   scaled by the bandwidth of cg_daxpy measured in the same process (see
+   cg_check_time), and the check fails when it exceeds tol times the
+   reference in RefFile, or when RefFile can't be read. After an intended
+   change, record the reference with "cg_check -ref > cg_check.ref". With
+   BaseFile, the record and replay of the evaluations (Parm.RecordFile and
+   ReplayFile) are also checked in the file cg_check.rec. The return value
+   is 0 when the checks pass and 1 otherwise. */
+
+#include <math.h>
+#include <string.h>
+#include "cg_test.h"
+
+#define NDRIVER 19
+#define NCONFIG 7
+#define NTIME 5
+#define NCASE 128
+#define NTEST 1000
+
+typedef struct cg_count_struct /* counts for one case */
+{
+    char      name [32] ;
+    long            iter ;
+    long           nfunc ;
+    long           ngrad ;
+} cg_count ;
+
+static double myvalue (double *x, INT n) ;
+static void mygrad (double *g, double *x, INT n) ;
+static double myvalgrad (double *g, double *x, INT n) ;
+static void myhessvec (double *Hd, double *d, double *x, INT n) ;
+static double myelement (double *ge, double *xe, int ne, void *Data) ;
+static INT mysparsegrad (double *g, INT *ind, double *x, INT n) ;
+static void myprecond (double *Pg, double *g, INT n, void *Data) ;
+static double cg_check_run (cg_count *Count, double *x, int *ncase) ;
+static double cg_check_time (cg_count *Count, double *x, int *ncase) ;
+static int cg_check_replay (double *x) ;
+
+int main (int argc, char **argv)
+{
+    double *x, best, base, tol ;
+    int j, k, ncase, nbase, fail ;
+    cg_count Count [NCASE], Base [NCASE] ;
+    FILE *file ;
+
+    x = (double *) malloc (NTEST*sizeof (double)) ;
+    if ( (argc > 1) && !strcmp (argv [1], "-ref") )
+    {
+        printf ("%.6e\n", cg_check_time (Count, x, &ncase)) ;
+        free (x) ;
+        return (0) ;
+    }
+    cg_check_run (Count, x, &ncase) ;
+    if ( argc < 2 )
+    {
+        for (k = 0; k < ncase; k++)
+        {
+            printf ("%-24s %6ld %6ld %6ld\n", Count [k].name, Count [k].iter,
+                    Count [k].nfunc, Count [k].ngrad) ;
+        }
+        free (x) ;
+        return (0) ;
+    }
+
+    /* compare the counts with the baseline */
+    file = fopen (argv [1], "r") ;
+    if ( file == NULL )
+    {
+        printf ("cannot open baseline file %s\n", argv [1]) ;
+        free (x) ;
+        return (1) ;
+    }
+    for (nbase = 0; nbase < NCASE; nbase++)
+    {
+        if ( fscanf (file, "%31s %ld %ld %ld", Base [nbase].name,
+                     &Base [nbase].iter, &Base [nbase].nfunc,
+                     &Base [nbase].ngrad) != 4 ) break ;
+    }
+    fclose (file) ;
+    fail = 0 ;
+    printf ("case                       iter  nfunc  ngrad   baseline\n") ;
+    for (k = 0; k < ncase; k++)
+    {
+        for (j = 0; j < nbase; j++)
+        {
+            if ( !strcmp (Count [k].name, Base [j].name) ) break ;
+        }
+        printf ("%-24s %6ld %6ld %6ld", Count [k].name, Count [k].iter,
+                Count [k].nfunc, Count [k].ngrad) ;
+        if ( j == nbase )
+        {
+            printf ("   not in baseline\n") ;
+            fail = 1 ;
+        }
+        else if ( (Count [k].iter  != Base [j].iter ) ||
+                  (Count [k].nfunc != Base [j].nfunc) ||
+                  (Count [k].ngrad != Base [j].ngrad) )
+        {
+            printf ("   %ld %ld %ld  CHANGED\n", Base [j].iter,
+                    Base [j].nfunc, Base [j].ngrad) ;
+            fail = 1 ;
+        }
+        else printf ("   ok\n") ;
+    }
+    if ( nbase != ncase )
+    {
+        printf ("the baseline has %i cases, the check has %i\n", nbase,ncase);
+        fail = 1 ;
+    }
+    if ( cg_check_replay (x) ) fail = 1 ;
+
+    /* compare the scaled time with the reference file */
+    if ( argc > 3 )
+    {
+        tol = atof (argv [3]) ;
+        best = cg_check_time (Count, x, &ncase) ;
+        file = fopen (argv [2], "r") ;
+        if ( (file == NULL) || (fscanf (file, "%lg", &base) != 1) ||
+             (base <= 0.) )
+        {
+            printf ("\ncannot read the reference time in %s, record it "
+                    "with \"cg_check -ref > %s\"\n", argv [2], argv [2]) ;
+            fail = 1 ;
+        }
+        else
+        {
+            printf ("\nscaled time: %.4e reference: %.4e ratio: %.3f "
+                    "tolerance: %g\n", best, base, best/base, tol) ;
+            if ( best > tol*base )
+            {
+                printf ("time regression: %.4e > %g*%.4e\n", best, tol, base);
+                fail = 1 ;
+            }
+            else if ( best*tol < base )
+            {
+                printf ("faster than the band, record the new reference "
+                        "with \"cg_check -ref > %s\"\n", argv [2]) ;
+            }
+        }
+        if ( file != NULL ) fclose (file) ;
+    }
+    free (x) ;
+    return (fail) ;
+}
+
+/* =========================================================================
+   ==== cg_check_time ======================================================
+   =========================================================================
+   Return the smallest total solve time of the cases over NTIME runs times
+   the largest bandwidth of cg_daxpy on vectors of length NTEST measured
+   between the runs (Parm.Roofline), in GB. This is the time in units of
+   the time to move a GB through cg_daxpy, so that it can be compared with
+   a reference recorded on another machine or under another load.
+   ========================================================================= */
+static double cg_check_time
+(
+    cg_count *Count, /* counts of the cases */
+    double       *x, /* work array of length NTEST */
+    int      *ncase  /* number of cases */
+)
+{
+    int k ;
+    INT i ;
+    double t, best, bw ;
+    cg_parameter Parm ;
+    cg_stats Stats ;
+    best = INF ;
+    bw = 0. ;
+    for (k = 0; k < NTIME; k++)
+    {
+        t = cg_check_run (Count, x, ncase) ;
+        if ( t < best ) best = t ;
+        cg_default (&Parm) ;
+        Parm.PrintFinal = FALSE ;
+        Parm.Roofline = TRUE ;
+        for (i = 0; i < NTEST; i++) x [i] = 1. ;
+        cg_descent (x, NTEST, &Stats, &Parm, 1.e-8, myvalue, mygrad,
+                    myvalgrad, NULL) ;
+        if ( Stats.roof.bandwidth > bw ) bw = Stats.roof.bandwidth ;
+    }
+    return (1.e-9*best*bw) ;
+}
+
+/* =========================================================================
+   ==== cg_check_run =======================================================
+   =========================================================================
+   Run all the cases, store the counts, and return the total solve time
+   ========================================================================= */
+static double cg_check_run
+(
+    cg_count *Count, /* counts of the cases */
+    double       *x, /* work array of length NTEST */
+    int      *ncase  /* number of cases */
+)
+{
+    int d, k, p ;
+    INT i, n ;
+    double time, tol, sqrti [100], pdiag [100] ;
+    cg_problem *P ;
+    cg_psep *Obj ;
+    cg_parameter Parm ;
+    cg_stats Stats ;
+    char *name [NDRIVER] = {"driver1", "driver1_novalgrad", "driver2_noquad",
+                            "driver2_quad", "driver3_step", "driver4_rho1.5",
+                            "driver4_rho5", "driver5_wolfe_1e-8",
+                            "driver5_wolfe_1e-6", "driver6_hessvec",
+                            "driver6_newton", "driver1_psep",
+                            "driver1_sparse", "driver1_fd",
+                            "driver1_sparse_hessvec", "driver1_funcline",
+                            "driver1_precdiag", "driver1_precond",
+                            "driver1_precdiag_lbfgs"} ;
+    char *config [NCONFIG] = {"cg", "lmcg", "lbfgs", "predict", "lmcg_adapt",
+                              "lbfgs_adapt", "lbfgs_compact"} ;
+
+    /* the problem of driver1.c with the settings of the drivers */
+    *ncase = 0 ;
+    time = 0. ;
+    n = 100 ;
+    for (d = 0; d < NDRIVER; d++)
+    {
+        cg_default (&Parm) ;
+        Parm.PrintFinal = FALSE ;
+        Parm.Timing = TRUE ;
+        tol = 1.e-8 ;
+        switch ( d )
+        {
+            case 2: Parm.QuadStep = FALSE ; break ;
+            case 3: Parm.QuadStep = TRUE ; break ;
+            case 4: Parm.step = 1. ; break ;
+            case 5:
+            case 6:
+                Parm.step = 1.e-5 ;
+                Parm.QuadStep = FALSE ;
+                Parm.rho = (d == 5) ? 1.5 : 5. ;
+                break ;
+            case 7:
+            case 8:
+                Parm.AWolfeFac = 0. ;
+                if ( d == 8 ) tol = 1.e-6 ;
+                break ;
+            case 9: Parm.hessvec = myhessvec ; break ;
+            case 10:
+                Parm.hessvec = myhessvec ;
+                Parm.Newton = TRUE ;
+                break ;
+            case 12:
+                Parm.memory = 0 ;
+                Parm.sparsegrad = mysparsegrad ;
+                break ;
+            case 13: Parm.FDCentral = TRUE ; break ;
+            case 14: /* hessvec turns the sparse mode off */
+                Parm.memory = 0 ;
+                Parm.sparsegrad = mysparsegrad ;
+                Parm.hessvec = myhessvec ;
+                break ;
+            case 15: Parm.GradCost = 10. ; break ; /* line search cg_lineF */
+            case 16: /* preconditioned beta, the same P as a routine */
+            case 17:
+            case 18: /* L-BFGS with the scaled P in the two-loop recursion */
+                for (i = 0; i < n; i++) pdiag [i] = 1./(i+1) ;
+                if ( d == 17 )
+                {
+                    Parm.precond = myprecond ;
+                    Parm.PrecondData = pdiag ;
+                }
+                else Parm.PrecondDiag = pdiag ;
+                Parm.memory = (d == 18) ? 11 : 0 ;
+                Parm.LBFGS = (d == 18) ;
+                break ;
+        }
+        for (i = 0; i < n; i++) x [i] = 1. ;
+        if ( d == 11 )
+        {
+            Obj = cg_psep_new (n) ;
+            for (i = 0; i < n; i++)
+            {
+                sqrti [i] = sqrt ((double) (i+1)) ;
+                cg_psep_add (Obj, myelement, sqrti+i, 1, &i) ;
+            }
+            cg_psep_descent (x, &Stats, &Parm, tol, Obj) ;
+            cg_psep_free (Obj) ;
+        }
+        else
+        {
+            cg_descent (x, n, &Stats, &Parm, tol, myvalue,
+                        (d == 13) ? NULL : mygrad,
+                        ((d == 1) || (d == 13)) ? NULL : myvalgrad, NULL) ;
+        }
+        strcpy (Count [*ncase].name, name [d]) ;
+        Count [*ncase].iter = Stats.iter ;
+        Count [*ncase].nfunc = Stats.nfunc ;
+        Count [*ncase].ngrad = Stats.ngrad ;
+        (*ncase)++ ;
+        time += Stats.time.total ;
+    }
+
+    /* the test problems with the configurations of cg_bench.c, with the
+       predicted initial step, with the adapted memory, and with the
+       compact representation of L-BFGS */
+    for (p = 0; cg_problems [p].name != NULL; p++)
+    {
+        P = cg_problems + p ;
+        n = cg_test_dim (P, NTEST) ;
+        for (k = 0; k < NCONFIG; k++)
+        {
+            cg_default (&Parm) ;
+            Parm.PrintFinal = FALSE ;
+            Parm.Timing = TRUE ;
+            Parm.memory = (k == 0) ? 0 : 11 ;
+            Parm.LBFGS = (k == 2) || (k == 5) || (k == 6) ;
+            Parm.LBFGSCompact = (k == 6) ;
+            Parm.PredictStep = (k == 3) ;
+            Parm.AdaptMemory = (k == 4) || (k == 5) ;
+            Parm.AdaptEvals = TRUE ; /* the counts do not depend on time */
+            P->start (x, n) ;
+            cg_descent (x, n, &Stats, &Parm, 1.e-6, P->value, P->grad,
+                        P->valgrad, NULL) ;
+            sprintf (Count [*ncase].name, "%s_%s", P->name, config [k]) ;
+            Count [*ncase].iter = Stats.iter ;
+            Count [*ncase].nfunc = Stats.nfunc ;
+            Count [*ncase].ngrad = Stats.ngrad ;
+            (*ncase)++ ;
+            time += Stats.time.total ;
+        }
+    }
+    return (time) ;
+}
+
+/* =========================================================================
+   ==== cg_check_replay ====================================================
+   =========================================================================
+   Record the problem of driver1.c, replay it with the same parameters (every
+   evaluation must come from the recording), and with another psi2 (the
+   replay must diverge and give the counts of a live run). Returns 1 if a
+   check fails.
+   ========================================================================= */
+static int cg_check_replay
+(
+    double       *x  /* work array of length NTEST */
+)
+{
+    int k, fail ;
+    INT i, n ;
+    cg_parameter Parm ;
+    cg_stats Stats [4] ;
+    char *file = "cg_check.rec" ;
+
+    n = 100 ;
+    for (k = 0; k < 4; k++)
+    {
+        cg_default (&Parm) ;
+        Parm.PrintFinal = FALSE ;
+        if ( k == 0 ) Parm.RecordFile = file ;
+        if ( (k == 1) || (k == 2) ) Parm.ReplayFile = file ;
+        if ( k >= 2 ) Parm.psi2 = 1.5 ;
+        for (i = 0; i < n; i++) x [i] = 1. ;
+        cg_descent (x, n, Stats+k, &Parm, 1.e-8, myvalue, mygrad, myvalgrad,
+                    NULL) ;
+    }
+    remove (file) ;
+    fail = (Stats [1].iter != Stats [0].iter) ||
+           (Stats [1].nfunc != Stats [0].nfunc) ||
+           (Stats [1].ngrad != Stats [0].ngrad) ||
+           (Stats [1].nreplay == 0) || (Stats [1].replay_diverge != 0) ||
+           (Stats [2].iter != Stats [3].iter) ||
+           (Stats [2].nfunc != Stats [3].nfunc) ||
+           (Stats [2].ngrad != Stats [3].ngrad) ||
+           (Stats [2].replay_diverge <= 0) ;
+    printf ("replay: %ld calls replayed, changed psi2 diverged at call %ld"
+            "   %s\n", (long) Stats [1].nreplay, (long)Stats [2].replay_diverge,
+            fail ? "FAILED" : "ok") ;
+    return (fail) ;
+}
+
+/* the problem of driver1.c: f = sum exp (x_i) - sqrt (i) x_i */
+static double myvalue
+(
+    double   *x,
+    INT       n
+)
+{
+    double f, t ;
+    INT i ;
+    f = 0. ;
+    for (i = 0; i < n; i++)
+    {
+        t = i+1 ;
+        t = sqrt (t) ;
+        f += exp (x [i]) - t*x [i] ;
+    }
+    return (f) ;
+}
+
+static void mygrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    double t ;
+    INT i ;
+    for (i = 0; i < n; i++)
+    {
+        t = i + 1 ;
+        t = sqrt (t) ;
+        g [i] = exp (x [i]) - t ;
+    }
+    return ;
+}
+
+static double myvalgrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    double ex, f, t ;
+    INT i ;
+    f = (double) 0 ;
+    for (i = 0; i < n; i++)
+    {
+        t = i + 1 ;
+        t = sqrt (t) ;
+        ex = exp (x [i]) ;
+        f += ex - t*x [i] ;
+        g [i] = ex - t ;
+    }
+    return (f) ;
+}
+
+static void myhessvec
+(
+    double   *Hd,
+    double    *d,
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    for (i = 0; i < n; i++)
+    {
+        Hd [i] = exp (x [i])*d [i] ;
+    }
+    return ;
+}
+
+/* the gradient of driver1.c in the sparse format, all entries nonzero */
+static INT mysparsegrad
+(
+    double    *g,
+    INT     *ind,
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    mygrad (g, x, n) ;
+    for (i = 0; i < n; i++) ind [i] = i ;
+    return (n) ;
+}
+
+/* Pg = diag (Data) g */
+static void myprecond
+(
+    double   *Pg,
+    double    *g,
+    INT        n,
+    void   *Data
+)
+{
+    INT i ;
+    double *D ;
+    D = (double *) Data ;
+    for (i = 0; i < n; i++) Pg [i] = D [i]*g [i] ;
+}
+
+/* element i of the problem of driver1.c, Data points to sqrt (i+1) */
+static double myelement
+(
+    double   *ge,
+    double   *xe,
+    int       ne,
+    void   *Data
+)
+{
+    double ex, t ;
+    (void) ne ;
+    t = *((double *) Data) ;
+    ex = exp (xe [0]) ;
+    if ( ge != NULL ) ge [0] = ex - t ;
+    return (ex - t*xe [0]) ;
+}
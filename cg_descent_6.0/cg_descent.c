@@ -73,11 +73,18 @@
 #include "cg_descent.h"
 #include "cg_blas.h"
 
-/* begin external variables */
-double one [1], zero [1] ;
-BLAS_INT blas_one [1] ;
+/* begin external variables, they are constant so that several cg_descent
+   can run at the same time in different threads */
+double one [1] = {1.}, zero [1] = {0.} ;
+BLAS_INT blas_one [1] = {1} ;
+char *cg_phase [] = {"start", "expand", "secant", "cubic", "bisection",
+                     "contract", "eps", "armijo", "initial", "quadstep",
+                     "nan"} ;
 /* end external variables */
 
+/* work of the vector kernels for Parm->Roofline, one copy per thread */
+PRIVATE CG_TLS cg_kwork cg_work ;
+
 int cg_descent /*  return status of solution process:
                        0 (convergence tolerance satisfied)
                        1 (change in func <= feps*|f|)
@@ -92,7 +99,9 @@ int cg_descent /*  return status of solution process:
                           2n + Parm->nslow iterations)
                       10 (out of memory)
                       11 (function nan or +-INF and could not be repaired)
-                      12 (invalid choice for memory parameter) */
+                      12 (invalid choice for memory parameter)
+                      13 (stopped by the monitor routine)
+                      14 (Newton is T but hessvec is NULL) */
 (
     double            *x, /* input: starting guess, output: the solution */
     INT                n, /* problem dimension */
@@ -110,22 +119,31 @@ int cg_descent /*  return status of solution process:
                              The amount of memory needed depends on the value
                              of the parameter memory in the Parm structure.
                              memory > 0 => need (mem+6)*n + (3*mem+9)*mem + 5
-                                           where mem = MIN(memory, n)
-                             memory = 0 => need 4*n */
+                                           where mem = MIN(memory, n), with
+                                           AdaptMemory = T mem is the
+                                           largest memory (see cg_adapt)
+                             memory = 0 => need 4*n (the index lists of
+                                           the sparse mode are allocated
+                                           separately)
+                             Newton = T => need 7*n */
 )
 {
-    INT     i, iter, IterRestart, maxit, n5, nrestart, nrestartsub ;
-    int     nslow, slowlimit, IterQuad, status, PrintLevel, QuadF, StopRule ;
-    double  delta2, Qk, Ck, fbest, gbest,
+    INT     i, iter, IterRestart, maxit, n5, nrestart, nrestartsub, PredN,
+            IterInner ;
+    int     nslow, slowlimit, IterQuad, status, PrintLevel, QuadF, StopRule,
+            HessOK, Predict, Newton, Compact, shift ;
+    double  delta2, Qk, Ck, fbest, gbest, dHd, HdHd, dd,
+            PredMean, PredVar, PredBase, PredDphi, PredCost, QuadCost,
+            IterCost,
             f, ftemp, gnorm, xnorm, gnorm2, dnorm2, denom,
             t, dphi, dphi0, alpha,
-            ykyk, ykgk, dkyk, beta, QuadTrust, tol,
-           *d, *g, *xtemp, *gtemp, *work ;
+            ykyk, ykgk, dkyk, beta, QuadTrust, tol, gPg, gPgold,
+           *d, *g, *xtemp, *gtemp, *work, *Bns ;
 
     /* new variables added in Version 6.0 */
     int     l1, l2, j, k, mem, memsq, memk, memk_begin, mlast, mlast_sub,
             mp, mp_begin, mpp, nsub, spp, spp1, SkFstart, SkFlast, Subspace,
-            UseMemory, Restart, LBFGS, InvariantSpace, IterSub, NumSub,
+            UseMemory, Restart, LBFGS, InvariantSpace, IterSub, NumSub, memmax,
             IterSubStart, IterSubRestart, FirstFull, SubSkip, SubCheck,
             StartSkip, StartCheck, DenseCol1, NegDiag, memk_is_mem,
            d0isg, qrestart ;
@@ -136,11 +154,7 @@ int cg_descent /*  return status of solution process:
 
     cg_parameter *Parm, ParmStruc ;
     cg_com Com ;
-
-    /* assign values to the external variables */
-    one [0] = (double) 1 ;
-    zero [0] = (double) 0 ;
-    blas_one [0] = (BLAS_INT) 1 ;
+    FILE *file ;
 
     /* initialize the parameters */
     if ( UParm == NULL )
@@ -157,10 +171,84 @@ int cg_descent /*  return status of solution process:
     Com.Wolfe = FALSE ; /* initially Wolfe line search not performed */
     Com.nf = (INT) 0 ;  /* number of function evaluations */
     Com.ng = (INT) 0 ;  /* number of gradient evaluations */
+    Com.nh = (INT) 0 ;  /* number of Hessian-vector products */
+    for (i = 0; i < CG_NORIGIN; i++) /* evaluations by origin */
+    {
+        Com.Nf [i] = (INT) 0 ;
+        Com.Ng [i] = (INT) 0 ;
+    }
+    Com.iter = (INT) 0 ;
+    Com.ntrial = (INT) 0 ; /* number of line search trials recorded */
+    Com.nfirst = (INT) 0 ; /* number of first line search trials accepted */
+    Com.Tracer = NULL ;    /* no trace until the trace file is opened */
+    Com.record = NULL ;    /* no recording until RecordFile is opened */
+    Com.replay = NULL ;    /* no replay until ReplayFile is opened */
+    Com.ncall = 0 ;        /* calls of value, grad, and valgrad */
+    Com.nreplay = 0 ;      /* calls answered from the replay file */
+    Com.diverge = -1 ;     /* no replay */
+    Newton = Parm->Newton ;/* truncated Newton ignores the preconditioner */
+    Com.Precond = !Newton &&
+                  ((Parm->precond != NULL) || (Parm->PrecondDiag != NULL)) ;
+    Com.Pg = NULL ;        /* P*g, allocated below when Precond is T */
+    Com.Sparse = FALSE ;   /* set when the memory is known */
+    Com.gi = NULL ;        /* index lists of the sparse mode */
+    Com.dmark = NULL ;
+    Com.FD = FALSE ;       /* finite differences when grad, valgrad NULL */
+    Com.nfd = 0 ;
+    Com.fd_vptr = NULL ;
+    Com.fd_work = NULL ;
+    Com.fd_ncolor = 0 ;
+    Com.Diag = Parm->PrecondDiag ;
+    Com.AutoDiag = !Newton && Parm->AutoDiag && !Com.Precond ;
+    if ( Com.AutoDiag ) Com.Precond = TRUE ;
+    Com.ndiag = 0 ;
+    Com.diag_nu = ONE ;
+    Com.diag_off = FALSE ;
+    Com.AdaptMem = FALSE ; /* set when the memory is known */
+    Com.adapt_start = -1 ; /* the first window starts at iteration 1 */
+    Com.adapt_dir = 1 ;
+    Com.adapt_rate = -INF ;
+    Com.Timing = Parm->Timing || Parm->Counters || Parm->Roofline ||
+                 Parm->AdaptMemory ;
+    Com.Counters = FALSE ;
+    Com.Roofline = Parm->Roofline ;
+    Com.roof_time = ZERO ;
+    Com.Roof.bandwidth = ZERO ;
+    for (i = 0; i < CG_NROOF; i++)
+    {
+        Com.Roof.iter [i] = 0 ;
+        Com.Roof.bytes [i] = Com.Roof.flops [i] = Com.Roof.time [i] = ZERO ;
+    }
+    if ( Com.Roofline )
+    {
+        cg_work.on = TRUE ;
+        cg_work.bytes = cg_work.flops = ZERO ;
+    }
+    for (i = 0; i < CG_NCOUNT; i++) Com.pfd [i] = -1 ;
+    if ( Com.Timing )
+    {
+        Com.tphase = CG_TKERNEL ;
+        if ( Parm->Counters ) cg_perf_open (&Com) ;
+        Com.tstart = Com.tlast = cg_wtime () ;
+        for (i = 0; i < CG_TNPHASE; i++) Com.Time [i] = ZERO ;
+    }
     iter = (INT) 0 ;    /* total number of iterations */
+    IterInner = (INT) 0 ; /* inner CG iterations of truncated Newton */
     QuadF = FALSE ;     /* initially function assumed to be nonquadratic */
     NegDiag = FALSE ;   /* no negative diagonal elements in QR factorization */
     mem = Parm->memory ;/* cg_descent corresponds to mem = 0 */
+    work = NULL ;       /* nothing to free before the allocation */
+    Bns = NULL ;        /* compact L-BFGS matrices */
+    Compact = FALSE ;
+    if ( Newton )
+    {
+        mem = 0 ;       /* truncated Newton does not use the memory */
+        if ( Parm->hessvec == NULL )
+        {
+            status = 14 ;
+            goto Exit ;
+        }
+    }
 
     if ( Parm->PrintParms ) cg_printParms (Parm) ;
     if ( (mem != 0) && (mem < 3) )
@@ -171,24 +259,81 @@ int cg_descent /*  return status of solution process:
 
     /* allocate work array */
     mem = MIN (mem, n) ;
+
+    /* with the adaptive memory, the work array is sized for the largest
+       memory memmax; limited memory CG stays below n */
+    memmax = mem ;
+    Com.AdaptMem = Parm->AdaptMemory && (mem > 0) ;
+    if ( Com.AdaptMem )
+    {
+        memmax = MAX (mem, Parm->MemoryMax) ;
+        if ( Parm->LBFGS || (mem == n) ) memmax = MIN (memmax, n) ;
+        else                             memmax = MIN (memmax, n-1) ;
+    }
+    Com.memA = mem ;
+    Com.memAmax = memmax ;
     if ( Work == NULL )
     {
-        if ( mem == 0 ) /* original CG_DESCENT without memory */
+        if ( Newton ) /* 3n more for the inner CG iteration */
+        {
+            work = (double *) malloc (7*n*sizeof (double)) ;
+        }
+        else if ( mem == 0 ) /* original CG_DESCENT without memory */
         {
             work = (double *) malloc (4*n*sizeof (double)) ;
         }
         else if ( Parm->LBFGS || (mem >= n) ) /* use L-BFGS */
         {
-            work = (double *) malloc ((2*mem*(n+1)+4*n)*sizeof (double)) ;
+            work = (double *) malloc ((2*memmax*(n+1)+4*n)*sizeof (double));
         }
         else /* limited memory CG_DESCENT */
         {
-            i = (mem+6)*n + (3*mem+9)*mem + 5 ;
+            i = (memmax+6)*n + (3*memmax+9)*memmax + 5 ;
             work = (double *) malloc (i*sizeof (double)) ;
         }
     }
     else work = Work ;
-    if ( work == NULL )
+    /* the sparse mode keeps index lists of the supports of g, gtemp, and
+       d, and marks for the supports of d and gtemp; it is not used with
+       hessvec, whose dense Hd is stored in gtemp */
+    Com.Sparse = (Parm->sparsegrad != NULL) && (mem == 0) && !Newton &&
+                 !Com.Precond && (Parm->hessvec == NULL) ;
+    if ( Com.Sparse )
+    {
+        Com.gi = (INT *) malloc (3*n*sizeof (INT)) ;
+        Com.dmark = (char *) calloc (2*n, sizeof (char)) ;
+        if ( (Com.gi == NULL) || (Com.dmark == NULL) )
+        {
+            status = 10 ;
+            goto Exit ;
+        }
+        Com.gti = Com.gi + n ;
+        Com.di = Com.gti + n ;
+        Com.gmark = Com.dmark + n ;
+        Com.ngi = Com.ngti = Com.ndi = 0 ;
+    }
+    /* without grad and valgrad, the gradient is approximated by finite
+       differences of value */
+    Com.FD = (grad == NULL) && (valgrad == NULL) && !Com.Sparse ;
+    if ( Com.FD )
+    {
+        Com.n = n ;
+        Com.Parm = Parm ;
+        Com.cg_value = value ;
+        if ( cg_fdsetup (&Com) )
+        {
+            status = 10 ;
+            goto Exit ;
+        }
+    }
+    if ( Com.Precond ) Com.Pg = (double *) malloc (n*sizeof (double)) ;
+    if ( Com.AutoDiag )
+    {
+        Com.Diag = (double *) malloc (n*sizeof (double)) ;
+        if ( Com.Diag != NULL ) for (i = 0; i < n; i++) Com.Diag [i] = ONE ;
+    }
+    if ( (work == NULL) || (Com.Precond && (Com.Pg == NULL)) ||
+         (Com.AutoDiag && (Com.Diag == NULL)) )
     {
         status = 10 ;
         goto Exit ;
@@ -202,10 +347,21 @@ int cg_descent /*  return status of solution process:
     Com.gtemp = gtemp = g+n ;
     Com.n = n ;          /* problem dimension */
     Com.neps = 0 ;       /* number of times eps updated */
+    Com.neps_eval = 0 ;  /* neps at the previous evaluation */
     Com.AWolfe = Parm->AWolfe ; /* do not touch user's AWolfe */
     Com.cg_value = value ;
     Com.cg_grad = grad ;
     Com.cg_valgrad = valgrad ;
+    Com.cg_hessvec = Parm->hessvec ;
+    Com.cg_sparsegrad = Parm->sparsegrad ;
+    if ( Com.Sparse )
+    {
+        /* g, gtemp, and d start at zero, the lists are empty; the value
+           and gradient are evaluated separately */
+        cg_init (d, ZERO, 3*n) ;
+        Com.cg_valgrad = NULL ;
+    }
+    Com.FuncLine = (Parm->GradCost >= Parm->FuncLineFac*Parm->ValueCost) ;
     StopRule = Parm->StopRule ;
     LBFGS = FALSE ;
     UseMemory = FALSE ;/* do not use memory */
@@ -223,10 +379,24 @@ int cg_descent /*  return status of solution process:
         {
             LBFGS = TRUE ;      /* use L-BFGS */
             mlast = -1 ;
-            Sk = gtemp + n ;
-            Yk = Sk + mem*n ;
-            SkYk = Yk + mem*n ;
-            tau = SkYk + mem ;
+            Sk = gtemp + n ;    /* the pairs are stored modulo memmax */
+            Yk = Sk + memmax*n ;
+            SkYk = Yk + memmax*n ;
+            tau = SkYk + memmax ;
+
+            /* the compact representation is not used with a preconditioner,
+               whose y'Py would need another pass over the memory */
+            if ( Parm->LBFGSCompact && !Com.Precond )
+            {
+                Compact = TRUE ;
+                i = 2*memmax*memmax + 6*memmax ;
+                Bns = (double *) malloc (i*sizeof (double)) ;
+                if ( Bns == NULL )
+                {
+                    status = 10 ;
+                    goto Exit ;
+                }
+            }
         }
         else
         {
@@ -254,6 +424,15 @@ int cg_descent /*  return status of solution process:
             gsubtemp = gsub + mem+1 ;/* new gsub before update */
             wsub = gsubtemp + mem ;  /* mem+1 work array for triangular solve */
             vsub = wsub + mem+1 ;    /* mem work array for triangular solve */
+
+            /* the subspace tests measure g in the Euclidean norm, which
+               does not fit a preconditioned iteration; with a
+               preconditioner, only the full space iterations are used */
+            if ( Com.Precond )
+            {
+                UseMemory = FALSE ;
+                FirstFull = FALSE ;
+            }
         }
     }
 
@@ -270,9 +449,23 @@ int cg_descent /*  return status of solution process:
     Ck = ZERO ;
     Qk = ZERO ;
 
+    /* open the trace file, if it can not be opened, there is no trace */
+    if ( Parm->TraceFile != NULL ) Com.Tracer = cg_trace_open (Parm->TraceFile);
+
+    /* open the record and replay files */
+    if ( Parm->RecordFile != NULL )
+    {
+        Com.record = cg_replay_open (Parm->RecordFile, TRUE, &Com) ;
+    }
+    if ( (Parm->ReplayFile != NULL) && !Com.Sparse )
+    {
+        Com.replay = cg_replay_open (Parm->ReplayFile, FALSE, &Com) ;
+        if ( Com.replay != NULL ) Com.diverge = 0 ;
+    }
+
     /* initial function and gradient evaluations, initial direction */
     Com.alpha = ZERO ;
-    status = cg_evaluate ("fg", "n", &Com) ;
+    status = cg_evaluate ("fg", "n", CG_INIT, &Com) ;
     f = Com.f ;
     if ( status )
     {
@@ -286,7 +479,8 @@ int cg_descent /*  return status of solution process:
 
     /* set d = -g, compute gnorm  = infinity norm of g and
                            gnorm2 = square of 2-norm of g */
-    gnorm = cg_update_inf2 (g, g, d, &gnorm2, n) ;
+    if ( Com.Sparse ) gnorm = cg_sparse_restart (&gnorm2, FALSE, &Com) ;
+    else              gnorm = cg_update_inf2 (g, g, d, &gnorm2, n) ;
     dnorm2 = gnorm2 ;
 
     /* check if the starting function value is nan */
@@ -305,6 +499,10 @@ int cg_descent /*  return status of solution process:
         printf ("iter: %5i f: %13.6e gnorm: %13.6e memk: %i\n",
         (int) 0, f, gnorm, memk) ;
     }
+    if ( Com.Tracer != NULL )
+    {
+        cg_trace_iter (ZERO, f, gnorm, -gnorm2, FALSE, memk, &Com) ;
+    }
 
     if ( cg_tol (gnorm, &Com) )
     {
@@ -313,17 +511,48 @@ int cg_descent /*  return status of solution process:
         goto Exit ;
     }
 
-    dphi0 = -gnorm2 ;
+    /* the curvature d'Hd and |Hd|^2, set by cg_hess when HessOK is T */
+    dHd = ZERO ;
+    HdHd = ZERO ;
+
+    /* with a preconditioner, d = -Pg and the starting step is based on
+       d in place of g; gPgold and t1 = g'P*gtemp are set with gPg at each
+       preconditioned step */
+    gPg = ZERO ;
+    gPgold = ZERO ;
+    t1 = ZERO ;
+    if ( Com.Precond )
+    {
+        gPg = cg_precond (Com.Pg, g, &Com) ;
+        cg_scale (d, Com.Pg, -ONE, n) ;
+        dnorm2 = cg_dot (d, d, n) ;
+        dphi0 = -gPg ;
+        t = cg_inf (d, n) ;
+    }
+    else
+    {
+        dphi0 = -gnorm2 ;
+        t = gnorm ;
+    }
+
+    /* truncated Newton direction, the work array follows gtemp */
+    if ( Newton )
+    {
+        IterInner += cg_newton (d, g, gnorm2, gtemp+n, &Com) ;
+        dnorm2 = cg_dot (d, d, n) ;
+        dphi0 = cg_dot (g, d, n) ;
+        t = cg_inf (d, n) ;
+    }
     delta2 = 2*Parm->delta - ONE ;
     alpha = Parm->step ;
     if ( alpha == ZERO )
     {
         if ( xnorm == ZERO )
         {
-            if ( f != ZERO ) alpha = 2.*fabs (f)/gnorm2 ;
+            if ( f != ZERO ) alpha = 2.*fabs (f)/(-dphi0) ;
             else             alpha = ONE ;
         }
-        else    alpha = Parm->psi0*xnorm/gnorm ;
+        else    alpha = Parm->psi0*xnorm/t ;
     }
 
     Com.df0 = -2.0*fabs(f)/alpha ;
@@ -337,6 +566,13 @@ int cg_descent /*  return status of solution process:
     scale = (double) 1 ; /* scale is the initial approximation to inverse
                             Hessian in LBFGS; after the initial iteration,
                             scale is estimated by the BB formula */
+    PredN = 0 ;          /* number of steps in the step prediction average */
+    PredMean = ZERO ;    /* average of log (accepted step/base step) */
+    PredVar = ZERO ;     /* its variance */
+    PredDphi = ZERO ;    /* dphi0 in the previous iteration */
+    PredCost = -ONE ;    /* average cost of an iteration starting from the
+                            predicted step, negative until measured */
+    QuadCost = -ONE ;    /* average cost of the other iterations */
 
     /* Start the conjugate gradient iteration.
        alpha starts as old step, ends as final step for current iteration
@@ -345,23 +581,91 @@ int cg_descent /*  return status of solution process:
 
     for (iter = 1; iter <= maxit; iter++)
     {
+        Com.iter = iter ;
+        if ( Com.AdaptMem ) cg_adapt (gnorm, &Com) ;
         /* save old alpha to simplify formula computing subspace direction */
         alphaold = alpha ;
         Com.QuadOK = FALSE ;
         alpha = Parm->psi2*alpha ;
+
+        /* the base step assumes the same first order change in f as in the
+           previous iteration, the learned correction exp (PredMean) is then
+           applied. When the prediction is reliable, it replaces the
+           QuadStep probe if the measured cost of the iterations started
+           from the prediction is smaller. Every 10th iteration the other
+           choice is tried to keep both costs up to date. When the function
+           appears quadratic, the QuadStep is always used since CG needs an
+           accurate line minimum there. */
+        Predict = FALSE ;
+        PredBase = ZERO ;
+        IterCost = Parm->ValueCost*Com.nf + Parm->GradCost*Com.ng ;
+        if ( Parm->PredictStep && Parm->QuadStep && (PredDphi < ZERO) &&
+             (Com.cg_hessvec == NULL) && !QuadF )
+        {
+            t = PredDphi/dphi0 ;
+            t = MAX (t, .1) ;
+            t = MIN (t, 10.) ;
+            PredBase = alphaold*t ;
+            if ( (PredN >= 3) &&
+                 (PredVar <= Parm->PredictTol*Parm->PredictTol) )
+            {
+                if      ( PredCost < ZERO ) Predict = TRUE ;
+                else if ( QuadCost < ZERO ) Predict = FALSE ;
+                else                        Predict = (PredCost <= QuadCost) ;
+                if ( iter % 10 == 0 ) Predict = !Predict ;
+                if ( Predict ) alpha = PredBase*exp (PredMean) ;
+            }
+        }
+        PredDphi = dphi0 ;
         if ( f != ZERO ) t = fabs ((f-Com.f0)/f) ;
         else             t = ONE ;
         Com.UseCubic = TRUE ;
         if ( (t < Parm->CubicCutOff) || !Parm->UseCubic ) Com.UseCubic = FALSE ;
-        if ( Parm->QuadStep )
+
+        /* if the Hessian is available, compute the curvature d'Hd */
+        HessOK = FALSE ;
+        if ( (Com.cg_hessvec != NULL) && !Newton )
+        {
+            dHd = cg_hess (&HdHd, &dd, &Com) ;
+            if ( dHd > ZERO ) HessOK = TRUE ;
+        }
+        if ( Newton ) /* start the line search from the Newton step */
+        {
+            alpha = ONE ;
+            Com.QuadOK = TRUE ;
+        }
+        else if ( Parm->QuadStep )
         {
+            /* positive curvature gives the exact quadratic step */
+            if ( HessOK )
+            {
+                alpha = -dphi0/dHd ;
+                Com.QuadOK = TRUE ;
+                if ( PrintLevel >= 1 )
+                {
+                    printf ("Hessian step %14.6e OK (dHd = %14.6e)\n",
+                             alpha, dHd) ;
+                }
+            }
+            /* the learned step is reliable, skip the probe */
+            else if ( Predict )
+            {
+                Com.QuadOK = TRUE ;
+                if ( PrintLevel >= 1 )
+                {
+                    printf ("Predicted step %14.6e OK (mean: %10.3e var: "
+                            "%10.3e)\n", alpha, PredMean, PredVar) ;
+                }
+            }
             /* test if quadratic interpolation step should be tried */
-            if ( ((t > Parm->QuadCutOff)&&(fabs(f) >= Com.SmallCost)) || QuadF )
+            else if ( ((t > Parm->QuadCutOff)&&(fabs(f) >= Com.SmallCost))
+                      || QuadF )
             {
-                if ( QuadF )
+                /* the gradient probe is skipped when gradients are costly */
+                if ( QuadF && !Com.FuncLine )
                 {
                     Com.alpha = Parm->psi1*alpha ;
-                    status = cg_evaluate ("g", "y", &Com) ;
+                    status = cg_evaluate ("g", "y", CG_QUAD, &Com) ;
                     if ( status ) goto Exit ;
                     if ( Com.df > dphi0 )
                     {
@@ -391,7 +695,7 @@ int cg_descent /*  return status of solution process:
                 {
                     t = MAX (Parm->psi_lo, Com.df0/(dphi0*Parm->psi2)) ;
                     Com.alpha = MIN (t, Parm->psi_hi)*alpha ;
-                    status = cg_evaluate ("f", "y", &Com) ;
+                    status = cg_evaluate ("f", "y", CG_QUAD, &Com) ;
                     if ( status ) goto Exit ;
                     ftemp = Com.f ;
                     denom = 2.*(((ftemp-f)/Com.alpha)-dphi0) ;
@@ -440,8 +744,13 @@ int cg_descent /*  return status of solution process:
         Com.awolfe_hi = delta2*dphi0 ;
         Com.alpha = alpha ;
 
-        /* perform line search */
-        status = cg_line (&Com) ;
+        /* perform line search, cg_lineF returns -1 when it needs cg_line.
+           Once the approximate Wolfe conditions are used, function values
+           are not accurate enough for cg_lineF. */
+        if ( Com.Timing ) cg_clock (CG_TLINE, &Com) ;
+        status = -1 ;
+        if ( Com.FuncLine && !Com.AWolfe ) status = cg_lineF (&Com) ;
+        if ( status < 0 ) status = cg_line (&Com) ;
 
         /*try approximate Wolfe line search if ordinary Wolfe fails */
         if ( (status > 0) && !Com.AWolfe )
@@ -456,6 +765,7 @@ int cg_descent /*  return status of solution process:
                 status = cg_line (&Com) ;
             }
         }
+        if ( Com.Timing ) cg_clock (CG_TKERNEL, &Com) ;
 
         alpha = Com.alpha ;
         f = Com.f ;
@@ -463,6 +773,29 @@ int cg_descent /*  return status of solution process:
 
         if ( status ) goto Exit ;
 
+        /* update the running average and variance of log (alpha/PredBase) */
+        if ( PredBase > ZERO )
+        {
+            PredN++ ;
+            t1 = MAX (ONE/PredN, Parm->PredictRate) ;
+            t = log (alpha/PredBase) - PredMean ;
+            PredMean += t1*t ;
+            PredVar = (ONE - t1)*(PredVar + t1*t*t) ;
+
+            /* cost of the iteration */
+            t = Parm->ValueCost*Com.nf + Parm->GradCost*Com.ng - IterCost ;
+            if ( Predict )
+            {
+                if ( PredCost < ZERO ) PredCost = t ;
+                else PredCost += Parm->PredictRate*(t - PredCost) ;
+            }
+            else
+            {
+                if ( QuadCost < ZERO ) QuadCost = t ;
+                else QuadCost += Parm->PredictRate*(t - QuadCost) ;
+            }
+        }
+
         /* Test for convergence to within machine epsilon
            [set feps to zero to remove this test] */
 
@@ -475,7 +808,9 @@ int cg_descent /*  return status of solution process:
         /* test how close the cost function changes are to that of a quadratic
            QuadTrust = 0 means the function change matches that of a quadratic*/
         t = alpha*(dphi+dphi0) ;
-        if ( fabs (t) <= Parm->qeps*MIN (Ck, ONE) ) QuadTrust = ZERO ;
+        /* with the Hessian, compare the change in slope to the curvature */
+        if ( HessOK ) QuadTrust = fabs (((dphi-dphi0)/(alpha*dHd))-ONE) ;
+        else if ( fabs (t) <= Parm->qeps*MIN (Ck, ONE) ) QuadTrust = ZERO ;
         else QuadTrust = fabs((2.0*(f-Com.f0)/t)-ONE) ;
         if ( QuadTrust <= Parm->qrule) IterQuad++ ;
         else                           IterQuad = 0 ;
@@ -491,7 +826,10 @@ int cg_descent /*  return status of solution process:
             }
         }
 
-        if ( (mem > 0) && !LBFGS )
+        /* the memory update and the L-BFGS or subspace direction are timed
+           as subspace linear algebra */
+        if ( Com.Timing && (mem > 0) ) cg_clock (CG_TSUB, &Com) ;
+        if ( (mem > 0) && !LBFGS && !Com.Precond )
         {
             if ( UseMemory )
             {
@@ -574,6 +912,9 @@ int cg_descent /*  return status of solution process:
             else  /* in full space */
             {
                 if ( (IterRestart == 1) || FirstFull ) memk = 0 ;
+
+                /* a new memory size from cg_adapt restarts the memory */
+                if ( mem != Com.memA ) memk = 0 ;
                 if ( (memk == 1) && InvariantSpace )
                 {
                      memk = 0 ;
@@ -589,6 +930,27 @@ int cg_descent /*  return status of solution process:
                        it is needed, we use SkF * inv (Rk) */
                     if (memk == 0)
                     {
+                        if ( mem != Com.memA )
+                        {
+                            /* lay out the memory for the new size, the work
+                               array has room for memmax */
+                            mem = Com.memA ;
+                            memsq = mem*mem ;
+                            stemp = SkF + mem*n ;
+                            gkeep = stemp + n ;
+                            Sk = gkeep + n ;
+                            Rk = Sk + memsq ;
+                            cg_init (Rk, ZERO, memsq) ;
+                            Re = Rk + memsq ;
+                            Yk = Re + mem+1 ;
+                            SkYk = Yk + memsq+mem+2 ;
+                            tau = SkYk + mem ;
+                            dsub = tau + mem ;
+                            gsub = dsub + mem ;
+                            gsubtemp = gsub + mem+1 ;
+                            wsub = gsubtemp + mem ;
+                            vsub = wsub + mem+1 ;
+                        }
                         mlast = 0 ;  /* starting pointer in the memory */
                         memk = 1 ;   /* dimension of current subspace */
  
@@ -970,7 +1332,26 @@ int cg_descent /*  return status of solution process:
         } /* done using the memory */
 
         /* compute search direction */
-        if ( LBFGS )
+        if ( Newton )
+        {
+            /* set x = xtemp */
+            cg_copy (x, xtemp, n) ;
+
+            /* set g = gtemp, compute infinity and 2-norm of g */
+            gnorm = cg_update_inf2 (g, gtemp, d, &gnorm2, n) ;
+
+            if ( cg_tol (gnorm, &Com) )
+            {
+                status = 0 ;
+                goto Exit ;
+            }
+            k = cg_newton (d, g, gnorm2, gtemp+n, &Com) ;
+            IterInner += k ;
+            if ( PrintLevel >= 1 ) printf ("Newton: %i inner iterations\n", k);
+            dnorm2 = cg_dot (d, d, n) ;
+            dphi0 = cg_dot (g, d, n) ;
+        }
+        else if ( LBFGS )
         {
             gnorm = cg_inf (gtemp, n) ;
             if ( cg_tol (gnorm, &Com) )
@@ -996,15 +1377,34 @@ int cg_descent /*  return status of solution process:
 
                 dnorm2 = gnorm2 ;
                 dphi0 = -gnorm2 ;
+                if ( Com.Precond ) /* d = -Pg */
+                {
+                    gPg = cg_precond (Com.Pg, g, &Com) ;
+                    cg_scale (d, Com.Pg, -ONE, n) ;
+                    dnorm2 = cg_dot (d, d, n) ;
+                    dphi0 = -gPg ;
+                }
             }
             else
             {
-                mlast = (mlast+1) % mem ;
+                mlast = (mlast+1) % memmax ;
                 spp = mlast*n ;
                 cg_step (Sk+spp, xtemp, x, -ONE, n) ;
                 cg_step (Yk+spp, gtemp, g, -ONE, n) ;
                 SkYk [mlast] = alpha*(dphi-dphi0) ;
+
+                /* the newest mem pairs are used; when cg_adapt reduced mem,
+                   the oldest pairs are dropped, when it increased mem, the
+                   memory grows by one pair per iteration */
+                mem = Com.memA ;
+                shift = memk + 1 ; /* number of oldest pairs dropped */
                 if (memk < mem) memk++ ;
+                else            memk = mem ;
+                shift -= memk ;
+                if ( Com.AutoDiag )
+                {
+                    cg_autodiag (d, g, gtemp, alpha, SkYk [mlast], &Com) ;
+                }
 
                 /* copy xtemp to x */
                 cg_copy (x, xtemp, n) ;
@@ -1012,38 +1412,68 @@ int cg_descent /*  return status of solution process:
                 /* copy gtemp to g and compute 2-norm of g */
                 gnorm2 = cg_update_2 (g, gtemp, NULL, n) ;
 
-                /* calculate Hg = H g, saved in gtemp */
-                mp = mlast ;  /* memk is the number of vectors in the memory */
-                for (j = 0; j < memk; j++)
+                if ( Compact ) /* compact representation of H */
                 {
-                    mpp = mp*n ;
-                    t = cg_dot (Sk+mpp, gtemp, n)/SkYk[mp] ;
-                    tau [mp] = t ;
-                    cg_daxpy (gtemp, Yk+mpp, -t, n) ;
-                    mp -=  1;
-                    if ( mp < 0 ) mp = mem-1 ;
+                    dphi0 = cg_bns (d, g, gnorm2, &dnorm2, &scale,
+                                    (HessOK) ? dHd/HdHd : ZERO, Sk, Yk, Bns,
+                                    mlast, memk, memmax, shift, n) ;
                 }
-                /* scale = (alpha*dnorm2)/(dphi-dphi0) ; */
-                t = cg_dot (Yk+mlast*n, Yk+mlast*n, n) ;
-                if ( t > ZERO )
+                else /* two-loop recursion */
                 {
-                    scale = SkYk[mlast]/t ;
-                }
+                    /* calculate Hg = H g, saved in gtemp; memk is the
+                       number of vectors in the memory */
+                    mp = mlast ;
+                    for (j = 0; j < memk; j++)
+                    {
+                        mpp = mp*n ;
+                        t = cg_dot (Sk+mpp, gtemp, n)/SkYk[mp] ;
+                        tau [mp] = t ;
+                        cg_daxpy (gtemp, Yk+mpp, -t, n) ;
+                        mp -=  1;
+                        if ( mp < 0 ) mp = memmax-1 ;
+                    }
+                    /* scale = (alpha*dnorm2)/(dphi-dphi0) ; */
+                    if ( Com.Precond ) /* initial matrix scale*P */
+                    {
+                        t = cg_precond (Com.Pg, Yk+mlast*n, &Com) ; /* y'Py */
+                        if ( t > ZERO )
+                        {
+                            scale = SkYk[mlast]/t ;
+                        }
+                        cg_precond (Com.Pg, gtemp, &Com) ;
+                        cg_scale (gtemp, Com.Pg, scale, n) ;
+                    }
+                    else
+                    {
+                        if ( HessOK ) /* s'y/y'y with y = alpha*Hd */
+                        {
+                            scale = dHd/HdHd ;
+                        }
+                        else
+                        {
+                            t = cg_dot (Yk+mlast*n, Yk+mlast*n, n) ;
+                            if ( t > ZERO )
+                            {
+                                scale = SkYk[mlast]/t ;
+                            }
+                        }
 
-                cg_scale (gtemp, gtemp, scale, n) ;
+                        cg_scale (gtemp, gtemp, scale, n) ;
+                    }
 
-                for (j = 0; j < memk; j++)
-                {
-                    mp +=  1 ;
-                    if ( mp == mem ) mp = 0 ;
-                    mpp = mp*n ;
-                    t = cg_dot (Yk+mpp, gtemp, n)/SkYk[mp] ;
-                    cg_daxpy (gtemp, Sk+mpp, tau [mp]-t, n) ;
-                }
+                    for (j = 0; j < memk; j++)
+                    {
+                        mp +=  1 ;
+                        if ( mp == memmax ) mp = 0 ;
+                        mpp = mp*n ;
+                        t = cg_dot (Yk+mpp, gtemp, n)/SkYk[mp] ;
+                        cg_daxpy (gtemp, Sk+mpp, tau [mp]-t, n) ;
+                    }
 
-                /* set d = -gtemp, compute 2-norm of gtemp */
-                dnorm2 = cg_update_2 (NULL, gtemp, d, n) ;
-                dphi0 = -cg_dot (g, gtemp, n) ;
+                    /* set d = -gtemp, compute 2-norm of gtemp */
+                    dnorm2 = cg_update_2 (NULL, gtemp, d, n) ;
+                    dphi0 = -cg_dot (g, gtemp, n) ;
+                }
             }
         } /* end of LBFGS */
 
@@ -1105,11 +1535,21 @@ int cg_descent /*  return status of solution process:
                        set gsub = gsubtemp */
                     cg_Yk (Yk+spp, gsub, gsubtemp, &yty, nsub) ;
                     SkYk [mlast_sub] = alpha*(dphi - dphi0) ;
-                    if ( yty > ZERO )
+                    if ( HessOK )
+                    {
+                        /* Hd does not lie in the subspace, use the
+                           Rayleigh quotient of the projected Hessian */
+                        scale = dd/dHd ;
+                    }
+                    else if ( yty > ZERO )
                     {
                         scale = SkYk [mlast_sub]/yty ;
                     }
                 }
+                else if ( HessOK )
+                {
+                    scale = dd/dHd ;
+                }
                 else
                 {
                     yty = cg_dot0 (Yk+mlast_sub*mem, Yk+mlast_sub*mem, nsub) ;
@@ -1207,6 +1647,7 @@ int cg_descent /*  return status of solution process:
         } /* end of subspace search direction */
         else  /* compute the search direction in the full space */
         {
+            if ( Com.Timing ) cg_clock (CG_TKERNEL, &Com) ;
             if ( Restart ) /*restart in fullspace*/
             {
                 Restart = FALSE ;
@@ -1215,7 +1656,8 @@ int cg_descent /*  return status of solution process:
                 if ( PrintLevel >= 1 ) printf ("RESTART CG\n") ;
 
                 /* set x = xtemp */
-                cg_copy (x, xtemp, n) ;
+                if ( Com.Sparse ) cg_sparse_copy (&Com) ;
+                else              cg_copy (x, xtemp, n) ;
 
                 if ( UseMemory )
                 {
@@ -1223,6 +1665,11 @@ int cg_descent /*  return status of solution process:
                       gnorm2 was already computed above */
                    gnorm = cg_update_inf (g, gtemp, d, n) ;
                 }
+                else if ( Com.Sparse )
+                {
+                    /* the support of d restarts from the support of g */
+                    gnorm = cg_sparse_restart (&gnorm2, TRUE, &Com) ;
+                }
                 else
                 {
                     /* set g = gtemp, d = -g, compute infinity and 2-norm of g*/
@@ -1237,15 +1684,39 @@ int cg_descent /*  return status of solution process:
                 dphi0 = -gnorm2 ;
                 dnorm2 = gnorm2 ;
                 beta = ZERO ;
+                if ( Com.Precond ) /* d = -Pg */
+                {
+                    gPg = cg_precond (Com.Pg, g, &Com) ;
+                    cg_scale (d, Com.Pg, -ONE, n) ;
+                    dnorm2 = cg_dot (d, d, n) ;
+                    dphi0 = -gPg ;
+                }
             }
             else if ( !FirstFull ) /* normal fullspace step*/
             {
                 /* set x = xtemp */
-                cg_copy (x, xtemp, n) ;
+                if ( Com.Sparse ) cg_sparse_copy (&Com) ;
+                else              cg_copy (x, xtemp, n) ;
+
+                /* with a preconditioner, Pg = P*gtemp and t1 = g'P*gtemp
+                   are computed before g is overwritten */
+                if ( Com.Precond )
+                {
+                    /* an update of the automatic scaling changes g'Pg */
+                    if ( Com.AutoDiag )
+                    {
+                        gPgold = cg_autodiag (d, g, gtemp, alpha,
+                                              alpha*(dphi-dphi0), &Com) ;
+                    }
+                    else gPgold = gPg ;
+                    gPg = cg_precond (Com.Pg, gtemp, &Com) ;
+                    t1 = cg_dot (g, Com.Pg, n) ;
+                }
 
                 /* set g = gtemp, compute gnorm = infinity norm of g,
                    ykyk = ||gtemp-g||_2^2, and ykgk = (gtemp-g) dot gnew */
-                gnorm = cg_update_ykyk (g, gtemp, &ykyk, &ykgk, n) ;
+                if ( Com.Sparse ) gnorm = cg_sparse_ykyk (&ykyk, &ykgk, &Com) ;
+                else gnorm = cg_update_ykyk (g, gtemp, &ykyk, &ykgk, n) ;
 
                 if ( cg_tol (gnorm, &Com) )
                 {
@@ -1256,32 +1727,61 @@ int cg_descent /*  return status of solution process:
                 dkyk = dphi - dphi0 ;
                 if ( Parm->AdaptiveBeta ) t = 2. - ONE/(0.1*QuadTrust + ONE) ;
                 else                      t = Parm->theta ;
-                beta = (ykgk - t*dphi*ykyk/dkyk)/dkyk ;
-
-                /* faster: initialize dnorm2 = gnorm2 at start, then
-                           dnorm2 = gnorm2 + beta**2*dnorm2 - 2.*beta*dphi
-                           gnorm2 = ||g_{k+1}||^2
-                           dnorm2 = ||d_{k+1}||^2
-                           dpi = g_{k+1}' d_k */
-
-                /* lower bound for beta is BetaLower*d_k'g_k/ ||d_k||^2 */
-                beta = MAX (beta, Parm->BetaLower*dphi0/dnorm2) ;
-
-                /* update search direction d = -g + beta*dold */
-                if ( UseMemory )
+                if ( Com.Precond )
                 {
-                    /* update search direction d = -g + beta*dold, and
-                       compute 2-norm of d, 2-norm of g computed above */
-                    dnorm2 = cg_update_d (d, g, beta, NULL, n) ;
+                    /* preconditioned beta, y'Pg and y'Py replace y'g and
+                       y'y. The lower bound below needs d'inv(P)d and is not
+                       used, instead d = -Pg if d is not a descent direction */
+                    ykgk = gPg - t1 ;
+                    ykyk = gPg - 2.*t1 + gPgold ;
+                    beta = (ykgk - t*dphi*ykyk/dkyk)/dkyk ;
+
+                    /* update search direction d = -Pg + beta*dold */
+                    dnorm2 = cg_update_d (d, Com.Pg, beta, NULL, n) ;
+                    if ( !UseMemory ) gnorm2 = cg_dot (g, g, n) ;
+                    dphi0 = -gPg + beta*dphi ;
+                    if ( dphi0 >= ZERO )
+                    {
+                        cg_scale (d, Com.Pg, -ONE, n) ;
+                        dnorm2 = cg_dot (d, d, n) ;
+                        dphi0 = -gPg ;
+                        beta = ZERO ;
+                    }
                 }
                 else
                 {
-                    /* update search direction d = -g + beta*dold, and
-                       compute 2-norms of d and g */
-                    dnorm2 = cg_update_d (d, g, beta, &gnorm2, n) ;
-                }
+                    beta = (ykgk - t*dphi*ykyk/dkyk)/dkyk ;
+
+                    /* faster: initialize dnorm2 = gnorm2 at start, then
+                               dnorm2 = gnorm2 + beta**2*dnorm2 - 2.*beta*dphi
+                               gnorm2 = ||g_{k+1}||^2
+                               dnorm2 = ||d_{k+1}||^2
+                               dpi = g_{k+1}' d_k */
+
+                    /* lower bound for beta is BetaLower*d_k'g_k/ ||d_k||^2 */
+                    beta = MAX (beta, Parm->BetaLower*dphi0/dnorm2) ;
+
+                    /* update search direction d = -g + beta*dold */
+                    if ( UseMemory )
+                    {
+                        /* update search direction d = -g + beta*dold, and
+                           compute 2-norm of d, 2-norm of g computed above */
+                        dnorm2 = cg_update_d (d, g, beta, NULL, n) ;
+                    }
+                    else if ( Com.Sparse )
+                    {
+                        /* the nonzeros of g are added to the support of d */
+                        dnorm2 = cg_sparse_d (beta, &gnorm2, &Com) ;
+                    }
+                    else
+                    {
+                        /* update search direction d = -g + beta*dold, and
+                           compute 2-norms of d and g */
+                        dnorm2 = cg_update_d (d, g, beta, &gnorm2, n) ;
+                    }
 
-                dphi0 = -gnorm2 + beta*dphi ;
+                    dphi0 = -gnorm2 + beta*dphi ;
+                }
                 if ( Parm->debug ) /* Check that dphi0 = d'g */
                 {
                     t = ZERO ;
@@ -1319,7 +1819,11 @@ int cg_descent /*  return status of solution process:
                 SkYk [mlast_sub] = t ;
 
                 /* scale = t/ykyk ; */
-                if ( yty > ZERO )
+                if ( HessOK )
+                {
+                    scale = dd/dHd ;
+                }
+                else if ( yty > ZERO )
                 {
                     scale = t/yty ;
                 }
@@ -1401,7 +1905,11 @@ int cg_descent /*  return status of solution process:
                 if ( Parm->AdaptiveBeta ) t = 2. - ONE/(0.1*QuadTrust + ONE) ;
                 else                      t = Parm->theta ;
                 t1 = MAX(ykyk-yty, ZERO) ; /* Theoretically t1 = ykyk-yty */
-                if ( ykyk > ZERO )
+                if ( HessOK )
+                {
+                    scale = dHd/HdHd ; /* = sigma */
+                }
+                else if ( ykyk > ZERO )
                 {
                     scale = (alpha*dkyk)/ykyk ; /* = sigma */
                 }
@@ -1444,6 +1952,16 @@ int cg_descent /*  return status of solution process:
                 dnorm2 = cg_dot (d, d, n) ;
             }  /* end of preconditioned step */
         }  /* search direction has been computed */
+        if ( Com.Timing ) cg_clock (CG_TKERNEL, &Com) ;
+        if ( Com.Roofline )
+        {
+            if      ( Newton )   k = CG_RNEWTON ;
+            else if ( mem == 0 ) k = CG_RCG ;
+            else if ( LBFGS )    k = CG_RLBFGS ;
+            else if ( Subspace ) k = CG_RSUB ;
+            else                 k = CG_RFULL ;
+            cg_roof (k, &Com) ;
+        }
 
         /* test for slow convergence */
         if ( (f < fbest) || (gnorm2 < gbest) )
@@ -1479,18 +1997,83 @@ int cg_descent /*  return status of solution process:
            status = 5 ;
            goto Exit ;
         }
+
+        if ( Com.Tracer != NULL )
+        {
+            cg_trace_iter (alpha, f, gnorm, dphi0, Subspace, memk, &Com) ;
+        }
+
+        if ( Parm->monitor != NULL )
+        {
+            if ( Parm->monitor (Parm->MonitorData, iter, f, gnorm, alpha,
+                                dphi0) )
+            {
+                status = 13 ;
+                goto Exit ;
+            }
+        }
     }
     status = 2 ;
 Exit:
     if ( status == 11 ) gnorm = INF ; /* function is undefined */
+    if ( Com.Timing ) cg_clock (CG_TKERNEL, &Com) ;
+    if ( Com.Roofline )
+    {
+        cg_roof (CG_RSETUP, &Com) ;
+        cg_work.on = FALSE ;
+        if ( (Stat != NULL) || Parm->PrintFinal || (PrintLevel >= 1) )
+        {
+            Com.Roof.bandwidth = cg_bandwidth (n) ;
+        }
+    }
     if ( Stat != NULL )
     {
+        if ( Com.Timing )
+        {
+            Stat->time.total = Com.tlast - Com.tstart ;
+            Stat->time.value = Com.Time [CG_TVALUE] ;
+            Stat->time.grad = Com.Time [CG_TGRAD] ;
+            Stat->time.valgrad = Com.Time [CG_TVALGRAD] ;
+            Stat->time.hessvec = Com.Time [CG_THESSVEC] ;
+            Stat->time.kernel = Com.Time [CG_TKERNEL] ;
+            Stat->time.line = Com.Time [CG_TLINE] ;
+            Stat->time.sub = Com.Time [CG_TSUB] ;
+        }
+        else
+        {
+            Stat->time.total = Stat->time.value = Stat->time.grad =
+            Stat->time.valgrad = Stat->time.hessvec = Stat->time.kernel =
+            Stat->time.line = Stat->time.sub = ZERO ;
+        }
+        Stat->ncounter = 0 ;
+        for (i = 0; i < CG_NCOUNT; i++)
+        {
+            if ( Com.pfd [i] >= 0 ) Stat->ncounter++ ;
+        }
+        cg_perf_stats (&Stat->cycles, Com.Count [CG_CYCLES], Com.pfd [0]) ;
+        cg_perf_stats (&Stat->instr,  Com.Count [CG_INSTR],  Com.pfd [1]) ;
+        cg_perf_stats (&Stat->misses, Com.Count [CG_MISSES], Com.pfd [2]) ;
+        Stat->roof = Com.Roof ;
         Stat->nfunc = Com.nf ;
         Stat->ngrad = Com.ng ;
+        Stat->nhess = Com.nh ;
+        Stat->nfdeval = Com.nfd ;
+        Stat->nfdgroup = Com.fd_ncolor ;
+        Stat->IterInner = IterInner ;
+        Stat->memory = mem ;
+        Stat->nreplay = Com.nreplay ;
+        Stat->replay_diverge = Com.diverge ;
+        for (i = 0; i < CG_NORIGIN; i++)
+        {
+            Stat->nfunc_origin [i] = Com.Nf [i] ;
+            Stat->ngrad_origin [i] = Com.Ng [i] ;
+        }
+        Stat->cost = Parm->ValueCost*Com.nf + Parm->GradCost*Com.ng ;
+        Stat->nfirst = Com.nfirst ;
         Stat->iter = iter ;
         Stat->NumSub = NumSub ;
         Stat->IterSub = IterSub ;
-        if ( status < 10 ) /* function was evaluated */
+        if ( (status < 10) || (status == 13) ) /* function was evaluated */
         {
             Stat->f = f ;
             Stat->gnorm = gnorm ;
@@ -1599,19 +2182,174 @@ Exit:
                      Parm->memory) ;
             printf ("memory should be either 0 or greater than 2\n\n") ;
         }
+        else if ( status == 13 )
+        {
+            printf ("Stopped by the monitor routine\n\n") ;
+        }
+        else if ( status == 14 )
+        {
+            printf ("Newton is T but the routine hessvec is NULL\n\n") ;
+        }
 
         printf ("maximum norm for gradient: %13.6e\n", gnorm) ;
         printf ("function value:            %13.6e\n\n", f) ;
         printf ("iterations:              %10.0f\n", (double) iter) ;
         printf ("function evaluations:    %10.0f\n", (double) Com.nf) ;
         printf ("gradient evaluations:    %10.0f\n", (double) Com.ng) ;
+        if ( Com.nh > 0 )
+        {
+            printf ("Hessian-vector products: %10.0f\n", (double) Com.nh) ;
+        }
+        if ( Com.FD )
+        {
+            printf ("finite difference evals: %10.0f (%.0f groups)\n",
+                    (double) Com.nfd, (double) Com.fd_ncolor) ;
+        }
+        if ( Newton )
+        {
+            printf ("inner CG iterations:     %10.0f\n", (double) IterInner) ;
+        }
+        if ( Com.AdaptMem )
+        {
+            printf ("memory at the end:       %10i\n", mem) ;
+        }
+        if ( (Parm->ValueCost != ONE) || (Parm->GradCost != ONE) )
+        {
+            printf ("weighted cost:           %10.0f\n",
+                     Parm->ValueCost*Com.nf + Parm->GradCost*Com.ng) ;
+        }
+        if ( Parm->PredictStep && (iter > 0) )
+        {
+            printf ("first trial accepted:    %10.1f%%\n",
+                     100.*Com.nfirst/iter) ;
+        }
         if ( IterSub > 0 )
         {
             printf ("subspace iterations:     %10.0f\n", (double) IterSub) ;
             printf ("number of subspaces:     %10.0f\n", (double) NumSub) ;
         }
+        if ( Com.diverge >= 0 )
+        {
+            printf ("replayed evaluations:    %10.0f\n", (double) Com.nreplay);
+            if ( Com.diverge > 0 )
+            {
+                printf ("replay diverged at call: %10.0f\n",
+                        (double) Com.diverge) ;
+            }
+        }
+        if ( PrintLevel >= 1 )
+        {
+            printf ("\nevaluations by origin:       func       grad\n") ;
+            for (i = 0; i < CG_NORIGIN; i++)
+            {
+                if ( (Com.Nf [i] == 0) && (Com.Ng [i] == 0) ) continue ;
+                printf ("   %-22s %10.0f %10.0f\n", cg_phase [i],
+                        (double) Com.Nf [i], (double) Com.Ng [i]) ;
+            }
+        }
+        if ( Com.Timing )
+        {
+            printf ("\ntime in seconds:\n") ;
+            printf ("   total:                %13.6e\n", Com.tlast-Com.tstart);
+            printf ("   value:                %13.6e\n", Com.Time [CG_TVALUE]);
+            printf ("   grad:                 %13.6e\n", Com.Time [CG_TGRAD]) ;
+            printf ("   valgrad:              %13.6e\n",
+                     Com.Time [CG_TVALGRAD]) ;
+            if ( Com.nh > 0 )
+            {
+                printf ("   hessvec:              %13.6e\n",
+                         Com.Time [CG_THESSVEC]) ;
+            }
+            printf ("   vector kernels:       %13.6e\n",Com.Time [CG_TKERNEL]);
+            printf ("   line search:          %13.6e\n", Com.Time [CG_TLINE]) ;
+            if ( mem > 0 )
+            {
+                printf ("   subspace and L-BFGS:  %13.6e\n",
+                         Com.Time [CG_TSUB]) ;
+            }
+        }
+        if ( Com.Roofline )
+        {
+            const char *type [] = {"setup, exit:", "cg:", "lmcg full:",
+                                   "lmcg subspace:", "L-BFGS:", "Newton:"} ;
+            printf ("\nroofline of the vector kernels (cg_daxpy bandwidth "
+                    "%.2f GB/s):\n", 1.e-9*Com.Roof.bandwidth) ;
+            printf ("                    iter   MB/iter Mflop/iter "
+                    "flop/byte   GB/s  %% of peak\n") ;
+            for (k = 0; k < CG_NROOF; k++)
+            {
+                if ( Com.Roof.bytes [k] == ZERO ) continue ;
+                t = (double) MAX (Com.Roof.iter [k], 1) ;
+                ftemp = (Com.Roof.time [k] > ZERO) ?
+                         Com.Roof.bytes [k]/Com.Roof.time [k] : ZERO ;
+                printf ("   %-15s %6.0f %9.3f %10.3f %9.3f %6.2f %10.1f\n",
+                        type [k], (double) Com.Roof.iter [k],
+                        1.e-6*Com.Roof.bytes [k]/t, 1.e-6*Com.Roof.flops [k]/t,
+                        Com.Roof.flops [k]/Com.Roof.bytes [k], 1.e-9*ftemp,
+                        (Com.Roof.bandwidth > ZERO) ?
+                        100.*ftemp/Com.Roof.bandwidth : ZERO) ;
+            }
+        }
+        if ( Parm->Counters && !Com.Counters )
+        {
+            printf ("\nhardware counters are not available\n") ;
+        }
+        else if ( Com.Counters )
+        {
+            const char *part [] = {"vector kernels:", "value:", "grad:",
+                "valgrad:", "hessvec:", "line search:", "subspace, L-BFGS:"};
+            printf ("\nhardware counters (-1 = not available):\n") ;
+            printf ("                             cycles  instructions"
+                    "  cache misses  GB/s\n") ;
+            for (k = 0; k < CG_TNPHASE; k++)
+            {
+                if ( Com.Time [k] == ZERO ) continue ;
+                printf ("   %-17s", part [k]) ;
+                for (j = 0; j < CG_NCOUNT; j++)
+                {
+                    if ( Com.pfd [j] >= 0 )
+                         printf (" %13.6e", Com.Count [j][k]) ;
+                    else printf (" %13i", -1) ;
+                }
+                if ( Com.pfd [CG_MISSES] >= 0 )
+                {
+                    printf (" %5.2f", 64.e-9*Com.Count [CG_MISSES][k]/
+                                      Com.Time [k]) ;
+                }
+                printf ("\n") ;
+            }
+        }
         printf ("===================================\n\n") ;
     }
+
+    /* when the line search fails, dump the flight recorder */
+    if ( (status >= 3) && (status <= 8) )
+    {
+        if ( Parm->FlightFile != NULL )
+        {
+            file = fopen (Parm->FlightFile, "a") ;
+            if ( file != NULL )
+            {
+                cg_flight (file, status, &Com) ;
+                fclose (file) ;
+            }
+        }
+        else if ( Parm->PrintFinal || PrintLevel >= 1 )
+        {
+            cg_flight (stdout, status, &Com) ;
+        }
+    }
+    if ( Com.Tracer != NULL ) cg_trace_close (Com.Tracer) ;
+    if ( Com.record != NULL ) fclose (Com.record) ;
+    if ( Com.replay != NULL ) fclose (Com.replay) ;
+    free (Com.Pg) ;
+    free (Com.gi) ;
+    free (Com.dmark) ;
+    free (Com.fd_vptr) ;
+    free (Com.fd_work) ;
+    if ( Com.AutoDiag ) free (Com.Diag) ;
+    free (Bns) ;
+    if ( Com.Counters ) cg_perf_close (&Com) ;
     if ( Work == NULL ) free (work) ;
     return (status) ;
 }
@@ -1711,7 +2449,7 @@ PRIVATE int cg_line
     cg_com   *Com /* cg com structure */
 )
 {
-    int AWolfe, iter, ngrow, PrintLevel, qb, qb0, status, toggle ;
+    int AWolfe, iter, ngrow, phase, PrintLevel, qb, qb0, status, toggle ;
     double alpha, a, a1, a2, b, bmin, B, da, db, d0, d1, d2, dB, df, f, fa, fb,
            fB, a0, b0, da0, db0, fa0, fb0, width, rho ;
     char *s1, *s2, *fmt1, *fmt2 ;
@@ -1737,18 +2475,19 @@ PRIVATE int cg_line
     /* evaluate function or gradient at Com->alpha (starting guess) */
     if ( Com->QuadOK )
     {
-        status = cg_evaluate ("fg", "y", Com) ;
+        status = cg_evaluate ("fg", "y", CG_START, Com) ;
         fb = Com->f ;
         if ( !AWolfe ) fb -= Com->alpha*Com->wolfe_hi ;
         qb = TRUE ; /* function value at b known */
     }
     else
     {
-        status = cg_evaluate ("g", "y", Com) ;
+        status = cg_evaluate ("g", "y", CG_START, Com) ;
         qb = FALSE ;
     }
     if ( status ) return (status) ; /* function is undefined */
     b = Com->alpha ;
+    cg_record (CG_START, (qb) ? 3 : 2, ZERO, b, Com) ;
 
     if ( AWolfe )
     {
@@ -1779,7 +2518,11 @@ PRIVATE int cg_line
     /* if a quadratic interpolation step performed, check Wolfe conditions */
     if ( (Com->QuadOK) && (Com->f <= Com->f0) )
     {
-        if ( cg_Wolfe (b, Com->f, Com->df, Com) ) return (0) ;
+        if ( cg_Wolfe (b, Com->f, Com->df, Com) )
+        {
+            Com->nfirst++ ;
+            return (0) ;
+        }
     }
 
     /* if a Wolfe line search and the Wolfe conditions have not been satisfied*/
@@ -1793,8 +2536,9 @@ PRIVATE int cg_line
     {
         if ( !qb )
         {
-            status = cg_evaluate ("f", "n", Com) ;
+            status = cg_evaluate ("f", "n", CG_EXPAND, Com) ;
             if ( status ) return (status) ;
+            cg_record (CG_EXPAND, 1, a, b, Com) ;
             if ( AWolfe ) fb = Com->f ;
             else          fb = Com->f - b*Com->wolfe_hi ;
             qb = TRUE ;
@@ -1851,9 +2595,10 @@ PRIVATE int cg_line
         b = MAX (bmin, b) ;
         Com->alphaold = Com->alpha ;
         Com->alpha = b ;
-        status = cg_evaluate ("g", "p", Com) ;
+        status = cg_evaluate ("g", "p", CG_EXPAND, Com) ;
         if ( status ) return (status) ;
         b = Com->alpha ;
+        cg_record (CG_EXPAND, 2, a, b, Com) ;
         qb = FALSE ;
         if ( AWolfe ) db = Com->df ;
         else          db = Com->df - Com->wolfe_hi ;
@@ -1987,10 +2732,15 @@ Line:
         toggle++ ;
         if ( toggle > 2 ) toggle = 0 ;
 
+        /* s1 tells whether the step was cubic, secant, or bisection */
+        if      ( *s1 == 'c' ) phase = CG_CUBIC ;
+        else if ( *s1 == 's' ) phase = CG_SECANT ;
+        else                   phase = CG_BISECT ;
         Com->alpha = alpha ;
-        status = cg_evaluate ("fg", "n", Com) ;
+        status = cg_evaluate ("fg", "n", phase, Com) ;
         if ( status ) return (status) ;
         Com->alpha = alpha ;
+        cg_record (phase, 3, a, b, Com) ;
         f = Com->f ;
         df = Com->df ;
         if ( Com->QuadOK )
@@ -2141,8 +2891,9 @@ PRIVATE int cg_contract
         if ( toggle > 2 ) toggle = 0 ;
 
         Com->alpha = alpha ;
-        status = cg_evaluate ("fg", "n", Com) ;
+        status = cg_evaluate ("fg", "n", CG_CONTRACT, Com) ;
         if ( status ) return (status) ;
+        cg_record (CG_CONTRACT, 3, a, b, Com) ;
         f = Com->f ;
         df = Com->df ;
 
@@ -2213,20 +2964,182 @@ PRIVATE int cg_contract
     {
         printf ("--increase eps: %e fpert: %e\n", Com->eps, Com->fpert) ;
     }
+    cg_record (CG_EPS, 0, a, b, Com) ;
     Com->neps++ ;
     return (-1) ;
 }
 
 /* =========================================================================
-   ==== cg_fg_evaluate =====================================================
-   Evaluate the function and/or gradient.  Also, possibly check if either is nan
-   and if so, then reduce the stepsize. Only used at the start of an iteration.
+   ==== cg_lineF ===========================================================
+   =========================================================================
+   Line search for problems where the gradient is much more expensive than
+   the function value. The trial points only use function values: the
+   stepsize is reduced by a safeguarded quadratic fit until the Armijo
+   condition holds; if the first trial is accepted, the step is expanded
+   while the function keeps decreasing. The gradient is then evaluated
+   once at the accepted step. If the Wolfe conditions fail at this point,
+   the step is too short and cg_line continues the search.
    Return:
+      -1 (use cg_line, Com->alpha is the starting guess)
+       0 (Wolfe or approximate Wolfe conditions satisfied)
       11 (function nan)
-       0 (successful evaluation)
-   =========================================================================*/
-
-PRIVATE int cg_evaluate
+   ========================================================================= */
+PRIVATE int cg_lineF
+(
+    cg_com   *Com /* cg com structure */
+)
+{
+    int iter, ngrow, PrintLevel, status ;
+    double alpha, b, denom, f, fb, f0, dphi0 ;
+    cg_parameter *Parm ;
+
+    Parm = Com->Parm ;
+    PrintLevel = Parm->PrintLevel ;
+    if ( PrintLevel >= 1 )
+    {
+        printf ("Function value line search\n") ;
+        printf ("==========================\n") ;
+    }
+    f0 = Com->f0 ;
+    dphi0 = Com->df0 ;
+
+    status = cg_evaluate ("f", "y", CG_START, Com) ;
+    if ( status ) return (status) ;
+    alpha = Com->alpha ;
+    f = Com->f ;
+    cg_record (CG_START, 1, ZERO, alpha, Com) ;
+
+    /* backtrack until the Armijo condition holds */
+    for (iter = 0; iter < Parm->nline; iter++)
+    {
+        if ( PrintLevel >= 2 )
+        {
+            printf ("armijo    alpha: %13.6e f: %13.6e f0: %13.6e\n",
+                     alpha, f, f0) ;
+        }
+        if ( f - f0 <= alpha*Com->wolfe_hi ) break ;
+
+        /* minimize the quadratic matching f0, dphi0, and f */
+        denom = 2.*(f - f0 - alpha*dphi0) ;
+        if ( denom > ZERO ) b = -dphi0*alpha*alpha/denom ;
+        else                b = .5*alpha ;
+        /* safeguard */
+        b = MIN (b, .5*alpha) ;
+        b = MAX (b, .1*alpha) ;
+        Com->alpha = b ;
+        status = cg_evaluate ("f", "y", CG_ARMIJO, Com) ;
+        if ( status ) return (status) ;
+        alpha = Com->alpha ;
+        f = Com->f ;
+        cg_record (CG_ARMIJO, 1, ZERO, alpha, Com) ;
+    }
+    if ( iter == Parm->nline )
+    {
+        Com->QuadOK = FALSE ;
+        Com->alpha = alpha ;
+        return (-1) ;
+    }
+
+    /* the first trial was accepted, try larger steps */
+    ngrow = 0 ;
+    if ( (iter == 0) && !Com->QuadOK )
+    {
+        for (ngrow = 0; ngrow < Parm->ntries; ngrow++)
+        {
+            Com->alpha = b = Com->rho*alpha ;
+            status = cg_evaluate ("f", "n", CG_EXPAND, Com) ;
+            if ( status ) return (status) ;
+            fb = Com->f ;
+            cg_record (CG_EXPAND, 1, ZERO, b, Com) ;
+            if ( (fb != fb) || (fb >= f) || (fb - f0 > b*Com->wolfe_hi) ) break;
+            alpha = b ;
+            f = fb ;
+        }
+    }
+
+    /* gradient at the accepted step */
+    Com->alpha = alpha ;
+    status = cg_evaluate ("g", "y", CG_ARMIJO, Com) ;
+    if ( status ) return (status) ;
+    if ( Com->alpha != alpha ) /* the gradient was nan, f is out of date */
+    {
+        Com->QuadOK = FALSE ;
+        return (-1) ;
+    }
+    Com->f = f ;
+    cg_record (CG_ARMIJO, 3, ZERO, alpha, Com) ;
+    if ( cg_Wolfe (alpha, f, Com->df, Com) )
+    {
+        if ( (iter == 0) && (ngrow == 0) ) Com->nfirst++ ;
+        return (0) ;
+    }
+
+    /* the slope is still too negative, the step is too short */
+    Com->QuadOK = FALSE ;
+    Com->alphaold = alpha ;
+    if ( Com->df < Com->wolfe_lo ) Com->alpha = Com->rho*alpha ;
+    return (-1) ;
+}
+
+/* =========================================================================
+   ==== cg_evaluate ========================================================
+   =========================================================================
+   Evaluate the function and/or gradient with cg_eval. When Parm->Timing is
+   T, the time of the step and the dot product is charged to the vector
+   kernels, and the time of the user's routines to value, grad, or valgrad.
+   The first function and gradient evaluation are charged to origin (or to
+   CG_EPS when eps was increased since the previous evaluation), and the
+   retries of cg_eval after a nan or inf to CG_NAN.
+   ========================================================================= */
+PRIVATE int cg_evaluate
+(
+    char    *what, /* fg = evaluate func and grad, g = grad only,f = func only*/
+    char     *nan, /* y means check function/derivative values for nan */
+    int    origin, /* CG_START, ..., CG_QUAD, where the evaluation is made */
+    cg_com   *Com
+)
+{
+    int phase, status ;
+    INT nf, ng ;
+    if ( Com->neps != Com->neps_eval )
+    {
+        Com->neps_eval = Com->neps ;
+        origin = CG_EPS ;
+    }
+    nf = Com->nf ;
+    ng = Com->ng ;
+    if ( !Com->Timing ) status = cg_eval (what, nan, Com) ;
+    else
+    {
+        phase = cg_clock (CG_TKERNEL, Com) ;
+        status = cg_eval (what, nan, Com) ;
+        cg_clock (phase, Com) ;
+    }
+    nf = Com->nf - nf ;
+    ng = Com->ng - ng ;
+    if ( nf > 0 )
+    {
+        Com->Nf [origin]++ ;
+        Com->Nf [CG_NAN] += nf - 1 ;
+    }
+    if ( ng > 0 )
+    {
+        Com->Ng [origin]++ ;
+        Com->Ng [CG_NAN] += ng - 1 ;
+    }
+    return (status) ;
+}
+
+/* =========================================================================
+   ==== cg_eval ============================================================
+   Evaluate the function and/or gradient.  Also, possibly check if either is nan
+   and if so, then reduce the stepsize. Only used at the start of an iteration.
+   Return:
+      11 (function nan)
+       0 (successful evaluation)
+   =========================================================================*/
+
+PRIVATE int cg_eval
 (
     char    *what, /* fg = evaluate func and grad, g = grad only,f = func only*/
     char     *nan, /* y means check function/derivative values for nan */
@@ -2235,12 +3148,11 @@ PRIVATE int cg_evaluate
 {
     INT n ;
     int i ;
-    double alpha, *d, *gtemp, *x, *xtemp ;
+    double alpha, *gtemp, *x, *xtemp ;
     cg_parameter *Parm ;
     Parm = Com->Parm ;
     n = Com->n ;
     x = Com->x ;
-    d = Com->d ;
     xtemp = Com->xtemp ;
     gtemp = Com->gtemp ;
     alpha = Com->alpha ;
@@ -2249,9 +3161,9 @@ PRIVATE int cg_evaluate
     {
         if ( !strcmp (what, "f") ) /* compute function */
         {
-            cg_step (xtemp, x, d, alpha, n) ;
+            cg_sparse_step (alpha, Com) ;
             /* provisional function value */
-            Com->f = Com->cg_value (xtemp, n) ;
+            Com->f = cg_fvalue (xtemp, Com) ;
             Com->nf++ ;
 
             /* reduce stepsize if function value is nan */
@@ -2267,8 +3179,8 @@ PRIVATE int cg_evaluate
                     {
                         alpha *= Parm->nan_decay ;
                     }
-                    cg_step (xtemp, x, d, alpha, n) ;
-                    Com->f = Com->cg_value (xtemp, n) ;
+                    cg_sparse_step (alpha, Com) ;
+                    Com->f = cg_fvalue (xtemp, Com) ;
                     Com->nf++ ;
                     if ( (Com->f == Com->f) && (Com->f < INF) &&
                          (Com->f > -INF) ) break ;
@@ -2277,150 +3189,1859 @@ PRIVATE int cg_evaluate
             }
             Com->alpha = alpha ;
         }
-        else if ( !strcmp (what, "g") ) /* compute gradient */
+        else if ( !strcmp (what, "g") ) /* compute gradient */
+        {
+            cg_sparse_step (alpha, Com) ;
+            cg_fgrad (gtemp, xtemp, Com) ;
+            Com->ng++ ;
+            Com->df = cg_sparse_dot (Com) ;
+            /* reduce stepsize if derivative is nan */
+            if ( (Com->df != Com->df) || (Com->df >= INF) || (Com->df <= -INF) )
+            {
+                for (i = 0; i < Parm->ntries; i++)
+                {
+                    if ( !strcmp (nan, "p") ) /* contract from good alpha */
+                    {
+                        alpha = Com->alphaold + .8*(alpha - Com->alphaold) ;
+                    }
+                    else                      /* multiply by nan_decay */
+                    {
+                        alpha *= Parm->nan_decay ;
+                    }
+                    cg_sparse_step (alpha, Com) ;
+                    cg_fgrad (gtemp, xtemp, Com) ;
+                    Com->ng++ ;
+                    Com->df = cg_sparse_dot (Com) ;
+                    if ( (Com->df == Com->df) && (Com->df < INF) &&
+                         (Com->df > -INF) ) break ;
+                }
+                if ( i == Parm->ntries ) return (11) ;
+                Com->rho = Parm->nan_rho ;
+            }
+            else Com->rho = Parm->rho ;
+            Com->alpha = alpha ;
+        }
+        else                            /* compute function and gradient */
+        {
+            cg_sparse_step (alpha, Com) ;
+            if ( (Com->cg_valgrad != NULL) || Com->FD )
+            {
+                Com->f = cg_fvalgrad (gtemp, xtemp, Com) ;
+            }
+            else
+            {
+                cg_fgrad (gtemp, xtemp, Com) ;
+                Com->f = cg_fvalue (xtemp, Com) ;
+            }
+            Com->df = cg_sparse_dot (Com) ;
+            Com->nf++ ;
+            Com->ng++ ;
+            /* reduce stepsize if function value or derivative is nan */
+            if ( (Com->df !=  Com->df) || (Com->f != Com->f) ||
+                 (Com->df >=  INF)     || (Com->f >= INF)    ||
+                 (Com->df <= -INF)     || (Com->f <= -INF))
+            {
+                for (i = 0; i < Parm->ntries; i++)
+                {
+                    if ( !strcmp (nan, "p") ) /* contract from good alpha */
+                    {
+                        alpha = Com->alphaold + .8*(alpha - Com->alphaold) ;
+                    }
+                    else                      /* multiply by nan_decay */
+                    {
+                        alpha *= Parm->nan_decay ;
+                    }
+                    cg_sparse_step (alpha, Com) ;
+                    if ( (Com->cg_valgrad != NULL) || Com->FD )
+                    {
+                        Com->f = cg_fvalgrad (gtemp, xtemp, Com) ;
+                    }
+                    else
+                    {
+                        cg_fgrad (gtemp, xtemp, Com) ;
+                        Com->f = cg_fvalue (xtemp, Com) ;
+                    }
+                    Com->df = cg_sparse_dot (Com) ;
+                    Com->nf++ ;
+                    Com->ng++ ;
+                    if ( (Com->df == Com->df) && (Com->f == Com->f) &&
+                         (Com->df <  INF)     && (Com->f <  INF)    &&
+                         (Com->df > -INF)     && (Com->f > -INF) ) break ;
+                }
+                if ( i == Parm->ntries ) return (11) ;
+                Com->rho = Parm->nan_rho ;
+            }
+            else Com->rho = Parm->rho ;
+            Com->alpha = alpha ;
+        }
+    }
+    else                                /* evaluate without nan checking */
+    {
+        if ( !strcmp (what, "fg") )     /* compute function and gradient */
+        {
+            if ( alpha == ZERO )        /* evaluate at x */
+            {
+                /* the following copy is not needed except when the code
+                   is run using the MATLAB mex interface */
+                cg_copy (xtemp, x, n) ;
+                if ( (Com->cg_valgrad != NULL) || Com->FD )
+                {
+                    Com->f = cg_fvalgrad (Com->g, xtemp, Com) ;
+                }
+                else
+                {
+                    cg_fgrad (Com->g, xtemp, Com) ;
+                    Com->f = cg_fvalue (xtemp, Com) ;
+                }
+            }
+            else
+            {
+                cg_sparse_step (alpha, Com) ;
+                if ( (Com->cg_valgrad != NULL) || Com->FD )
+                {
+                    Com->f = cg_fvalgrad (gtemp, xtemp, Com) ;
+                }
+                else
+                {
+                    cg_fgrad (gtemp, xtemp, Com) ;
+                    Com->f = cg_fvalue (xtemp, Com) ;
+                }
+                Com->df = cg_sparse_dot (Com) ;
+            }
+            Com->nf++ ;
+            Com->ng++ ;
+            /* at alpha = 0, df is not computed and Com->df is not set */
+            if ( (Com->f != Com->f) || (Com->f == INF) || (Com->f ==-INF) ||
+                 ((alpha != ZERO) && ((Com->df != Com->df) ||
+                  (Com->df == INF) || (Com->df ==-INF))) ) return (11) ;
+        }
+        else if ( !strcmp (what, "f") ) /* compute function */
+        {
+            cg_sparse_step (alpha, Com) ;
+            Com->f = cg_fvalue (xtemp, Com) ;
+            Com->nf++ ;
+            if ( (Com->f != Com->f) || (Com->f == INF) || (Com->f ==-INF) )
+                return (11) ;
+        }
+        else
+        {
+            cg_sparse_step (alpha, Com) ;
+            cg_fgrad (gtemp, xtemp, Com) ;
+            Com->df = cg_sparse_dot (Com) ;
+            Com->ng++ ;
+            if ( (Com->df != Com->df) || (Com->df == INF) || (Com->df ==-INF) )
+                return (11) ;
+        }
+    }
+    return (0) ;
+}
+
+/* =========================================================================
+   ==== cg_fvalue ==========================================================
+   =========================================================================
+   Call the user's value routine, timed when Parm->Timing is T, or take
+   the value from the replay file
+   ========================================================================= */
+PRIVATE double cg_fvalue
+(
+    double     *x, /* evaluation point */
+    cg_com   *Com
+)
+{
+    int phase ;
+    double f ;
+    Com->ncall++ ;
+    if ( (Com->replay == NULL) || !cg_replay_read (1, &f, NULL, x, Com) )
+    {
+        if ( !Com->Timing ) f = Com->cg_value (x, Com->n) ;
+        else
+        {
+            phase = cg_clock (CG_TVALUE, Com) ;
+            f = Com->cg_value (x, Com->n) ;
+            cg_clock (phase, Com) ;
+        }
+    }
+    if ( Com->record != NULL ) cg_replay_write (1, f, NULL, x, Com) ;
+    return (f) ;
+}
+
+/* =========================================================================
+   ==== cg_fgrad ===========================================================
+   =========================================================================
+   Call the user's grad routine, timed when Parm->Timing is T, or take
+   the gradient from the replay file. In the sparse mode, the previous
+   nonzeros of g are cleared and sparsegrad gives the new ones.
+   ========================================================================= */
+PRIVATE void cg_fgrad
+(
+    double     *g, /* gradient at x */
+    double     *x, /* evaluation point */
+    cg_com   *Com
+)
+{
+    int phase ;
+    INT k, *ind, *nnz ;
+    double f ;
+    phase = CG_TKERNEL ; /* the phase to resume, set when timed */
+    Com->ncall++ ;
+    if ( Com->Sparse )
+    {
+        if ( g == Com->g )
+        {
+            ind = Com->gi ;
+            nnz = &Com->ngi ;
+        }
+        else
+        {
+            ind = Com->gti ;
+            nnz = &Com->ngti ;
+        }
+        for (k = 0; k < *nnz; k++) g [ind [k]] = ZERO ;
+        if ( !Com->Timing ) *nnz = Com->cg_sparsegrad (g, ind, x, Com->n) ;
+        else
+        {
+            phase = cg_clock (CG_TGRAD, Com) ;
+            *nnz = Com->cg_sparsegrad (g, ind, x, Com->n) ;
+            cg_clock (phase, Com) ;
+        }
+    }
+    else if ( (Com->replay == NULL) || !cg_replay_read (2, &f, g, x, Com) )
+    {
+        if ( Com->Timing ) phase = cg_clock (CG_TGRAD, Com) ;
+        if ( Com->FD ) cg_fdgrad (g, x, FALSE, Com) ;
+        else           Com->cg_grad (g, x, Com->n) ;
+        if ( Com->Timing ) cg_clock (phase, Com) ;
+    }
+    if ( Com->record != NULL ) cg_replay_write (2, ZERO, g, x, Com) ;
+}
+
+/* =========================================================================
+   ==== cg_fvalgrad ========================================================
+   =========================================================================
+   Call the user's valgrad routine, timed when Parm->Timing is T, or take
+   the value and gradient from the replay file
+   ========================================================================= */
+PRIVATE double cg_fvalgrad
+(
+    double     *g, /* gradient at x */
+    double     *x, /* evaluation point */
+    cg_com   *Com
+)
+{
+    int phase ;
+    double f ;
+    phase = CG_TKERNEL ; /* the phase to resume, set when timed */
+    Com->ncall++ ;
+    if ( (Com->replay == NULL) || !cg_replay_read (3, &f, g, x, Com) )
+    {
+        if ( Com->Timing ) phase = cg_clock (CG_TVALGRAD, Com) ;
+        if ( Com->FD ) f = cg_fdgrad (g, x, TRUE, Com) ;
+        else           f = Com->cg_valgrad (g, x, Com->n) ;
+        if ( Com->Timing ) cg_clock (phase, Com) ;
+    }
+    if ( Com->record != NULL ) cg_replay_write (3, f, g, x, Com) ;
+    return (f) ;
+}
+
+/* =========================================================================
+   ==== cg_fdsetup =========================================================
+   =========================================================================
+   Set up the finite difference gradient: the threads, the work arrays,
+   and with Parm->FDElements the groups of variables perturbed together.
+   A variable gets the smallest group that holds no variable of one of its
+   elements (greedy coloring of the column intersection graph). Returns
+   10 when out of memory, 0 otherwise.
+   ========================================================================= */
+PRIVATE int cg_fdsetup
+(
+    cg_com   *Com
+)
+{
+    int nt ;
+    INT c, e, i, j, k, l, n, nelt, nnz, *color, *forbid, *ptr, *idx,
+       *vptr, *velt ;
+    cg_parameter *Parm ;
+    Parm = Com->Parm ;
+    n = Com->n ;
+#ifdef _OPENMP
+    nt = (Parm->FDThreads > 0) ? Parm->FDThreads : omp_get_max_threads () ;
+#else
+    nt = 1 ;
+#endif
+    Com->fd_nthread = MAX (nt, 1) ;
+    Com->fd_ncolor = n ;
+    nelt = 0 ;
+    if ( Parm->FDElements != NULL )
+    {
+        nelt = Parm->FDnelt ;
+        ptr = Parm->FDptr ;
+        idx = Parm->FDidx ;
+        nnz = ptr [nelt] ;
+        Com->fd_vptr = (INT *) malloc ((3*n + nnz + 2)*sizeof (INT)) ;
+        color = (INT *) malloc (2*n*sizeof (INT)) ;
+        if ( (Com->fd_vptr == NULL) || (color == NULL) )
+        {
+            free (color) ;
+            return (10) ;
+        }
+        vptr = Com->fd_vptr ;
+        velt = Com->fd_velt = vptr + n + 1 ;
+        Com->fd_colptr = velt + nnz ;
+        Com->fd_order = Com->fd_colptr + n + 1 ;
+        forbid = color + n ;
+
+        /* the elements of each variable, in increasing order */
+        for (j = 0; j <= n; j++) vptr [j] = 0 ;
+        for (k = 0; k < nnz; k++) vptr [idx [k]+1]++ ;
+        for (j = 0; j < n; j++) vptr [j+1] += vptr [j] ;
+        for (e = 0; e < nelt; e++)
+        {
+            for (k = ptr [e]; k < ptr [e+1]; k++) velt [vptr [idx [k]]++] = e;
+        }
+        for (j = n; j > 0; j--) vptr [j] = vptr [j-1] ;
+        vptr [0] = 0 ;
+
+        /* greedy coloring */
+        Com->fd_ncolor = 0 ;
+        for (j = 0; j < n; j++) forbid [j] = -1 ;
+        for (j = 0; j < n; j++)
+        {
+            for (l = vptr [j]; l < vptr [j+1]; l++)
+            {
+                e = velt [l] ;
+                for (k = ptr [e]; k < ptr [e+1]; k++)
+                {
+                    i = idx [k] ;
+                    if ( i < j ) forbid [color [i]] = j ;
+                }
+            }
+            for (c = 0; forbid [c] == j; c++) ;
+            color [j] = c ;
+            Com->fd_ncolor = MAX (Com->fd_ncolor, c+1) ;
+        }
+
+        /* sort the variables by color */
+        for (c = 0; c <= Com->fd_ncolor; c++) Com->fd_colptr [c] = 0 ;
+        for (j = 0; j < n; j++) Com->fd_colptr [color [j]+1]++ ;
+        for (c = 0; c < Com->fd_ncolor; c++)
+        {
+            Com->fd_colptr [c+1] += Com->fd_colptr [c] ;
+        }
+        for (j = 0; j < n; j++) Com->fd_order [Com->fd_colptr [color [j]]++]=j;
+        for (c = Com->fd_ncolor; c > 0; c--)
+        {
+            Com->fd_colptr [c] = Com->fd_colptr [c-1] ;
+        }
+        Com->fd_colptr [0] = 0 ;
+        free (color) ;
+    }
+
+    /* h and F0, then per thread a copy of x and two element vectors */
+    Com->fd_work = (double *) malloc ((n + nelt + Com->fd_nthread*(n+2*nelt))
+                                      *sizeof (double)) ;
+    if ( Com->fd_work == NULL ) return (10) ;
+    Com->fd_h = Com->fd_work + Com->fd_nthread*(n+2*nelt) ;
+    Com->fd_F0 = Com->fd_h + n ;
+    return (0) ;
+}
+
+/* =========================================================================
+   ==== cg_fdgrad ==========================================================
+   =========================================================================
+   Finite difference gradient, used when the user provides neither grad
+   nor valgrad. The groups of variables (one variable per group without
+   Parm->FDElements) are perturbed one after the other by each thread in
+   its own copy of x, and the groups are shared among the threads. With
+   the elements, g_j is the sum of the differences of the elements of x_j
+   divided by h_j, in the order of the elements. The result does not
+   depend on the number of threads. Returns f (x) when needf is T.
+   ========================================================================= */
+PRIVATE double cg_fdgrad
+(
+    double     *g, /* gradient at x */
+    double     *x, /* evaluation point */
+    int     needf, /* T (return f (x)) */
+    cg_com   *Com
+)
+{
+    int central ;
+    INT j, n, nelt, ncolor ;
+    double f, h, t, *F0, *hj ;
+    cg_parameter *Parm ;
+    Parm = Com->Parm ;
+    n = Com->n ;
+    central = Parm->FDCentral ;
+    ncolor = Com->fd_ncolor ;
+    nelt = (Parm->FDElements != NULL) ? Parm->FDnelt : 0 ;
+    F0 = Com->fd_F0 ;
+    hj = Com->fd_h ;
+
+    /* the steps, rounded so that x_j + h_j - x_j = h_j */
+    h = Parm->FDStep ;
+    if ( h <= ZERO ) h = central ? pow (DBL_EPSILON, ONE/3.) :
+                                   sqrt (DBL_EPSILON) ;
+    for (j = 0; j < n; j++)
+    {
+        t = x [j] + h*MAX (fabs (x [j]), ONE) ;
+        hj [j] = t - x [j] ;
+    }
+
+    /* the value at x */
+    f = ZERO ;
+    if ( needf || !central )
+    {
+        if ( nelt > 0 )
+        {
+            Parm->FDElements (F0, x, n) ;
+            for (j = 0; j < nelt; j++) f += F0 [j] ;
+        }
+        else f = Com->cg_value (x, n) ;
+        Com->nfd++ ;
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads (Com->fd_nthread)
+#endif
+    {
+        INT c, e, i, k, l, q, q1 ;
+        double fp, fm, s, *xp, *Fp, *Fm ;
+#ifdef _OPENMP
+        i = omp_get_thread_num () ;
+#else
+        i = 0 ;
+#endif
+        xp = Com->fd_work + i*(n + 2*nelt) ;
+        Fp = xp + n ;
+        Fm = Fp + nelt ;
+        for (k = 0; k < n; k++) xp [k] = x [k] ;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+        for (c = 0; c < ncolor; c++)
+        {
+            if ( nelt == 0 ) /* one variable */
+            {
+                xp [c] = x [c] + hj [c] ;
+                fp = Com->cg_value (xp, n) ;
+                if ( central )
+                {
+                    xp [c] = x [c] - hj [c] ;
+                    fm = Com->cg_value (xp, n) ;
+                    g [c] = (fp - fm)/(2.*hj [c]) ;
+                }
+                else g [c] = (fp - f)/hj [c] ;
+                xp [c] = x [c] ;
+                continue ;
+            }
+            q = Com->fd_colptr [c] ;
+            q1 = Com->fd_colptr [c+1] ;
+            for (k = q; k < q1; k++)
+            {
+                i = Com->fd_order [k] ;
+                xp [i] = x [i] + hj [i] ;
+            }
+            Parm->FDElements (Fp, xp, n) ;
+            if ( central )
+            {
+                for (k = q; k < q1; k++)
+                {
+                    i = Com->fd_order [k] ;
+                    xp [i] = x [i] - hj [i] ;
+                }
+                Parm->FDElements (Fm, xp, n) ;
+            }
+            for (k = q; k < q1; k++)
+            {
+                i = Com->fd_order [k] ;
+                xp [i] = x [i] ;
+                s = ZERO ;
+                for (l = Com->fd_vptr [i]; l < Com->fd_vptr [i+1]; l++)
+                {
+                    e = Com->fd_velt [l] ;
+                    s += central ? Fp [e] - Fm [e] : Fp [e] - F0 [e] ;
+                }
+                g [i] = central ? s/(2.*hj [i]) : s/hj [i] ;
+            }
+        }
+    }
+    Com->nfd += central ? 2*ncolor : ncolor ;
+    return (f) ;
+}
+
+/* =========================================================================
+   ==== cg_replay_open =====================================================
+   =========================================================================
+   Open the record file and write its header, or open the replay file and
+   check its header. Returns NULL if the file can not be opened, or if the
+   replay file was not written by RecordFile with the same n.
+   ========================================================================= */
+PRIVATE FILE *cg_replay_open
+(
+    char    *File, /* name of the record or replay file */
+    int     write, /* T => RecordFile, F => ReplayFile */
+    cg_com   *Com
+)
+{
+    int size ;
+    INT n ;
+    char head [8] ;
+    FILE *file ;
+    file = fopen (File, write ? "wb" : "rb") ;
+    if ( file == NULL )
+    {
+        if ( Com->Parm->PrintLevel >= 1 )
+        {
+            printf ("could not open %s\n", File) ;
+        }
+        return (NULL) ;
+    }
+    if ( write )
+    {
+        size = sizeof (cg_erecord) ;
+        fwrite ("CGEVALS1", 1, 8, file) ;
+        fwrite (&size, sizeof (int), 1, file) ;
+        fwrite (&Com->n, sizeof (INT), 1, file) ;
+        return (file) ;
+    }
+    if ( (fread (head, 1, 8, file) != 8) || strncmp (head, "CGEVALS1", 8) ||
+         (fread (&size, sizeof (int), 1, file) != 1) ||
+         (size != sizeof (cg_erecord)) ||
+         (fread (&n, sizeof (INT), 1, file) != 1) || (n != Com->n) )
+    {
+        if ( Com->Parm->PrintLevel >= 1 || Com->Parm->PrintFinal )
+        {
+            printf ("%s is not a recording of this problem, the replay is "
+                    "not used\n", File) ;
+        }
+        fclose (file) ;
+        return (NULL) ;
+    }
+    return (file) ;
+}
+
+/* =========================================================================
+   ==== cg_replay_read =====================================================
+   =========================================================================
+   Read the next record of the replay file. If it was evaluated at x and
+   contains the requested values (a valgrad record also answers value or
+   grad), store them in f and g and return T. Otherwise, report the
+   divergence, close the replay file, and return F so that the caller
+   evaluates the user's routine.
+   ========================================================================= */
+PRIVATE int cg_replay_read
+(
+    int      what, /* 1 = value, 2 = grad, 3 = valgrad */
+    double     *f, /* recorded function value */
+    double     *g, /* recorded gradient */
+    double     *x, /* evaluation point */
+    cg_com   *Com
+)
+{
+    INT n ;
+    cg_erecord R ;
+    n = Com->n ;
+    if ( fread (&R, sizeof (cg_erecord), 1, Com->replay) != 1 )
+    {
+        cg_replay_stop ("end of the recording", Com) ;
+        return (FALSE) ;
+    }
+    if ( (R.what & what) != what )
+    {
+        cg_replay_stop ("the recording evaluated another routine", Com) ;
+        return (FALSE) ;
+    }
+    if ( R.digest != cg_digest (x, n) )
+    {
+        cg_replay_stop ("x differs from the recording", Com) ;
+        return (FALSE) ;
+    }
+    if ( R.what & 2 )
+    {
+        if ( what & 2 )
+        {
+            if ( fread (g, sizeof (double), n, Com->replay) != (size_t) n )
+            {
+                cg_replay_stop ("end of the recording", Com) ;
+                return (FALSE) ;
+            }
+        }
+        else fseek (Com->replay, n*sizeof (double), SEEK_CUR) ;
+    }
+    *f = R.f ;
+    Com->nreplay++ ;
+    return (TRUE) ;
+}
+
+/* =========================================================================
+   ==== cg_replay_write ====================================================
+   =========================================================================
+   Append an evaluation to the record file
+   ========================================================================= */
+PRIVATE void cg_replay_write
+(
+    int      what, /* 1 = value, 2 = grad, 3 = valgrad */
+    double      f, /* function value */
+    double     *g, /* gradient */
+    double     *x, /* evaluation point */
+    cg_com   *Com
+)
+{
+    cg_erecord R ;
+    memset (&R, 0, sizeof (cg_erecord)) ; /* no garbage in the padding */
+    R.what = what ;
+    R.digest = cg_digest (x, Com->n) ;
+    R.f = f ;
+    fwrite (&R, sizeof (cg_erecord), 1, Com->record) ;
+    if ( what & 2 ) fwrite (g, sizeof (double), Com->n, Com->record) ;
+}
+
+/* =========================================================================
+   ==== cg_replay_stop =====================================================
+   =========================================================================
+   The replay diverged from the recording: report it and continue with the
+   user's routines
+   ========================================================================= */
+PRIVATE void cg_replay_stop
+(
+    char  *reason, /* why the replay diverged */
+    cg_com   *Com
+)
+{
+    Com->diverge = Com->ncall ;
+    if ( Com->Parm->PrintLevel >= 1 || Com->Parm->PrintFinal )
+    {
+        printf ("replay diverged at call %ld (iteration %ld): %s, "
+                "continuing with the user's routines\n", (long) Com->ncall,
+                (long) Com->iter, reason) ;
+    }
+    fclose (Com->replay) ;
+    Com->replay = NULL ;
+}
+
+/* =========================================================================
+   ==== cg_digest ==========================================================
+   =========================================================================
+   64-bit FNV-1a hash of the bytes of x, identifies an evaluation point
+   ========================================================================= */
+PRIVATE unsigned long long cg_digest
+(
+    double     *x, /* vector */
+    INT         n  /* length of x */
+)
+{
+    size_t i, nbytes ;
+    unsigned char *b ;
+    unsigned long long h ;
+    b = (unsigned char *) x ;
+    nbytes = n*sizeof (double) ;
+    h = 14695981039346656037ULL ;
+    for (i = 0; i < nbytes; i++)
+    {
+        h ^= b [i] ;
+        h *= 1099511628211ULL ;
+    }
+    return (h) ;
+}
+
+/* =========================================================================
+   ==== cg_precond =========================================================
+   =========================================================================
+   Apply the preconditioner, Pg = P*g, with the user's routine
+   Parm->precond or the diagonal Com->Diag. Returns g'Pg.
+   ========================================================================= */
+PRIVATE double cg_precond
+(
+    double    *Pg, /* P*g */
+    double     *g, /* vector to precondition */
+    cg_com   *Com
+)
+{
+    INT i, n, n5 ;
+    double s, t, *p ;
+    cg_parameter *Parm ;
+    Parm = Com->Parm ;
+    n = Com->n ;
+    if ( Parm->precond != NULL )
+    {
+        Parm->precond (Pg, g, n, Parm->PrecondData) ;
+        return (cg_dot (g, Pg, n)) ;
+    }
+    p = Com->Diag ;
+    t = ZERO ;
+    CG_KWORK (3*n, 2*n) ;
+    n5 = n % 5 ;
+    for (i = 0; i < n5; i++)
+    {
+        s = p [i]*g [i] ;
+        t += s*g [i] ;
+        Pg [i] = s ;
+    }
+    for (; i < n; )
+    {
+        s = p [i]*g [i] ;
+        t += s*g [i] ;
+        Pg [i] = s ;
+        i++ ;
+
+        s = p [i]*g [i] ;
+        t += s*g [i] ;
+        Pg [i] = s ;
+        i++ ;
+
+        s = p [i]*g [i] ;
+        t += s*g [i] ;
+        Pg [i] = s ;
+        i++ ;
+
+        s = p [i]*g [i] ;
+        t += s*g [i] ;
+        Pg [i] = s ;
+        i++ ;
+
+        s = p [i]*g [i] ;
+        t += s*g [i] ;
+        Pg [i] = s ;
+        i++ ;
+    }
+    return (t) ;
+}
+
+/* =========================================================================
+   ==== cg_autodiag ========================================================
+   =========================================================================
+   Update the automatic diagonal scaling P = inv (B) in Com->Diag with the
+   step s = alpha*d and y = gtemp - g. Before the first update B is
+   (y'y/s'y) I, then the diagonal of the BFGS update
+
+       B_i = B_i - (B_i s_i)^2/s'Bs + y_i^2/s'y
+
+   is used, each element staying within a factor CG_DIAGFAC of its old
+   value. The update is skipped when s'y <= 0. Returns g'Pg with the new P.
+
+   A diagonal B can only model the curvature when s_i y_i >= 0, which holds
+   for a separable f. With coupled variables (a PDE, for instance) terms of
+   both signs appear and the diagonal follows the steps rather than the
+   Hessian; CG then also loses its conjugacy to the changing P. When the
+   running average of sum |s_i y_i| / s'y (1 for a separable f) exceeds
+   CG_DIAGNU, P is set to I for the rest of the run.
+   ========================================================================= */
+PRIVATE double cg_autodiag
+(
+    double     *d, /* search direction, s = alpha*d */
+    double     *g, /* old gradient */
+    double *gtemp, /* new gradient, y = gtemp - g */
+    double  alpha, /* step size */
+    double     sy, /* s'y */
+    cg_com   *Com
+)
+{
+    INT i, n ;
+    double b, b0, bnew, s, y, ss, sBs, sy1, yy, t, *p ;
+    n = Com->n ;
+    p = Com->Diag ;
+    if ( Com->diag_off ) return (cg_dot (g, g, n)) ;
+    ss = sBs = sy1 = yy = ZERO ;
+    for (i = 0; i < n; i++)
+    {
+        s = alpha*d [i] ;
+        y = gtemp [i] - g [i] ;
+        ss += s*s ;
+        sBs += s*s/p [i] ;
+        sy1 += fabs (s*y) ;
+        yy += y*y ;
+    }
+    CG_KWORK (4*n, 12*n) ;
+    t = ZERO ;
+    if ( sy > ZERO )
+    {
+        Com->diag_nu = .9*Com->diag_nu + .1*sy1/sy ;
+        if ( Com->diag_nu > CG_DIAGNU )
+        {
+            Com->diag_off = TRUE ;
+            for (i = 0; i < n; i++) p [i] = ONE ;
+            if ( Com->Parm->PrintLevel >= 1 )
+            {
+                printf ("iter: %i automatic scaling replaced by P = I\n",
+                        (int) Com->iter) ;
+            }
+            return (cg_dot (g, g, n)) ;
+        }
+    }
+    if ( (sy <= ZERO) || (sBs <= ZERO) || (yy <= ZERO) )
+    {
+        for (i = 0; i < n; i++) t += p [i]*g [i]*g [i] ;
+        CG_KWORK (2*n, 3*n) ;
+        return (t) ;
+    }
+    b0 = ZERO ;
+    if ( Com->ndiag == 0 ) /* B = (y'y/s'y) I */
+    {
+        b0 = yy/sy ;
+        sBs = b0*ss ;
+    }
+    Com->ndiag++ ;
+    for (i = 0; i < n; i++)
+    {
+        b = (b0 > ZERO) ? b0 : ONE/p [i] ;
+        s = alpha*d [i] ;
+        y = gtemp [i] - g [i] ;
+        bnew = b - (b*s)*(b*s)/sBs + y*y/sy ;
+        bnew = MAX (bnew, b/CG_DIAGFAC) ;
+        bnew = MIN (bnew, b*CG_DIAGFAC) ;
+        p [i] = ONE/bnew ;
+        t += p [i]*g [i]*g [i] ;
+    }
+    CG_KWORK (5*n, 15*n) ;
+    return (t) ;
+}
+
+/* =========================================================================
+   ==== cg_clock ===========================================================
+   =========================================================================
+   Charge the time since the last call to the part being timed and start
+   timing the given part. Returns the part that was being timed so that
+   the caller can restore it.
+   ========================================================================= */
+PRIVATE int cg_clock
+(
+    int     phase, /* part of cg_descent that starts, CG_TKERNEL, ... */
+    cg_com   *Com
+)
+{
+    int old ;
+    double t ;
+    t = cg_wtime () ;
+    old = Com->tphase ;
+    if ( Com->Counters ) cg_perf_charge (old, Com) ;
+    Com->Time [old] += t - Com->tlast ;
+    Com->tlast = t ;
+    Com->tphase = phase ;
+    return (old) ;
+}
+
+/* =========================================================================
+   ==== cg_wtime ===========================================================
+   =========================================================================
+   Wall clock time in seconds from a monotonic clock, or processor time
+   when the monotonic clock is not available
+   ========================================================================= */
+PRIVATE double cg_wtime (void)
+{
+#ifdef CLOCK_MONOTONIC
+    struct timespec t ;
+    clock_gettime (CLOCK_MONOTONIC, &t) ;
+    return ((double) t.tv_sec + 1.e-9*t.tv_nsec) ;
+#else
+    return ((double) clock ()/CLOCKS_PER_SEC) ;
+#endif
+}
+
+/* =========================================================================
+   ==== cg_roof ============================================================
+   =========================================================================
+   Charge the kernel work and the time outside the user routines since the
+   previous call to an iteration of the given type (Parm->Roofline)
+   ========================================================================= */
+PRIVATE void cg_roof
+(
+    int      type, /* CG_RSETUP, CG_RCG, CG_RFULL, CG_RSUB, or CG_RLBFGS */
+    cg_com   *Com
+)
+{
+    double t ;
+    cg_clock (Com->tphase, Com) ; /* charge the current part up to now */
+    t = Com->Time [CG_TKERNEL] + Com->Time [CG_TLINE] + Com->Time [CG_TSUB] ;
+    if ( type != CG_RSETUP ) Com->Roof.iter [type]++ ;
+    Com->Roof.bytes [type] += cg_work.bytes ;
+    Com->Roof.flops [type] += cg_work.flops ;
+    Com->Roof.time [type] += t - Com->roof_time ;
+    Com->roof_time = t ;
+    cg_work.bytes = cg_work.flops = ZERO ;
+}
+
+/* =========================================================================
+   ==== cg_bandwidth =======================================================
+   =========================================================================
+   Return the bytes/sec of cg_daxpy on vectors of length n, so that the data
+   is in the same level of the memory hierarchy as in the iterations. Each
+   run does CG_BWLEN/n daxpys (at least one), the best of 5 runs is used.
+   Return 0 if the vectors can't be allocated.
+   ========================================================================= */
+PRIVATE double cg_bandwidth
+(
+    INT      n  /* length of the vectors */
+)
+{
+    int on ;
+    INT i, j, reps ;
+    double t, best, *x ;
+    x = (double *) malloc (2*n*sizeof (double)) ;
+    if ( x == NULL ) return (ZERO) ;
+    on = cg_work.on ;
+    cg_work.on = FALSE ;
+    cg_init (x, ONE, 2*n) ;
+    reps = MAX (CG_BWLEN/n, 1) ;
+    best = INF ;
+    for (i = 0; i < 5; i++)
+    {
+        t = cg_wtime () ;
+        for (j = 0; j < reps; j++) cg_daxpy (x, x+n, 1.e-9, n) ;
+        t = cg_wtime () - t ;
+        best = MIN (best, t) ;
+    }
+    cg_work.on = on ;
+    free (x) ;
+    return ((best > ZERO) ? 24.*n*reps/best : ZERO) ;
+}
+
+/* =========================================================================
+   ==== cg_perf_open =======================================================
+   =========================================================================
+   Open the hardware counters (user space only) with perf_event_open. Each
+   counter is opened on its own so that the others remain available when
+   one is not supported. When no counter can be opened (not Linux, counters
+   not permitted by perf_event_paranoid, or a virtual machine without a
+   PMU), Com->Counters stays F and only the time is measured.
+   ========================================================================= */
+PRIVATE void cg_perf_open
+(
+    cg_com   *Com
+)
+{
+    int j, k ;
+#ifdef CG_PERF
+    struct perf_event_attr attr ;
+    const unsigned long long config [CG_NCOUNT] =
+    {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+     PERF_COUNT_HW_CACHE_MISSES} ;
+    for (j = 0; j < CG_NCOUNT; j++)
+    {
+        memset (&attr, 0, sizeof (attr)) ;
+        attr.size = sizeof (attr) ;
+        attr.type = PERF_TYPE_HARDWARE ;
+        attr.config = config [j] ;
+        attr.exclude_kernel = 1 ;
+        attr.exclude_hv = 1 ;
+        Com->pfd [j] = (int) syscall (SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if ( Com->pfd [j] < 0 ) Com->pfd [j] = -1 ;
+        else                    Com->Counters = TRUE ;
+    }
+#endif
+    for (j = 0; j < CG_NCOUNT; j++)
+    {
+        Com->pval [j] = 0 ;
+        for (k = 0; k < CG_TNPHASE; k++) Com->Count [j][k] = ZERO ;
+    }
+    if ( Com->Counters ) cg_perf_charge (Com->tphase, Com) ;
+}
+
+/* =========================================================================
+   ==== cg_perf_charge =====================================================
+   =========================================================================
+   Read the counters and charge the counts since the last read to a part
+   ========================================================================= */
+PRIVATE void cg_perf_charge
+(
+    int     phase, /* part that is charged, CG_TKERNEL, ... */
+    cg_com   *Com
+)
+{
+#ifdef CG_PERF
+    int j ;
+    long long v ;
+    for (j = 0; j < CG_NCOUNT; j++)
+    {
+        if ( Com->pfd [j] < 0 ) continue ;
+        if ( read (Com->pfd [j], &v, sizeof (v)) != sizeof (v) ) continue ;
+        Com->Count [j][phase] += (double) (v - Com->pval [j]) ;
+        Com->pval [j] = v ;
+    }
+#endif
+}
+
+/* =========================================================================
+   ==== cg_perf_close ======================================================
+   =========================================================================
+   Close the hardware counters
+   ========================================================================= */
+PRIVATE void cg_perf_close
+(
+    cg_com   *Com
+)
+{
+#ifdef CG_PERF
+    int j ;
+    for (j = 0; j < CG_NCOUNT; j++)
+    {
+        if ( Com->pfd [j] >= 0 ) close (Com->pfd [j]) ;
+    }
+#endif
+}
+
+/* =========================================================================
+   ==== cg_perf_stats ======================================================
+   =========================================================================
+   Copy the counts of one counter to the statistics structure
+   ========================================================================= */
+PRIVATE void cg_perf_stats
+(
+    cg_timing   *T, /* counts in each part */
+    double      *C, /* Com->Count [k] */
+    int        fd   /* -1 => counter not opened */
+)
+{
+    if ( fd < 0 )
+    {
+        T->total = T->value = T->grad = T->valgrad = T->hessvec = T->kernel =
+        T->line = T->sub = -ONE ;
+        return ;
+    }
+    T->value = C [CG_TVALUE] ;
+    T->grad = C [CG_TGRAD] ;
+    T->valgrad = C [CG_TVALGRAD] ;
+    T->hessvec = C [CG_THESSVEC] ;
+    T->kernel = C [CG_TKERNEL] ;
+    T->line = C [CG_TLINE] ;
+    T->sub = C [CG_TSUB] ;
+    T->total = T->value + T->grad + T->valgrad + T->hessvec + T->kernel
+             + T->line + T->sub ;
+}
+
+/* =========================================================================
+   ==== cg_record ==========================================================
+   =========================================================================
+   Store a line search trial in the flight recorder. The recorder is a ring
+   buffer holding the last CG_NTRIAL trials; it is always active since the
+   cost is a few stores per function evaluation.
+   ========================================================================= */
+PRIVATE void cg_record
+(
+    int     phase, /* CG_START, CG_EXPAND, ..., CG_ARMIJO */
+    int      what, /* 1 = f, 2 = df, 3 = f and df evaluated */
+    double      a, /* left side of bracketing interval */
+    double      b, /* right side of bracketing interval */
+    cg_com   *Com
+)
+{
+    cg_trial *T ;
+    T = Com->Trial + (Com->ntrial % CG_NTRIAL) ;
+    T->iter = Com->iter ;
+    T->phase = phase ;
+    T->what = what ;
+    T->AWolfe = Com->AWolfe ;
+    T->alpha = Com->alpha ;
+    T->f = Com->f ;
+    T->df = Com->df ;
+    T->a = a ;
+    T->b = b ;
+    T->eps = Com->eps ;
+    Com->ntrial++ ;
+    if ( Com->Tracer != NULL )
+    {
+        cg_trace R ;
+        R.type = CG_TRACE_TRIAL ;
+        R.phase = phase ;
+        R.what = what ;
+        R.AWolfe = Com->AWolfe ;
+        R.iter = Com->iter ;
+        R.nf = Com->nf ;
+        R.ng = Com->ng ;
+        R.alpha = Com->alpha ;
+        R.f = Com->f ;
+        R.df = Com->df ;
+        R.gnorm = ZERO ;
+        R.a = a ;
+        R.b = b ;
+        R.eps = Com->eps ;
+        cg_trace_push (&R, Com->Tracer) ;
+    }
+}
+
+/* =========================================================================
+   ==== cg_flight ==========================================================
+   =========================================================================
+   Write the flight recorder as a single JSON line, oldest trial first.
+   Values that were not evaluated in a trial are written as null.
+   ========================================================================= */
+PRIVATE void cg_flight
+(
+    FILE    *file, /* output file */
+    int    status, /* return status of cg_descent */
+    cg_com   *Com
+)
+{
+    INT k, start ;
+    cg_trial *T ;
+
+    start = MAX (0, Com->ntrial - CG_NTRIAL) ;
+    fprintf (file, "{\"status\":%i,\"n\":%ld,\"iter\":%ld,\"nfunc\":%ld,"
+                   "\"ngrad\":%ld,\"neps\":%i,\"ntrial\":%ld,\"trials\":[",
+             status, (long) Com->n, (long) Com->iter, (long) Com->nf,
+             (long) Com->ng, Com->neps, (long) Com->ntrial) ;
+    for (k = start; k < Com->ntrial; k++)
+    {
+        T = Com->Trial + (k % CG_NTRIAL) ;
+        if ( k > start ) fprintf (file, ",") ;
+        fprintf (file, "{\"iter\":%ld,\"phase\":\"%s\",\"AWolfe\":%i,"
+                       "\"alpha\":", (long) T->iter, cg_phase [T->phase],
+                       T->AWolfe) ;
+        cg_jnum (file, T->alpha) ;
+        fprintf (file, ",\"f\":") ;
+        if ( T->what & 1 ) cg_jnum (file, T->f) ;
+        else               fprintf (file, "null") ;
+        fprintf (file, ",\"df\":") ;
+        if ( T->what & 2 ) cg_jnum (file, T->df) ;
+        else               fprintf (file, "null") ;
+        fprintf (file, ",\"a\":") ;
+        cg_jnum (file, T->a) ;
+        fprintf (file, ",\"b\":") ;
+        cg_jnum (file, T->b) ;
+        fprintf (file, ",\"eps\":") ;
+        cg_jnum (file, T->eps) ;
+        fprintf (file, "}") ;
+    }
+    fprintf (file, "]}\n") ;
+}
+
+/* =========================================================================
+   ==== cg_jnum ============================================================
+   =========================================================================
+   Print a number in JSON format, nan and inf are not valid JSON numbers
+   ========================================================================= */
+PRIVATE void cg_jnum
+(
+    FILE *file, /* output file */
+    double   x  /* number to print, nan or inf => null */
+)
+{
+    if ( (x != x) || (x >= INF) || (x <= -INF) ) fprintf (file, "null") ;
+    else                                         fprintf (file, "%.17g", x) ;
+}
+
+/* =========================================================================
+   ==== cg_trace_open ======================================================
+   =========================================================================
+   Open the trace file, write its header, and start the writer thread.
+   If the thread can not be created, the solver writes the records itself
+   each time the ring buffer fills. Returns NULL if the file can not be
+   opened or there is not enough memory.
+   ========================================================================= */
+PRIVATE cg_tracer *cg_trace_open
+(
+    char *TraceFile  /* name of the trace file */
+)
+{
+    int size ;
+    cg_tracer *T ;
+    T = (cg_tracer *) malloc (sizeof (cg_tracer)) ;
+    if ( T == NULL ) return (NULL) ;
+    T->Ring = (cg_trace *) malloc (CG_NTRACE*sizeof (cg_trace)) ;
+    T->file = fopen (TraceFile, "wb") ;
+    if ( (T->Ring == NULL) || (T->file == NULL) )
+    {
+        if ( T->file != NULL ) fclose (T->file) ;
+        free (T->Ring) ;
+        free (T) ;
+        return (NULL) ;
+    }
+    size = sizeof (cg_trace) ;
+    fwrite ("CGTRACE1", 1, 8, T->file) ;
+    fwrite (&size, sizeof (int), 1, T->file) ;
+    T->head = T->tail = 0 ;
+    T->done = FALSE ;
+    T->threaded = FALSE ;
+#ifdef CG_TRACE_THREAD
+    pthread_mutex_init (&T->lock, NULL) ;
+    pthread_cond_init (&T->wake, NULL) ;
+    pthread_cond_init (&T->room, NULL) ;
+    if ( !pthread_create (&T->thread, NULL, cg_trace_writer, T) )
+    {
+        T->threaded = TRUE ;
+    }
+#endif
+    return (T) ;
+}
+
+/* =========================================================================
+   ==== cg_trace_push ======================================================
+   =========================================================================
+   Queue a record in the ring buffer. Only the solver writes head and only
+   the writer writes tail, so no lock is needed to queue a record. When the
+   ring becomes half full, the writer thread is woken so that it does not
+   sleep until its timeout while the ring fills. When the ring is full, the
+   solver wakes the writer and sleeps until it has written records, or
+   without a thread, writes the ring to the file.
+   ========================================================================= */
+PRIVATE void cg_trace_push
+(
+    cg_trace   *R, /* record to queue */
+    cg_tracer  *T  /* trace writer */
+)
+{
+    INT head ;
+    head = T->head ;
+    while ( head - CG_LOAD (&T->tail) >= CG_NTRACE )
+    {
+#ifdef CG_TRACE_THREAD
+        if ( T->threaded )
+        {
+            /* the writer signals room with the lock held after it moved
+               tail, so the signal can not be lost between test and wait */
+            pthread_mutex_lock (&T->lock) ;
+            if ( head - CG_LOAD (&T->tail) >= CG_NTRACE )
+            {
+                pthread_cond_signal (&T->wake) ;
+                pthread_cond_wait (&T->room, &T->lock) ;
+            }
+            pthread_mutex_unlock (&T->lock) ;
+        }
+        else cg_trace_flush (T, head) ;
+#else
+        cg_trace_flush (T, head) ;
+#endif
+    }
+    T->Ring [head % CG_NTRACE] = *R ;
+    CG_STORE (&T->head, head+1) ;
+#ifdef CG_TRACE_THREAD
+    if ( T->threaded && (head+1 - CG_LOAD (&T->tail) == CG_NTRACE/2) )
+    {
+        pthread_mutex_lock (&T->lock) ;
+        pthread_cond_signal (&T->wake) ;
+        pthread_mutex_unlock (&T->lock) ;
+    }
+#endif
+}
+
+/* =========================================================================
+   ==== cg_trace_iter ======================================================
+   =========================================================================
+   Queue the record describing the end of an iteration
+   ========================================================================= */
+PRIVATE void cg_trace_iter
+(
+    double    alpha, /* accepted stepsize */
+    double        f, /* function value */
+    double    gnorm, /* gradient sup-norm */
+    double    dphi0, /* derivative along new search direction */
+    int    Subspace, /* T (iteration in the subspace) */
+    int        memk, /* number of vectors in memory */
+    cg_com     *Com
+)
+{
+    cg_trace R ;
+    R.type = CG_TRACE_ITER ;
+    R.phase = Subspace ;
+    R.what = memk ;
+    R.AWolfe = Com->AWolfe ;
+    R.iter = Com->iter ;
+    R.nf = Com->nf ;
+    R.ng = Com->ng ;
+    R.alpha = alpha ;
+    R.f = f ;
+    R.df = dphi0 ;
+    R.gnorm = gnorm ;
+    R.a = R.b = ZERO ;
+    R.eps = Com->eps ;
+    cg_trace_push (&R, Com->Tracer) ;
+}
+
+/* =========================================================================
+   ==== cg_trace_flush =====================================================
+   =========================================================================
+   Write the queued records before head to the file, at most two fwrite
+   calls since the records may wrap around the end of the ring
+   ========================================================================= */
+PRIVATE void cg_trace_flush
+(
+    cg_tracer  *T, /* trace writer */
+    INT      head  /* write the records before head */
+)
+{
+    INT k, m, tail ;
+    tail = T->tail ;
+    while ( tail < head )
+    {
+        k = tail % CG_NTRACE ;
+        m = MIN (head - tail, CG_NTRACE - k) ;
+        fwrite (T->Ring + k, sizeof (cg_trace), m, T->file) ;
+        tail += m ;
+    }
+    CG_STORE (&T->tail, tail) ;
+}
+
+#ifdef CG_TRACE_THREAD
+/* =========================================================================
+   ==== cg_trace_writer ====================================================
+   =========================================================================
+   Writer thread: move the records from the ring buffer to the file until
+   the solver is done and the ring is empty. done is read before head, so
+   when done is seen, every record pushed by the solver is visible. When
+   the ring is empty, the writer sleeps 10 ms, or until the solver wakes it
+   (the ring is half full or full, or cg_trace_close). After writing
+   records, it wakes the solver in case it waits for room in the ring.
+   ========================================================================= */
+PRIVATE void *cg_trace_writer
+(
+    void *Data  /* trace writer */
+)
+{
+    int done ;
+    INT head ;
+    cg_tracer *T ;
+    struct timespec wait ;
+    T = (cg_tracer *) Data ;
+    pthread_mutex_lock (&T->lock) ;
+    for (;;)
+    {
+        done = CG_LOAD (&T->done) ;
+        head = CG_LOAD (&T->head) ;
+        if ( head > T->tail )
+        {
+            pthread_mutex_unlock (&T->lock) ;
+            cg_trace_flush (T, head) ;
+            pthread_mutex_lock (&T->lock) ;
+            pthread_cond_signal (&T->room) ;
+        }
+        else if ( done ) break ;
+        else
+        {
+            clock_gettime (CLOCK_REALTIME, &wait) ;
+            wait.tv_nsec += 10000000 ;
+            if ( wait.tv_nsec >= 1000000000 )
+            {
+                wait.tv_sec++ ;
+                wait.tv_nsec -= 1000000000 ;
+            }
+            pthread_cond_timedwait (&T->wake, &T->lock, &wait) ;
+        }
+    }
+    pthread_mutex_unlock (&T->lock) ;
+    return (NULL) ;
+}
+#endif
+
+/* =========================================================================
+   ==== cg_trace_close =====================================================
+   =========================================================================
+   Write the remaining records, stop the writer thread, close the file
+   ========================================================================= */
+PRIVATE void cg_trace_close
+(
+    cg_tracer  *T  /* trace writer */
+)
+{
+#ifdef CG_TRACE_THREAD
+    pthread_mutex_lock (&T->lock) ;
+    CG_STORE (&T->done, TRUE) ;
+    pthread_cond_signal (&T->wake) ;
+    pthread_mutex_unlock (&T->lock) ;
+    if ( T->threaded ) pthread_join (T->thread, NULL) ;
+    pthread_mutex_destroy (&T->lock) ;
+    pthread_cond_destroy (&T->wake) ;
+    pthread_cond_destroy (&T->room) ;
+#else
+    CG_STORE (&T->done, TRUE) ;
+#endif
+    cg_trace_flush (T, T->head) ;
+    fclose (T->file) ;
+    free (T->Ring) ;
+    free (T) ;
+}
+
+/* =========================================================================
+   ==== cg_trace_json ======================================================
+   =========================================================================
+   Convert a trace file to JSON lines. An iteration is written as
+   {"type":"iter","iter":,"nfunc":,"ngrad":,"alpha":,"f":,"gnorm":,
+    "dphi0":,"memk":,"subspace":,"AWolfe":}
+   and a line search trial as
+   {"type":"trial","iter":,"nfunc":,"ngrad":,"phase":,"AWolfe":,"alpha":,
+    "f":,"df":,"a":,"b":,"eps":}
+   where values that were not evaluated in a trial are null. A truncated
+   record or a record with an unknown type or phase ends the conversion
+   with status 4.
+   ========================================================================= */
+int cg_trace_json
+(
+    char  *TraceFile, /* trace written by cg_descent (Parm->TraceFile) */
+    char   *JsonFile  /* output, one JSON object per line, NULL = stdout */
+)
+{
+    int size, status ;
+    size_t nread ;
+    char magic [8] ;
+    cg_trace R ;
+    FILE *in, *out ;
+
+    in = fopen (TraceFile, "rb") ;
+    if ( in == NULL ) return (1) ;
+    if ( (fread (magic, 1, 8, in) != 8) ||
+         (fread (&size, sizeof (int), 1, in) != 1) ||
+         strncmp (magic, "CGTRACE1", 8) || (size != sizeof (cg_trace)) )
+    {
+        fclose (in) ;
+        return (2) ;
+    }
+    if ( JsonFile == NULL ) out = stdout ;
+    else
+    {
+        out = fopen (JsonFile, "w") ;
+        if ( out == NULL )
+        {
+            fclose (in) ;
+            return (3) ;
+        }
+    }
+    status = 0 ;
+    while ( (nread = fread (&R, 1, sizeof (cg_trace), in)) > 0 )
+    {
+        if ( (nread < sizeof (cg_trace)) ||
+             ((R.type != CG_TRACE_ITER) && (R.type != CG_TRACE_TRIAL)) ||
+             ((R.type == CG_TRACE_TRIAL) &&
+              ((R.phase < 0) || (R.phase >= CG_NORIGIN))) )
+        {
+            status = 4 ;
+            break ;
+        }
+        if ( R.type == CG_TRACE_ITER )
+        {
+            fprintf (out, "{\"type\":\"iter\",\"iter\":%ld,\"nfunc\":%ld,"
+                          "\"ngrad\":%ld,\"alpha\":", (long) R.iter,
+                          (long) R.nf, (long) R.ng) ;
+            cg_jnum (out, R.alpha) ;
+            fprintf (out, ",\"f\":") ;
+            cg_jnum (out, R.f) ;
+            fprintf (out, ",\"gnorm\":") ;
+            cg_jnum (out, R.gnorm) ;
+            fprintf (out, ",\"dphi0\":") ;
+            cg_jnum (out, R.df) ;
+            fprintf (out, ",\"memk\":%i,\"subspace\":%i,\"AWolfe\":%i}\n",
+                     R.what, R.phase, R.AWolfe) ;
+        }
+        else
+        {
+            fprintf (out, "{\"type\":\"trial\",\"iter\":%ld,\"nfunc\":%ld,"
+                          "\"ngrad\":%ld,\"phase\":\"%s\",\"AWolfe\":%i,"
+                          "\"alpha\":", (long) R.iter, (long) R.nf,
+                          (long) R.ng, cg_phase [R.phase], R.AWolfe) ;
+            cg_jnum (out, R.alpha) ;
+            fprintf (out, ",\"f\":") ;
+            if ( R.what & 1 ) cg_jnum (out, R.f) ;
+            else              fprintf (out, "null") ;
+            fprintf (out, ",\"df\":") ;
+            if ( R.what & 2 ) cg_jnum (out, R.df) ;
+            else              fprintf (out, "null") ;
+            fprintf (out, ",\"a\":") ;
+            cg_jnum (out, R.a) ;
+            fprintf (out, ",\"b\":") ;
+            cg_jnum (out, R.b) ;
+            fprintf (out, ",\"eps\":") ;
+            cg_jnum (out, R.eps) ;
+            fprintf (out, "}\n") ;
+        }
+    }
+    fclose (in) ;
+    if ( out != stdout ) fclose (out) ;
+    return (status) ;
+}
+
+/* =========================================================================
+   ==== cg_newton ==========================================================
+   =========================================================================
+   Truncated Newton direction: approximately solve H d = -g, H the Hessian
+   at Com->x, by linear CG starting from d = 0. The iteration stops when
+   ||H d + g|| <= eta ||g||, eta = min (NewtonEta, sqrt (||g||)), after
+   min (NewtonMaxit, n) iterations, or when a CG direction p has
+   p'Hp <= 0. Every accepted iterate is a descent direction; if the first
+   p already has nonpositive curvature, d = -g. Returns the number of
+   inner iterations (Hessian-vector products).
+   ========================================================================= */
+PRIVATE INT cg_newton
+(
+    double     *d, /* output: search direction */
+    double     *g, /* gradient at x */
+    double gnorm2, /* ||g||^2 */
+    double     *w, /* work array of length 3n */
+    cg_com   *Com
+)
+{
+    INT it, maxit, n ;
+    int k ;
+    double a, eta, pHp, rr, rrnew, stop, *r, *p, *Hp ;
+    cg_parameter *Parm ;
+    Parm = Com->Parm ;
+    n = Com->n ;
+    r = w ;         /* residual H d + g */
+    p = r + n ;     /* CG direction */
+    Hp = p + n ;    /* H*p */
+    eta = MIN (Parm->NewtonEta, sqrt (sqrt (gnorm2))) ;
+    stop = eta*eta*gnorm2 ;
+    maxit = MIN (Parm->NewtonMaxit, n) ;
+    cg_init (d, ZERO, n) ;
+    cg_copy (r, g, n) ;
+    cg_scale (p, g, -ONE, n) ;
+    rr = gnorm2 ;
+    for (it = 0; it < maxit; it++)
+    {
+        if ( Com->Timing )
+        {
+            k = cg_clock (CG_THESSVEC, Com) ;
+            Com->cg_hessvec (Hp, p, Com->x, n) ;
+            cg_clock (k, Com) ;
+        }
+        else Com->cg_hessvec (Hp, p, Com->x, n) ;
+        Com->nh++ ;
+        pHp = cg_dot (p, Hp, n) ;
+        if ( pHp <= ZERO ) /* nonpositive curvature */
+        {
+            if ( it == 0 ) cg_copy (d, p, n) ;
+            it++ ;
+            break ;
+        }
+        a = rr/pHp ;
+        cg_daxpy (d, p, a, n) ;
+        cg_daxpy (r, Hp, a, n) ;
+        rrnew = cg_dot (r, r, n) ;
+        if ( rrnew <= stop )
+        {
+            it++ ;
+            break ;
+        }
+        /* p = -r + (rrnew/rr) p */
+        cg_update_d (p, r, rrnew/rr, NULL, n) ;
+        rr = rrnew ;
+    }
+    return (it) ;
+}
+
+/* =========================================================================
+   ==== cg_hess ============================================================
+   =========================================================================
+   Evaluate Hd = H(x)*d with the user's Hessian-vector product routine and
+   return the curvature d'Hd along the search direction. The product is
+   stored in gtemp, which is free until the line search evaluates the
+   gradient at the trial point.
+   ========================================================================= */
+PRIVATE double cg_hess
+(
+    double   *HdHd, /* ||Hd||^2 */
+    double     *dd, /* ||d||^2 */
+    cg_com    *Com
+)
+{
+    INT i, n, n5 ;
+    int k ;
+    double dHd, s, t, u, *d, *Hd ;
+    n = Com->n ;
+    d = Com->d ;
+    Hd = Com->gtemp ;
+    if ( Com->Timing )
+    {
+        k = cg_clock (CG_THESSVEC, Com) ;
+        Com->cg_hessvec (Hd, d, Com->x, n) ;
+        cg_clock (k, Com) ;
+    }
+    else Com->cg_hessvec (Hd, d, Com->x, n) ;
+    Com->nh++ ;
+    dHd = s = t = ZERO ;
+    n5 = n % 5 ;
+    for (i = 0; i < n5; i++)
+    {
+        u = Hd [i] ;
+        dHd += d [i]*u ;
+        s += u*u ;
+        t += d [i]*d [i] ;
+    }
+    for (; i < n; i += 5)
+    {
+        dHd += d [i]*Hd [i] + d [i+1]*Hd [i+1] + d [i+2]*Hd [i+2]
+                            + d [i+3]*Hd [i+3] + d [i+4]*Hd [i+4] ;
+        s += Hd [i]*Hd [i] + Hd [i+1]*Hd [i+1] + Hd [i+2]*Hd [i+2]
+                           + Hd [i+3]*Hd [i+3] + Hd [i+4]*Hd [i+4] ;
+        t += d [i]*d [i] + d [i+1]*d [i+1] + d [i+2]*d [i+2]
+                         + d [i+3]*d [i+3] + d [i+4]*d [i+4] ;
+    }
+    *HdHd = s ;
+    *dd = t ;
+    return (dHd) ;
+}
+
+/* =========================================================================
+   ==== cg_adapt ===========================================================
+   =========================================================================
+   Adapt the memory size Com->memA (Parm->AdaptMemory). The iterations are
+   grouped in windows of MAX (10, 2*memA) iterations. At the end of a
+   window, its rate is the decrease of log |g| per second, which measures
+   both the progress per iteration and the cost of an iteration. The
+   memory keeps moving in the same direction while the rate improves and
+   turns around when it gets worse. It grows by half and shrinks by a
+   third, so that a step back returns to the previous size. The memory is
+   not increased while the time of the memory linear algebra in the
+   window exceeds AdaptCost times the time of the user's routines. With
+   Parm->AdaptEvals, the time is replaced by the weighted evaluation cost
+   ValueCost*nf + GradCost*ng and the test of AdaptCost is skipped, so
+   the memory sizes do not depend on the timing.
+   ========================================================================= */
+PRIVATE void cg_adapt
+(
+    double   gnorm, /* |g| at the current iterate */
+    cg_com    *Com
+)
+{
+    int m ;
+    double lg, rate, t, tuser, tsub ;
+    cg_parameter *Parm ;
+    if ( gnorm <= ZERO ) return ;
+    cg_clock (Com->tphase, Com) ; /* charge the current part up to now */
+    lg = log (gnorm) ;
+    Parm = Com->Parm ;
+    if ( Parm->AdaptEvals )
+    {
+        t = Parm->ValueCost*Com->nf + Parm->GradCost*Com->ng ;
+    }
+    else t = Com->tlast - Com->tstart ;
+    tuser = Com->Time [CG_TVALUE] + Com->Time [CG_TGRAD]
+          + Com->Time [CG_TVALGRAD] ;
+    tsub = Com->Time [CG_TSUB] ;
+    m = Com->memA ;
+    if ( Com->adapt_start >= 0 )
+    {
+        if ( Com->iter - Com->adapt_start < MAX (10, 2*m) ) return ;
+        if ( t > Com->adapt_time ) rate = (Com->adapt_g-lg)/(t-Com->adapt_time);
+        else                       rate = Com->adapt_g - lg ;
+        if ( rate < Com->adapt_rate ) Com->adapt_dir = -Com->adapt_dir ;
+        if ( (Com->adapt_dir > 0) && !Parm->AdaptEvals &&
+             (tsub - Com->adapt_sub > Parm->AdaptCost*(tuser-Com->adapt_user)))
+        {
+            Com->adapt_dir = -1 ;
+        }
+        if ( Com->adapt_dir > 0 ) m += MAX (1, m/2) ;
+        else                      m -= MAX (1, m/3) ;
+        m = MAX (m, MIN (3, Com->memAmax)) ;
+        m = MIN (m, Com->memAmax) ;
+        if ( m == Com->memA ) Com->adapt_dir = -Com->adapt_dir ; /* bound */
+        if ( (Parm->PrintLevel >= 1) && (m != Com->memA) )
         {
-            cg_step (xtemp, x, d, alpha, n) ;
-            Com->cg_grad (gtemp, xtemp, n) ;
-            Com->ng++ ;
-            Com->df = cg_dot (gtemp, d, n) ;
-            /* reduce stepsize if derivative is nan */
-            if ( (Com->df != Com->df) || (Com->df >= INF) || (Com->df <= -INF) )
-            {
-                for (i = 0; i < Parm->ntries; i++)
-                {
-                    if ( !strcmp (nan, "p") ) /* contract from good alpha */
-                    {
-                        alpha = Com->alphaold + .8*(alpha - Com->alphaold) ;
-                    }
-                    else                      /* multiply by nan_decay */
-                    {
-                        alpha *= Parm->nan_decay ;
-                    }
-                    cg_step (xtemp, x, d, alpha, n) ;
-                    Com->cg_grad (gtemp, xtemp, n) ;
-                    Com->ng++ ;
-                    Com->df = cg_dot (gtemp, d, n) ;
-                    if ( (Com->df == Com->df) && (Com->df < INF) &&
-                         (Com->df > -INF) ) break ;
-                }
-                if ( i == Parm->ntries ) return (11) ;
-                Com->rho = Parm->nan_rho ;
-            }
-            else Com->rho = Parm->rho ;
-            Com->alpha = alpha ;
+            printf ("iter: %i memory %i -> %i\n", (int) Com->iter,
+                     Com->memA, m) ;
         }
-        else                            /* compute function and gradient */
+        Com->memA = m ;
+        Com->adapt_rate = rate ;
+    }
+    Com->adapt_start = Com->iter ;
+    Com->adapt_g = lg ;
+    Com->adapt_time = t ;
+    Com->adapt_user = tuser ;
+    Com->adapt_sub = tsub ;
+}
+
+/* =========================================================================
+   ==== cg_bns =============================================================
+   =========================================================================
+   L-BFGS direction d = -Hg from the compact representation of Byrd,
+   Nocedal, and Schnabel (Representations of quasi-Newton matrices and
+   their use in limited memory methods, Math. Prog., 63 (1994), 129-156):
+
+       H = gamma I + [S gamma*Y] [ inv(R')(D + gamma Y'Y) inv(R)  -inv(R') ]
+                                 [              -inv(R)                0  ]
+                                 [S gamma*Y]'
+
+   where R is the upper triangle of S'Y and D its diagonal. S'g and Y'g
+   come from one blocked pass over the memory (cg_bns_dots), d from a
+   second one (cg_bns_dir); the two-loop recursion makes four passes. The
+   new columns of R and Y'Y are S'y = S'g - S'gold and Y'y = Y'g - Y'gold
+   with the products of the previous call, so only s'y and y'y of the
+   newest pair take a product with y. R, Y'Y, S'g, and Y'g are kept in
+   Bns in the order of the pairs from oldest to newest, and are shifted
+   when the oldest pairs are dropped. Returns d'g.
+   ========================================================================= */
+PRIVATE double cg_bns
+(
+    double        *d, /* output: search direction -Hg */
+    double        *g, /* gradient */
+    double    gnorm2, /* ||g||^2 */
+    double   *dnorm2, /* output: ||d||^2 */
+    double    *scale, /* initial matrix scale*I, updated unless hscale
+                         is given or y'y = 0 */
+    double    hscale, /* > 0 => use this scale */
+    double       *Sk, /* s vectors, mem by n, circular */
+    double       *Yk, /* y vectors */
+    double      *Bns, /* 2*mem*mem + 6*mem work, kept between calls */
+    int        mlast, /* newest pair */
+    int         memk, /* number of pairs */
+    int          mem, /* size of the memory */
+    int        shift, /* number of oldest pairs dropped since the previous
+                         call, 1 when the oldest pair was replaced */
+    INT            n
+)
+{
+    int j, k, l ;
+    double gamma, sy, yy, t, gHg, *R, *YY, *Sg, *Yg, *Sgold, *Ygold, *u, *p ;
+    R = Bns ;           /* R (j, k) = s_j'y_k, j <= k, leading dimension mem */
+    YY = R + mem*mem ;  /* Y'Y */
+    Sg = YY + mem*mem ; /* S'g */
+    Yg = Sg + mem ;     /* Y'g */
+    Sgold = Yg + mem ;  /* S'g and Y'g of the previous call */
+    Ygold = Sgold + mem ;
+    u = Ygold + mem ;
+    p = u + mem ;
+    l = memk - 1 ;      /* the newest pair */
+    if ( shift )
+    {
+        for (k = 0; k < l; k++)
         {
-            cg_step (xtemp, x, d, alpha, n) ;
-            if ( Com->cg_valgrad != NULL )
-            {
-                Com->f = Com->cg_valgrad (gtemp, xtemp, n) ;
-            }
-            else
+            for (j = 0; j <= k; j++)
             {
-                Com->cg_grad (gtemp, xtemp, n) ;
-                Com->f = Com->cg_value (xtemp, n) ;
+                R [k*mem+j] = R [(k+shift)*mem+j+shift] ;
             }
-            Com->df = cg_dot (gtemp, d, n) ;
-            Com->nf++ ;
-            Com->ng++ ;
-            /* reduce stepsize if function value or derivative is nan */
-            if ( (Com->df !=  Com->df) || (Com->f != Com->f) ||
-                 (Com->df >=  INF)     || (Com->f >= INF)    ||
-                 (Com->df <= -INF)     || (Com->f <= -INF))
+            for (j = 0; j < l; j++)
             {
-                for (i = 0; i < Parm->ntries; i++)
-                {
-                    if ( !strcmp (nan, "p") ) /* contract from good alpha */
-                    {
-                        alpha = Com->alphaold + .8*(alpha - Com->alphaold) ;
-                    }
-                    else                      /* multiply by nan_decay */
-                    {
-                        alpha *= Parm->nan_decay ;
-                    }
-                    cg_step (xtemp, x, d, alpha, n) ;
-                    if ( Com->cg_valgrad != NULL )
-                    {
-                        Com->f = Com->cg_valgrad (gtemp, xtemp, n) ;
-                    }
-                    else
-                    {
-                        Com->cg_grad (gtemp, xtemp, n) ;
-                        Com->f = Com->cg_value (xtemp, n) ;
-                    }
-                    Com->df = cg_dot (gtemp, d, n) ;
-                    Com->nf++ ;
-                    Com->ng++ ;
-                    if ( (Com->df == Com->df) && (Com->f == Com->f) &&
-                         (Com->df <  INF)     && (Com->f <  INF)    &&
-                         (Com->df > -INF)     && (Com->f > -INF) ) break ;
-                }
-                if ( i == Parm->ntries ) return (11) ;
-                Com->rho = Parm->nan_rho ;
+                YY [k*mem+j] = YY [(k+shift)*mem+j+shift] ;
             }
-            else Com->rho = Parm->rho ;
-            Com->alpha = alpha ;
         }
     }
-    else                                /* evaluate without nan checking */
+    for (j = 0; j < l; j++)
     {
-        if ( !strcmp (what, "fg") )     /* compute function and gradient */
+        Sgold [j] = Sg [j+shift] ;
+        Ygold [j] = Yg [j+shift] ;
+    }
+    cg_bns_dots (Sg, Yg, &sy, &yy, g, Sk, Yk, mlast, memk, mem, n) ;
+    for (j = 0; j < l; j++)
+    {
+        R [l*mem+j] = Sg [j] - Sgold [j] ;
+        YY [l*mem+j] = YY [j*mem+l] = Yg [j] - Ygold [j] ;
+    }
+    R [l*mem+l] = sy ;
+    YY [l*mem+l] = yy ;
+    if ( hscale > ZERO )  *scale = hscale ;
+    else if ( yy > ZERO ) *scale = sy/yy ;
+    gamma = *scale ;
+
+    /* u = inv(R) S'g, p = inv(R') ((D + gamma Y'Y) u - gamma Y'g) */
+    for (j = 0; j < memk; j++) u [j] = Sg [j] ;
+    cg_trisolve (u, R, mem, memk, TRUE) ;
+    for (j = 0; j < memk; j++)
+    {
+        t = R [j*mem+j]*u [j] ;
+        for (k = 0; k < memk; k++) t += gamma*YY [k*mem+j]*u [k] ;
+        p [j] = t - gamma*Yg [j] ;
+    }
+    cg_trisolve (p, R, mem, memk, FALSE) ;
+
+    /* g'Hg = gamma g'g + (S'g)'p - gamma (Y'g)'u */
+    gHg = gamma*gnorm2 ;
+    for (j = 0; j < memk; j++) gHg += Sg [j]*p [j] - gamma*Yg [j]*u [j] ;
+    *dnorm2 = cg_bns_dir (d, g, gamma, p, u, Sk, Yk, mlast, memk, mem, n) ;
+    return (-gHg) ;
+}
+
+/* =========================================================================
+   ==== cg_bns_dots ========================================================
+   =========================================================================
+   Compute S'g and Y'g, and s'y and y'y of the newest pair, in one pass
+   over the memory. For each block of CG_BLOCK elements, the blocks of all
+   the pairs are read while the block of g stays in the cache.
+   ========================================================================= */
+PRIVATE void cg_bns_dots
+(
+    double       *Sg, /* output: s_k'g for the pairs from oldest to newest */
+    double       *Yg, /* output: y_k'g */
+    double       *sy, /* output: s'y of the newest pair */
+    double       *yy, /* output: y'y of the newest pair */
+    double        *g, /* gradient */
+    double       *Sk, /* s vectors, mem by n, circular */
+    double       *Yk, /* y vectors */
+    int        mlast, /* newest pair */
+    int         memk, /* number of pairs */
+    int          mem, /* size of the memory */
+    INT            n
+)
+{
+    INT i, i0, i1 ;
+    int k ;
+    double a, b, c, e, *s, *t ;
+    CG_KWORK (2*memk*n + n, 4*memk*n + 4*n) ;
+    for (k = 0; k < memk; k++) Sg [k] = Yg [k] = ZERO ;
+    c = e = ZERO ;
+    for (i0 = 0; i0 < n; i0 += CG_BLOCK)
+    {
+        i1 = MIN (i0 + CG_BLOCK, n) ;
+        for (k = 0; k < memk; k++)
         {
-            if ( alpha == ZERO )        /* evaluate at x */
+            s = Sk + ((mlast - memk + 1 + k + mem) % mem)*n ;
+            t = Yk + (s - Sk) ;
+            a = b = ZERO ;
+            if ( k < memk-1 )
             {
-                /* the following copy is not needed except when the code
-                   is run using the MATLAB mex interface */
-                cg_copy (xtemp, x, n) ;
-                if ( Com->cg_valgrad != NULL )
-                {
-                    Com->f = Com->cg_valgrad (Com->g, xtemp, n) ;
-                }
-                else
+                for (i = i0; i < i1; i++)
                 {
-                    Com->cg_grad (Com->g, xtemp, n) ;
-                    Com->f = Com->cg_value (xtemp, n) ;
+                    a += s [i]*g [i] ;
+                    b += t [i]*g [i] ;
                 }
             }
-            else
+            else /* the newest pair */
             {
-                cg_step (xtemp, x, d, alpha, n) ;
-                if ( Com->cg_valgrad != NULL )
-                {
-                    Com->f = Com->cg_valgrad (gtemp, xtemp, n) ;
-                }
-                else
+                for (i = i0; i < i1; i++)
                 {
-                    Com->cg_grad (gtemp, xtemp, n) ;
-                    Com->f = Com->cg_value (xtemp, n) ;
+                    a += s [i]*g [i] ;
+                    b += t [i]*g [i] ;
+                    c += s [i]*t [i] ;
+                    e += t [i]*t [i] ;
                 }
-                Com->df = cg_dot (gtemp, d, n) ;
             }
-            Com->nf++ ;
-            Com->ng++ ;
-            if ( (Com->df != Com->df) || (Com->f != Com->f) ||
-                 (Com->df == INF)     || (Com->f == INF)    ||
-                 (Com->df ==-INF)     || (Com->f ==-INF) ) return (11) ;
+            Sg [k] += a ;
+            Yg [k] += b ;
         }
-        else if ( !strcmp (what, "f") ) /* compute function */
+    }
+    *sy = c ;
+    *yy = e ;
+}
+
+/* =========================================================================
+   ==== cg_bns_dir =========================================================
+   =========================================================================
+   Compute d = -(gamma*g + sum p_k s_k - gamma sum u_k y_k) in one pass over
+   the memory, block by block as in cg_bns_dots. Returns ||d||^2.
+   ========================================================================= */
+PRIVATE double cg_bns_dir
+(
+    double        *d, /* output: d = -(gamma*g + S*p - gamma*Y*u) */
+    double        *g, /* gradient */
+    double     gamma, /* scale of the initial matrix */
+    double        *p, /* coefficients of the s vectors, oldest first */
+    double        *u, /* coefficients of the y vectors, oldest first */
+    double       *Sk, /* s vectors, mem by n, circular */
+    double       *Yk, /* y vectors */
+    int        mlast, /* newest pair */
+    int         memk, /* number of pairs */
+    int          mem, /* size of the memory */
+    INT            n
+)
+{
+    INT i, i0, i1 ;
+    int k ;
+    double a, b, dnorm2, *s, *t ;
+    CG_KWORK (2*memk*n + 2*n, (4*memk+3)*n) ;
+    dnorm2 = ZERO ;
+    for (i0 = 0; i0 < n; i0 += CG_BLOCK)
+    {
+        i1 = MIN (i0 + CG_BLOCK, n) ;
+        for (i = i0; i < i1; i++) d [i] = gamma*g [i] ;
+        for (k = 0; k < memk; k++)
         {
-            cg_step (xtemp, x, d, alpha, n) ;
-            Com->f = Com->cg_value (xtemp, n) ;
-            Com->nf++ ;
-            if ( (Com->f != Com->f) || (Com->f == INF) || (Com->f ==-INF) )
-                return (11) ;
+            s = Sk + ((mlast - memk + 1 + k + mem) % mem)*n ;
+            t = Yk + (s - Sk) ;
+            a = p [k] ;
+            b = -gamma*u [k] ;
+            for (i = i0; i < i1; i++) d [i] += a*s [i] + b*t [i] ;
         }
-        else
+        for (i = i0; i < i1; i++)
         {
-            cg_step (xtemp, x, d, alpha, n) ;
-            Com->cg_grad (gtemp, xtemp, n) ;
-            Com->df = cg_dot (gtemp, d, n) ;
-            Com->ng++ ;
-            if ( (Com->df != Com->df) || (Com->df == INF) || (Com->df ==-INF) )
-                return (11) ;
+            d [i] = -d [i] ;
+            dnorm2 += d [i]*d [i] ;
         }
     }
-    return (0) ;
+    return (dnorm2) ;
 }
 
 /* =========================================================================
@@ -2533,6 +5154,7 @@ PRIVATE void cg_matvec
     {
         M = (BLAS_INT) m ;
         N = (BLAS_INT) n ;
+        CG_KWORK (m*n + m + n, 2*m*n) ;
         /* only use transpose mult with blas
         CG_DGEMV ("n", &M, &N, one, A, &M, x, blas_one, zero, y, blas_one) ;*/
         CG_DGEMV ("t", &M, &N, one, A, &M, x, blas_one, zero, y, blas_one) ;
@@ -2603,6 +5225,7 @@ PRIVATE double cg_inf
 #ifdef NOBLAS
     INT i, n5 ;
     double t ;
+    CG_KWORK (n, n) ;
     t = ZERO ;
     n5 = n % 5 ;
 
@@ -2622,6 +5245,7 @@ PRIVATE double cg_inf
     INT i, n5 ;
     double t ;
     BLAS_INT N ;
+    CG_KWORK (n, n) ;
     if ( n < IDAMAX_START )
     {
         t = ZERO ;
@@ -2661,6 +5285,7 @@ PRIVATE void cg_scale0
 )
 {
     int i, n5 ;
+    CG_KWORK (2*n, n) ;
     n5 = n % 5 ;
     if ( s == -ONE)
     {
@@ -2713,6 +5338,7 @@ PRIVATE void cg_scale
 )
 {
     INT i, n5 ;
+    CG_KWORK (2*n, n) ;
     n5 = n % 5 ;
     if ( y == x)
     {
@@ -2792,6 +5418,7 @@ PRIVATE void cg_daxpy0
 )
 {
     INT i, n5 ;
+    CG_KWORK (3*n, 2*n) ;
     n5 = n % 5 ;
     if (alpha == -ONE)
     {
@@ -2835,6 +5462,7 @@ PRIVATE void cg_daxpy
 {
 #ifdef NOBLAS
     INT i, n5 ;
+    CG_KWORK (3*n, 2*n) ;
     n5 = n % 5 ;
     if (alpha == -ONE)
     {
@@ -2865,6 +5493,7 @@ PRIVATE void cg_daxpy
 #ifndef NOBLAS
     INT i, n5 ;
     BLAS_INT N ;
+    CG_KWORK (3*n, 2*n) ;
     if ( n < DAXPY_START )
     {
         n5 = n % 5 ;
@@ -2919,6 +5548,7 @@ PRIVATE double cg_dot0
     double t ;
     t = ZERO ;
     if ( n <= 0 ) return (t) ;
+    CG_KWORK (2*n, 2*n) ;
     n5 = n % 5 ;
     for (i = 0; i < n5; i++) t += x [i]*y [i] ;
     for (; i < n; i += 5)
@@ -2944,6 +5574,7 @@ PRIVATE double cg_dot
 #ifdef NOBLAS
     INT i, n5 ;
     double t ;
+    CG_KWORK (2*n, 2*n) ;
     t = ZERO ;
     if ( n <= 0 ) return (t) ;
     n5 = n % 5 ;
@@ -2960,6 +5591,7 @@ PRIVATE double cg_dot
     INT i, n5 ;
     double t ;
     BLAS_INT N ;
+    CG_KWORK (2*n, 2*n) ;
     if ( n < DDOT_START )
     {
         t = ZERO ;
@@ -2994,6 +5626,7 @@ PRIVATE void cg_copy0
 )
 {
     int i, n5 ;
+    CG_KWORK (2*n, 0) ;
     n5 = n % 5 ;
     for (i = 0; i < n5; i++) y [i] = x [i] ;
     for (; i < n; )
@@ -3026,6 +5659,7 @@ PRIVATE void cg_copy
 {
 #ifdef NOBLAS
     INT i, n5 ;
+    CG_KWORK (2*n, 0) ;
     n5 = n % 5 ;
     for (i = 0; i < n5; i++) y [i] = x [i] ;
     for (; i < n; )
@@ -3046,6 +5680,7 @@ PRIVATE void cg_copy
 #ifndef NOBLAS
     INT i, n5 ;
     BLAS_INT N ;
+    CG_KWORK (2*n, 0) ;
     if ( n < DCOPY_START )
     {
         n5 = n % 5 ;
@@ -3093,6 +5728,7 @@ PRIVATE void cg_step
 )
 {
     INT n5, i ;
+    CG_KWORK (3*n, 2*n) ;
     n5 = n % 5 ;
     if (alpha == -ONE)
     {
@@ -3134,6 +5770,7 @@ PRIVATE void cg_init
 )
 {
     INT i, n5 ;
+    CG_KWORK (n, 0) ;
     n5 = n % 5 ;
     for (i = 0; i < n5; i++) x [i] = s ;
     for (; i < n;)
@@ -3169,6 +5806,7 @@ PRIVATE double cg_update_2
     INT i, n5 ;
     double s, t ;
     t = ZERO ;
+    CG_KWORK (n*(1 + (gold != NULL) + (d != NULL)), 2*n) ;
     n5 = n % 5 ;
 
     if ( d == NULL )
@@ -3304,6 +5942,7 @@ PRIVATE double cg_update_inf
     INT i, n5 ;
     double s, t ;
     t = ZERO ;
+    CG_KWORK (n*(1 + (gold != NULL) + (d != NULL)), n) ;
     n5 = n % 5 ;
 
     if ( d == NULL )
@@ -3407,6 +6046,7 @@ PRIVATE double cg_update_ykyk
     gnorm = ZERO ;
     ykyk = ZERO ;
     ykgk = ZERO ;
+    CG_KWORK (3*n, 6*n) ;
     n5 = n % 5 ;
 
     for (i = 0; i < n5; i++)
@@ -3483,6 +6123,7 @@ PRIVATE double cg_update_inf2
     double gnorm, s, t ;
     gnorm = ZERO ;
     s = ZERO ;
+    CG_KWORK (3*n, 3*n) ;
     n5 = n % 5 ;
 
     for (i = 0; i < n5; i++)
@@ -3552,6 +6193,7 @@ PRIVATE double cg_update_d
     double dnorm2, s, t ;
     s = ZERO ;
     dnorm2 = ZERO ;
+    CG_KWORK (3*n, n*(4 + 2*(gnorm2 != NULL))) ;
     n5 = n % 5 ;
     if ( gnorm2 == NULL )
     {
@@ -3665,6 +6307,7 @@ PRIVATE void cg_Yk
 {
     INT n5, i ;
     double s, t ;
+    CG_KWORK (n*(3 + (y != NULL)), n*(1 + 2*(yty != NULL))) ;
     n5 = n % 5 ;
     if ( (y != NULL) && (yty == NULL) )
     {
@@ -3782,6 +6425,254 @@ PRIVATE void cg_Yk
     return ;
 }
 
+/* =========================================================================
+   ==== cg_sparse_step =====================================================
+   =========================================================================
+   Set xtemp = x + alpha*d. In the sparse mode, xtemp = x outside the
+   support of d, so only the entries of di are updated.
+   ========================================================================= */
+PRIVATE void cg_sparse_step
+(
+    double   alpha, /* stepsize */
+    cg_com    *Com
+)
+{
+    INT i, k, *di ;
+    double *d, *x, *xtemp ;
+    x = Com->x ;
+    d = Com->d ;
+    xtemp = Com->xtemp ;
+    if ( !Com->Sparse )
+    {
+        cg_step (xtemp, x, d, alpha, Com->n) ;
+        return ;
+    }
+    di = Com->di ;
+    CG_KWORK (4*Com->ndi, 2*Com->ndi) ;
+    for (k = 0; k < Com->ndi; k++)
+    {
+        i = di [k] ;
+        xtemp [i] = x [i] + alpha*d [i] ;
+    }
+}
+
+/* =========================================================================
+   ==== cg_sparse_dot ======================================================
+   =========================================================================
+   Return gtemp'd, in the sparse mode over the nonzeros of gtemp
+   ========================================================================= */
+PRIVATE double cg_sparse_dot
+(
+    cg_com    *Com
+)
+{
+    INT i, k, *gti ;
+    double s, *d, *gtemp ;
+    d = Com->d ;
+    gtemp = Com->gtemp ;
+    if ( !Com->Sparse ) return (cg_dot (gtemp, d, Com->n)) ;
+    gti = Com->gti ;
+    CG_KWORK (3*Com->ngti, 2*Com->ngti) ;
+    s = ZERO ;
+    for (k = 0; k < Com->ngti; k++)
+    {
+        i = gti [k] ;
+        s += gtemp [i]*d [i] ;
+    }
+    return (s) ;
+}
+
+/* =========================================================================
+   ==== cg_sparse_copy =====================================================
+   =========================================================================
+   Set x = xtemp over the support of d, where the two can differ
+   ========================================================================= */
+PRIVATE void cg_sparse_copy
+(
+    cg_com    *Com
+)
+{
+    INT i, k, *di ;
+    double *x, *xtemp ;
+    x = Com->x ;
+    xtemp = Com->xtemp ;
+    di = Com->di ;
+    CG_KWORK (3*Com->ndi, 0) ;
+    for (k = 0; k < Com->ndi; k++)
+    {
+        i = di [k] ;
+        x [i] = xtemp [i] ;
+    }
+}
+
+/* =========================================================================
+   ==== cg_sparse_restart ==================================================
+   =========================================================================
+   Sparse mode: set g = gtemp when copy is T, then d = -g with the support
+   of g. Return the infinity norm of g, its squared 2-norm in gnorm2.
+   ========================================================================= */
+PRIVATE double cg_sparse_restart
+(
+    double *gnorm2, /* 2-norm of g */
+    int       copy, /* T (first set g = gtemp) */
+    cg_com    *Com
+)
+{
+    INT i, k, *di, *gi, *gti ;
+    double gnorm, s, t, *d, *g, *gtemp ;
+    d = Com->d ;
+    g = Com->g ;
+    gtemp = Com->gtemp ;
+    di = Com->di ;
+    gi = Com->gi ;
+    gti = Com->gti ;
+
+    /* clear the old d */
+    for (k = 0; k < Com->ndi; k++)
+    {
+        i = di [k] ;
+        d [i] = ZERO ;
+        Com->dmark [i] = 0 ;
+    }
+    if ( copy )
+    {
+        for (k = 0; k < Com->ngi; k++) g [gi [k]] = ZERO ;
+        for (k = 0; k < Com->ngti; k++)
+        {
+            i = gti [k] ;
+            g [i] = gtemp [i] ;
+            gi [k] = i ;
+        }
+        Com->ngi = Com->ngti ;
+    }
+    CG_KWORK (2*Com->ndi + 5*Com->ngi, 3*Com->ngi) ;
+    gnorm = ZERO ;
+    s = ZERO ;
+    for (k = 0; k < Com->ngi; k++)
+    {
+        i = gi [k] ;
+        t = g [i] ;
+        d [i] = -t ;
+        di [k] = i ;
+        Com->dmark [i] = 1 ;
+        s += t*t ;
+        t = fabs (t) ;
+        if ( t > gnorm ) gnorm = t ;
+    }
+    Com->ndi = Com->ngi ;
+    *gnorm2 = s ;
+    return (gnorm) ;
+}
+
+/* =========================================================================
+   ==== cg_sparse_ykyk =====================================================
+   =========================================================================
+   Sparse mode version of cg_update_ykyk: set g = gtemp and compute
+   ykyk = ||gtemp-g||^2 and ykgk = (gtemp-g)'gtemp over the union of the
+   supports of g and gtemp. Return the infinity norm of gtemp.
+   ========================================================================= */
+PRIVATE double cg_sparse_ykyk
+(
+    double   *Ykyk,
+    double   *Ykgk,
+    cg_com    *Com
+)
+{
+    INT i, k, *gi, *gti ;
+    double gnorm, ykyk, ykgk, t, y, *g, *gtemp ;
+    char *gmark ;
+    g = Com->g ;
+    gtemp = Com->gtemp ;
+    gi = Com->gi ;
+    gti = Com->gti ;
+    gmark = Com->gmark ;
+    CG_KWORK (5*Com->ngti + 2*Com->ngi, 6*Com->ngti + 2*Com->ngi) ;
+    gnorm = ZERO ;
+    ykyk = ZERO ;
+    ykgk = ZERO ;
+    for (k = 0; k < Com->ngti; k++)
+    {
+        i = gti [k] ;
+        gmark [i] = 1 ;
+        t = gtemp [i] ;
+        y = t - g [i] ;
+        ykyk += y*y ;
+        ykgk += y*t ;
+        t = fabs (t) ;
+        if ( t > gnorm ) gnorm = t ;
+    }
+    /* entries where only the old g is nonzero, y = -g */
+    for (k = 0; k < Com->ngi; k++)
+    {
+        i = gi [k] ;
+        if ( !gmark [i] )
+        {
+            ykyk += g [i]*g [i] ;
+            g [i] = ZERO ;
+        }
+    }
+    for (k = 0; k < Com->ngti; k++)
+    {
+        i = gti [k] ;
+        gmark [i] = 0 ;
+        g [i] = gtemp [i] ;
+        gi [k] = i ;
+    }
+    Com->ngi = Com->ngti ;
+    *Ykyk = ykyk ;
+    *Ykgk = ykgk ;
+    return (gnorm) ;
+}
+
+/* =========================================================================
+   ==== cg_sparse_d ========================================================
+   =========================================================================
+   Sparse mode version of cg_update_d: set d = -g + beta*d, adding the
+   nonzeros of g to the support of d. Return the squared 2-norm of d, the
+   squared 2-norm of g in gnorm2.
+   ========================================================================= */
+PRIVATE double cg_sparse_d
+(
+    double    beta,
+    double *gnorm2, /* 2-norm of g */
+    cg_com    *Com
+)
+{
+    INT i, k, *di, *gi ;
+    double dnorm2, s, t, *d, *g ;
+    char *dmark ;
+    d = Com->d ;
+    g = Com->g ;
+    di = Com->di ;
+    gi = Com->gi ;
+    dmark = Com->dmark ;
+    CG_KWORK (4*Com->ndi + 3*Com->ngi, 4*Com->ndi + 2*Com->ngi) ;
+    dnorm2 = ZERO ;
+    for (k = 0; k < Com->ndi; k++)
+    {
+        i = di [k] ;
+        t = -g [i] + beta*d [i] ;
+        d [i] = t ;
+        dnorm2 += t*t ;
+    }
+    s = ZERO ;
+    for (k = 0; k < Com->ngi; k++)
+    {
+        i = gi [k] ;
+        t = g [i] ;
+        s += t*t ;
+        if ( !dmark [i] ) /* d was zero at i */
+        {
+            dmark [i] = 1 ;
+            di [Com->ndi++] = i ;
+            d [i] = -t ;
+            dnorm2 += t*t ;
+        }
+    }
+    *gnorm2 = s ;
+    return (dnorm2) ;
+}
+
 /* =========================================================================
    === cg_default ==========================================================
    =========================================================================
@@ -3812,10 +6703,27 @@ void cg_default
        F => only use L-BFGS when memory >= n */
     Parm->LBFGS = FALSE ;
 
+    /* T => compact representation in L-BFGS
+       F => two-loop recursion */
+    Parm->LBFGSCompact = FALSE ;
+
     /* number of vectors stored in memory (code breaks in the Yk update if
        memory = 1 or 2) */
     Parm->memory = 11 ;
 
+    /* T => adapt the memory between 3 and MemoryMax during the solve, it is
+            not increased while the memory linear algebra takes more than
+            AdaptCost times the time of the user's routines
+       F => the memory is fixed */
+    Parm->AdaptMemory = FALSE ;
+    Parm->MemoryMax = 40 ;
+    Parm->AdaptCost = ONE ;
+
+    /* T => the adapted memory is rated by the weighted evaluation cost in
+            place of the time, so the solve does not depend on the timing
+       F => rated by the time */
+    Parm->AdaptEvals = FALSE ;
+
     /* SubCheck and SubSkip control the frequency with which the subspace
        condition is checked. It it checked for SubCheck*mem iterations and
        if it is not activated, then it is skipped for Subskip*mem iterations
@@ -3930,6 +6838,83 @@ void cg_default
     /* after encountering nan, decay factor for stepsize */
     Parm->nan_decay = 0.1 ;
 
+    /* Hessian times vector routine, NULL => not available */
+    Parm->hessvec = NULL ;
+
+    /* sparse gradient routine, NULL => the sparse mode is not used */
+    Parm->sparsegrad = NULL ;
+
+    /* finite difference gradient when grad and valgrad are NULL: forward
+       differences with the default step, one thread, no element
+       structure */
+    Parm->FDCentral = FALSE ;
+    Parm->FDStep = ZERO ;
+    Parm->FDThreads = 1 ;
+    Parm->FDElements = NULL ;
+    Parm->FDnelt = 0 ;
+    Parm->FDptr = NULL ;
+    Parm->FDidx = NULL ;
+
+    /* T => truncated Newton mode, the inner CG stops when the relative
+       residual is below min (NewtonEta, sqrt (||g||)) or after
+       NewtonMaxit iterations */
+    Parm->Newton = FALSE ;
+    Parm->NewtonEta = 0.5 ;
+    Parm->NewtonMaxit = INT_INF ;
+
+    /* file where the line search flight recorder is written after a line
+       search failure, NULL => print it with the final statistics */
+    Parm->FlightFile = NULL ;
+
+    /* relative cost of a function value and a gradient */
+    Parm->ValueCost = ONE ;
+    Parm->GradCost = ONE ;
+
+    /* use the function value line search cg_lineF when
+       GradCost >= FuncLineFac*ValueCost */
+    Parm->FuncLineFac = 5. ;
+
+    /* T => predict the initial stepsize from the previous accepted steps,
+       the QuadStep probe is skipped when the standard deviation of the log
+       of the learned correction is <= PredictTol */
+    Parm->PredictStep = FALSE ;
+    Parm->PredictTol = .25 ;
+    Parm->PredictRate = .2 ;
+
+    /* routine called after each iteration, NULL => none */
+    Parm->monitor = NULL ;
+    Parm->MonitorData = NULL ;
+
+    /* rule used by cg_multistart to abandon a start */
+    Parm->AbandonIter = 10 ;
+    Parm->AbandonFac = 100. ;
+    Parm->AbandonTol = 1.e-3 ;
+    Parm->abandon = NULL ;
+
+    /* binary trace of the iterations and line search trials, NULL => none */
+    Parm->TraceFile = NULL ;
+
+    /* record and replay of the evaluations, NULL => none */
+    Parm->RecordFile = NULL ;
+    Parm->ReplayFile = NULL ;
+
+    /* preconditioner, NULL for both => none */
+    Parm->precond = NULL ;
+    Parm->PrecondData = NULL ;
+    Parm->PrecondDiag = NULL ;
+
+    /* T => learn a diagonal preconditioner when none is given */
+    Parm->AutoDiag = FALSE ;
+
+    /* T => time breakdown in Stats->time */
+    Parm->Timing = FALSE ;
+
+    /* T => hardware counters in Stats->cycles, instr, and misses */
+    Parm->Counters = FALSE ;
+
+    /* T => roofline summary of the vector kernels in Stats->roof */
+    Parm->Roofline = FALSE ;
+
     /* Wolfe line search parameter, range [0, .5]
        phi (a) - phi (0) <= delta phi'(0) */
     Parm->delta = .1 ;
@@ -4056,6 +7041,14 @@ PRIVATE void cg_printParms
              Parm->psi2) ;
     printf ("max iterations .................................. maxit: %i\n",
              (int) Parm->maxit) ;
+    printf ("truncated Newton forcing term ............... NewtonEta: %e\n",
+             Parm->NewtonEta) ;
+    printf ("max inner CG iterations of Newton ......... NewtonMaxit: %i\n",
+             (int) Parm->NewtonMaxit) ;
+    printf ("relative step of the finite differences ........ FDStep: %e\n",
+             Parm->FDStep) ;
+    printf ("threads for the finite differences .......... FDThreads: %i\n",
+             Parm->FDThreads) ;
     printf ("max number of contracts in the line search .... nshrink: %i\n",
              Parm->nshrink) ;
     printf ("max expansions in line search .................. ntries: %i\n",
@@ -4074,6 +7067,10 @@ PRIVATE void cg_printParms
              Parm->eta2) ;
     printf ("number of vectors stored in memory ............. memory: %i\n",
              Parm->memory) ;
+    printf ("largest adapted memory ...................... MemoryMax: %i\n",
+             Parm->MemoryMax) ;
+    printf ("memory algebra/user time to stop growth ..... AdaptCost: %e\n",
+             Parm->AdaptCost) ;
     printf ("check subspace condition mem*SubCheck its .... SubCheck: %i\n",
              Parm->SubCheck) ;
     printf ("skip subspace checking for mem*SubSkip its .... SubSkip: %i\n",
@@ -4082,6 +7079,22 @@ PRIVATE void cg_printParms
              Parm->neps) ;
     printf ("max number of iterations in line search ......... nline: %i\n",
              Parm->nline) ;
+    printf ("relative cost of a function value ........... ValueCost: %e\n",
+             Parm->ValueCost) ;
+    printf ("relative cost of a gradient .................. GradCost: %e\n",
+             Parm->GradCost) ;
+    printf ("value line search if cost ratio >= ........ FuncLineFac: %e\n",
+             Parm->FuncLineFac) ;
+    printf ("skip quadstep if step prediction std <= .... PredictTol: %e\n",
+             Parm->PredictTol) ;
+    printf ("smallest weight of new prediction data .... PredictRate: %e\n",
+             Parm->PredictRate) ;
+    printf ("multistart: abandon after iteration ....... AbandonIter: %i\n",
+             (int) Parm->AbandonIter) ;
+    printf ("multistart: factor of predicted decrease ... AbandonFac: %e\n",
+             Parm->AbandonFac) ;
+    printf ("multistart: tolerance in abandon rule ...... AbandonTol: %e\n",
+             Parm->AbandonTol) ;
     printf ("print level (0 = none, 3 = maximum) ........ PrintLevel: %i\n",
              Parm->PrintLevel) ;
     printf ("Logical parameters:\n") ;
@@ -4125,6 +7138,54 @@ PRIVATE void cg_printParms
         printf ("    Check for decay of cost, debugger is on\n") ;
     else
         printf ("    Do not check for decay of cost, debugger is off\n") ;
+    if ( Parm->LBFGSCompact )
+        printf ("    Compact representation in L-BFGS\n") ;
+    if ( Parm->AdaptMemory )
+        printf ("    Adapt the memory size during the solve\n") ;
+    if ( Parm->AdaptMemory && Parm->AdaptEvals )
+        printf ("    Rate the memory size by the evaluation cost\n") ;
+    if ( Parm->Newton )
+        printf ("    Truncated Newton with Hessian-vector products\n") ;
+    else if ( Parm->hessvec != NULL )
+        printf ("    Use Hessian-vector products for curvature\n") ;
+    if ( Parm->sparsegrad != NULL )
+        printf ("    Sparse gradients, sparse mode when memory = 0\n") ;
+    if ( Parm->FDCentral )
+        printf ("    Central finite differences (no grad, valgrad)\n") ;
+    else
+        printf ("    Forward finite differences (no grad, valgrad)\n") ;
+    if ( Parm->FDElements != NULL )
+        printf ("    Finite differences grouped by elements\n") ;
+    if ( Parm->FlightFile != NULL )
+        printf ("    Line search flight recorder file ........ %s\n",
+                Parm->FlightFile) ;
+    if ( Parm->GradCost >= Parm->FuncLineFac*Parm->ValueCost )
+        printf ("    Function value line search (costly gradient)\n") ;
+    if ( Parm->PredictStep )
+        printf ("    Predict initial step from previous steps\n") ;
+    if ( Parm->monitor != NULL )
+        printf ("    Call monitor routine after each iteration\n") ;
+    if ( Parm->Timing )
+        printf ("    Time the parts of cg_descent\n") ;
+    if ( Parm->Counters )
+        printf ("    Hardware counters in each part of cg_descent\n") ;
+    if ( Parm->Roofline )
+        printf ("    Roofline summary of the vector kernels\n") ;
+    if ( Parm->TraceFile != NULL )
+        printf ("    Binary trace file ....................... %s\n",
+                Parm->TraceFile) ;
+    if ( Parm->RecordFile != NULL )
+        printf ("    Record evaluations to ................... %s\n",
+                Parm->RecordFile) ;
+    if ( Parm->ReplayFile != NULL )
+        printf ("    Replay evaluations from ................. %s\n",
+                Parm->ReplayFile) ;
+    if ( Parm->precond != NULL )
+        printf ("    Preconditioner given by routine precond\n") ;
+    else if ( Parm->PrecondDiag != NULL )
+        printf ("    Diagonal preconditioner PrecondDiag\n") ;
+    else if ( Parm->AutoDiag )
+        printf ("    Automatic diagonal scaling\n") ;
 }
 
 /*
@@ -4273,4 +7334,165 @@ Version 6.8 Change:
   When the denominator of the variable "scale" vanishes, retain the
   previous value of scale. This correct an error pointed out by
   Zachary Blunden-Codd.
+
+Version 6.9 Changes:
+  1. Add the optional Hessian-vector product routine hessvec to the
+     parameter structure. When it is provided, the curvature d'Hd gives the
+     initial stepsize in the line search, the test for a quadratic cost,
+     and the scaling in the L-BFGS and subspace iterations. The number of
+     Hessian-vector products is returned in the statistics structure
+     (see driver6.c).
+  2. The line search trials (stepsize, function value, derivative,
+     bracketing interval, phase, and eps) are always recorded in a ring
+     buffer holding the last CG_NTRIAL trials. When cg_descent returns
+     with a line search failure (status 3 through 8), the buffer is written
+     as a JSON line to Parm->FlightFile, or printed with the statistics.
+  3. Add the parameters ValueCost and GradCost giving the relative cost of
+     the function and the gradient. The weighted cost is returned in
+     Stat->cost. When GradCost >= FuncLineFac*ValueCost, the new line
+     search cg_lineF uses function values only (Armijo backtracking with a
+     quadratic fit) and evaluates the gradient once at the accepted step,
+     falling back to cg_line when the Wolfe conditions fail.
+  4. Add the parameter PredictStep. The initial stepsize is predicted from
+     the accepted steps of the solve, and the QuadStep probe is skipped
+     once the prediction is reliable. Stat->nfirst gives the number of
+     iterations where the first line search trial was accepted.
+  5. Add the optional monitor routine called after each iteration; a
+     nonzero return stops cg_descent with status 13. The external
+     variables one, zero, and blas_one are now initialized statically so
+     that cg_descent can run in several threads at once. Add the routine
+     cg_multistart (cg_parallel.c) which runs cg_descent from several
+     starting guesses in parallel (OpenMP), shares the best function value
+     found, and abandons the starts that cannot improve on it
+     (parameters AbandonIter, AbandonFac, AbandonTol, abandon).
+  6. Add the routine cg_portfolio (cg_parallel.c) which runs several
+     parameter configurations (by default memory = 0, memory = 11, and
+     L-BFGS) at the same time. The first one that converges wins, the
+     others are cancelled, and the winner can be logged to a file.
+  7. Add the parameter TraceFile. Each iteration and each line search
+     trial is stored as a fixed size binary record (cg_trace) in a ring
+     buffer which a background thread writes to the file (when compiled
+     with CG_TRACE_THREAD). The routine cg_trace_json, and the program
+     trace2json, convert the trace to JSON lines.
+  8. Add the parameter Timing. The time spent in value, grad, valgrad,
+     hessvec, the vector kernels, the line search logic, and the subspace
+     and L-BFGS linear algebra is measured with a monotonic clock and
+     returned in Stats->time (cg_timing). When Timing is F, the clock is
+     never read.
+  9. Add the parameter Counters. On Linux, the CPU cycles, instructions,
+     and last level cache misses in each part of cg_descent (the same
+     parts as for Timing) are read with perf_event_open and returned in
+     Stats->cycles, instr, and misses; the final statistics also give the
+     memory bandwidth estimated from the cache misses. Counters that
+     cannot be opened are reported as -1. Compile with -DCG_NO_PERF on
+     systems without the Linux perf headers.
+ 10. Add the test problem library cg_test.c (extended Rosenbrock, extended
+     Powell singular, trigonometric, Broyden tridiagonal, penalty I,
+     variably dimensioned, discrete boundary value, a nonlinear elliptic
+     PDE, TRIDIA, and the example of driver1.c), each with scalable n and
+     a fused valgrad. The harness cg_bench.c runs memory = 0, limited
+     memory CG, and L-BFGS on the library and prints Dolan-More
+     performance profiles for time, nfunc, and ngrad.
+ 11. Add the kernel microbenchmark cg_kernels.c, which times cg_dot,
+     cg_daxpy, cg_step, the cg_update routines, cg_Yk, cg_matvec, and
+     cg_trisolve over n and mem and prints GB/s and GFLOP/s as CSV.
+     The BLAS can now also be turned on with -DCG_USE_BLAS.
+ 12. Add CTest checks. cg_check.c solves the problem of the drivers with
+     their parameter settings and the problems of cg_test.c, compares
+     iter, nfunc, and ngrad with cg_check.base, and with the test
+     cg_check_time compares the solve time with the time recorded by its
+     first run in the build tree (tolerance CG_CHECK_TOL).
+ 13. Add the parameter Roofline. The vector kernels count the bytes they
+     read and write and their flops in a per thread counter, which is
+     charged at the end of each iteration to its type (cg, limited memory
+     full space or subspace, L-BFGS). The final statistics give the work
+     per iteration, the arithmetic intensity, and the achieved rate as a
+     fraction of the bandwidth of cg_daxpy on vectors of length n
+     (Stats->roof).
+ 14. Count the function and gradient evaluations by origin: the start,
+     expansion, secant, cubic, and bisection steps of cg_line, cg_contract,
+     the first trial after eps is increased, the Armijo trials of cg_lineF,
+     the starting point, the quadratic step, and the retries after a nan.
+     The counts are returned in Stats->nfunc_origin and ngrad_origin and
+     printed with the final statistics when PrintLevel >= 1.
+ 15. Add the parameters RecordFile and ReplayFile. RecordFile logs each
+     call of value, grad, and valgrad (a digest of x, f, and g). With
+     ReplayFile, the recorded values are used as long as the evaluation
+     points match the recording; at the first difference the divergence
+     is reported (Stats->replay_diverge) and the user's routines are
+     called from then on. Stats->nreplay counts the replayed calls.
+ 16. cg_eval checked Com->df for nan after the evaluation at alpha = 0,
+     where df is not computed. Com->df is uninitialized at the start, so
+     cg_descent could return status 11 at the starting point.
+ 17. Add the parameters precond, PrecondData, and PrecondDiag. The CG
+     directions become d = -Pg + beta*dold with the preconditioned beta,
+     and L-BFGS uses scale*P as its initial matrix. Limited memory CG with
+     a preconditioner does only full space iterations. The benchmark
+     cg_prec.c compares the iterations with and without P on
+     ill-conditioned problems.
+ 18. Add the parameter AutoDiag, a diagonal preconditioner learned from
+     the steps and gradient changes (the diagonal of the BFGS update of a
+     diagonal Hessian estimate, see cg_autodiag). It is used in place of
+     the identity in the CG direction and scales the L-BFGS initial
+     matrix. cg_prec.c also runs AutoDiag. The scaling is dropped (P = I)
+     when the gradient changes show that the Hessian is far from diagonal,
+     which doubled the CG iterations on the pde1d problem of cg_prec.c.
+ 19. Add the truncated Newton mode, parameters Newton, NewtonEta, and
+     NewtonMaxit. With hessvec, the direction is an inexact solution of
+     H d = -g by linear CG (cg_newton), and cg_line starts from alpha = 1.
+     The inner iterations are returned in Stats->IterInner and counted as
+     iteration type "Newton" in the roofline summary. Without hessvec the
+     status is 14. driver9.c compares the mode with CG_DESCENT on a PDE.
+     The exit with status 12 (and now 14) freed the uninitialized work
+     pointer; work is now NULL until it is allocated.
+ 20. Add the parameter LBFGSCompact: the L-BFGS direction from the compact
+     representation of Byrd, Nocedal, and Schnabel (cg_bns). S'g and Y'g
+     take one pass over the memory and the direction a second one, both
+     in blocks of CG_BLOCK elements; the new columns of S'Y and Y'Y come
+     from the differences of S'g and Y'g between iterations. It is not
+     used with a preconditioner. cg_kernels.c times the two-loop
+     recursion and the compact form (lbfgs_twoloop, lbfgs_compact).
+ 21. Add the parameters AdaptMemory, MemoryMax, and AdaptCost. With
+     AdaptMemory, cg_adapt changes the memory between 3 and MemoryMax
+     after each window of iterations by comparing the decrease of log |g|
+     per second with the previous window, and does not grow it while the
+     memory linear algebra costs more than AdaptCost times the user's
+     routines. L-BFGS stores the pairs modulo the largest memory and uses
+     the newest mem pairs; limited memory CG restarts its memory in the
+     full space and lays it out for the new size. The memory at the end
+     is returned in Stats->memory. With AdaptEvals, the rate is per
+     weighted evaluation in place of per second, so the iterations do not
+     depend on the timing.
+ 22. Add cg_psep.c, partially separable objectives f = sum_e f_e (x_e).
+     The elements are registered with cg_psep_add and evaluated in
+     parallel (OpenMP) by color, so their gradients are added into g
+     without atomics; an element is only evaluated again when one of its
+     variables changed. cg_psep_descent calls cg_descent with the
+     assembled value and gradient. driver10.c compares it with a hand
+     written valgrad on a grid problem.
+ 23. Add the parameter sparsegrad, a gradient routine that returns the
+     nonzeros of g and their indices. With memory = 0 (no preconditioner,
+     no hessvec, not Newton), cg_descent then keeps index lists of the
+     supports of g, gtemp, and d, and the trial steps, the line search dot
+     products, and the direction updates only run over them (cg_sparse_step,
+     cg_sparse_dot, cg_sparse_copy, cg_sparse_restart, cg_sparse_ykyk,
+     cg_sparse_d). The replay file is not used in the sparse mode.
+     driver11.c compares it with the dense gradient on a chain of 1e6
+     variables.
+ 24. When grad and valgrad are both NULL, the gradient is approximated
+     by finite differences of value (cg_fdgrad), forward or central
+     (FDCentral) with the relative step FDStep. The perturbed points are
+     evaluated by FDThreads OpenMP threads. With the element values
+     FDElements and their pattern (FDnelt, FDptr, FDidx), the variables
+     are colored (cg_fdsetup) and the variables of a color, which share
+     no element, are perturbed together. Stats->nfdeval and nfdgroup
+     return the evaluations and groups. driver12.c compares the choices
+     on the chained Rosenbrock function.
+ 25. Add cg_ad.hpp, a C++ front end with reverse mode automatic
+     differentiation. The objective is written once as a template over
+     the scalar type; cg_ad_descent passes its double instance as value
+     and its cg_adouble instance, which records a tape, as a fused
+     valgrad whose gradient is one reverse sweep. The tape is cleared but
+     not freed between evaluations, so it stops allocating once it has
+     grown. driver13.cpp compares it with hand written valgrad routines.
 */
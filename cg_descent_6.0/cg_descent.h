@@ -5,6 +5,19 @@
 #include <ctype.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
+#if defined (__linux__) && !defined (CG_NO_PERF)
+#define CG_PERF
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef CG_TRACE_THREAD
+#include <pthread.h>
+#endif
 
 #define PRIVATE static
 #define ZERO ((double) 0)
@@ -12,15 +25,146 @@
 #define MAX(a,b) (((a) > (b)) ? (a) : (b))
 #define MIN(a,b) (((a) < (b)) ? (a) : (b))
 
+/* the flight recorder keeps the last CG_NTRIAL line search trials */
+#define CG_NTRIAL 64
+
+/* line search phases stored in the flight recorder */
+#define CG_START    0 /* starting guess of the line search */
+#define CG_EXPAND   1 /* expansion phase, searching for a bracket */
+#define CG_SECANT   2 /* secant step inside the bracket */
+#define CG_CUBIC    3 /* cubic step inside the bracket */
+#define CG_BISECT   4 /* bisection step inside the bracket */
+#define CG_CONTRACT 5 /* step in cg_contract */
+#define CG_EPS      6 /* eps is increased after cg_contract fails */
+#define CG_ARMIJO   7 /* function only trial in cg_lineF */
+
+/* other origins of an evaluation, Stats->nfunc_origin and ngrad_origin */
+#define CG_INIT     8 /* starting point */
+#define CG_QUAD     9 /* trial point of the quadratic step (QuadStep) */
+#define CG_NAN     10 /* retry with a smaller step after a nan or inf */
+
+typedef struct cg_trial_struct /* line search trial */
+{
+    INT           iter ; /* cg iteration */
+    int          phase ; /* CG_START, CG_EXPAND, ..., CG_ARMIJO */
+    int           what ; /* 1 = function evaluated, 2 = derivative evaluated,
+                            3 = both evaluated */
+    int         AWolfe ; /* T (approximate Wolfe line search) */
+    double       alpha ; /* trial stepsize */
+    double           f ; /* function value at alpha */
+    double          df ; /* derivative at alpha */
+    double           a ; /* left side of bracketing interval */
+    double           b ; /* right side of bracketing interval */
+    double         eps ; /* current value of eps */
+} cg_trial ;
+
+/* parts of cg_descent timed when Parm->Timing is T, see cg_timing */
+#define CG_TKERNEL  0 /* vector kernels and remaining work (default) */
+#define CG_TVALUE   1 /* user's value routine */
+#define CG_TGRAD    2 /* user's grad routine */
+#define CG_TVALGRAD 3 /* user's valgrad routine */
+#define CG_THESSVEC 4 /* user's hessvec routine */
+#define CG_TLINE    5 /* line search logic */
+#define CG_TSUB     6 /* subspace and L-BFGS linear algebra */
+#define CG_TNPHASE  7
+
+/* hardware counters read when Parm->Counters is T */
+#define CG_CYCLES   0
+#define CG_INSTR    1
+#define CG_MISSES   2
+#define CG_NCOUNT   3
+
+/* bytes and flops of the vector kernels, counted while on is T (Parm->
+   Roofline). Each thread has its own copy so that several cg_descent can
+   still run at the same time in different threads */
+#if defined (__GNUC__)
+#define CG_TLS __thread
+#elif defined (_MSC_VER)
+#define CG_TLS __declspec (thread)
+#else
+#define CG_TLS
+#endif
+typedef struct cg_kwork_struct /* work of the vector kernels */
+{
+    int         on ; /* T (count the work) */
+    double   bytes ; /* bytes read and written */
+    double   flops ; /* floating point operations */
+} cg_kwork ;
+/* a kernel reading or writing w doubles and doing f flops */
+#define CG_KWORK(w,f) if ( cg_work.on ) { cg_work.bytes += 8.*(double) (w) ;\
+                                          cg_work.flops += (double) (f) ; }
+
+/* an update of the automatic diagonal scaling (Parm->AutoDiag) changes
+   each element by at most the factor CG_DIAGFAC */
+#define CG_DIAGFAC 100.
+
+/* the automatic scaling is replaced by P = I when the running average of
+   sum |s_i y_i| / s'y exceeds CG_DIAGNU (see cg_autodiag) */
+#define CG_DIAGNU 2.
+
+/* the compact L-BFGS passes (Parm->LBFGSCompact) go over the history in
+   blocks of CG_BLOCK elements, so that the blocks of g and d stay in the
+   cache while the pairs are streamed */
+#define CG_BLOCK 1024
+
+/* each run of the bandwidth measurement updates CG_BWLEN vector elements */
+#define CG_BWLEN 1048576
+
+/* the trace ring buffer holds CG_NTRACE records */
+#define CG_NTRACE 4096
+
+/* the trace ring has one producer (the solver) and one consumer (the writer
+   thread), so the counters only need atomic loads and stores */
+#ifdef CG_TRACE_THREAD
+#define CG_LOAD(p)    __atomic_load_n (p, __ATOMIC_ACQUIRE)
+#define CG_STORE(p,v) __atomic_store_n (p, v, __ATOMIC_RELEASE)
+#else
+#define CG_LOAD(p)    (*(p))
+#define CG_STORE(p,v) (*(p) = (v))
+#endif
+
+/* the record and replay files (Parm->RecordFile and ReplayFile) start with
+   the 8 characters CGEVALS1, an int giving sizeof (cg_erecord), and n,
+   followed by one cg_erecord for each call of value, grad, or valgrad,
+   each followed by the n gradient entries when the gradient was computed */
+typedef struct cg_erecord_struct /* record of one evaluation */
+{
+    int                    what ; /* 1 = value, 2 = grad, 3 = valgrad */
+    unsigned long long   digest ; /* FNV-1a hash of the bytes of x */
+    double                    f ; /* function value, zero for grad */
+} cg_erecord ;
+
+typedef struct cg_tracer_struct /* trace writer */
+{
+    FILE         *file ; /* trace file */
+    cg_trace     *Ring ; /* ring buffer with CG_NTRACE records */
+    INT           head ; /* number of records pushed by the solver */
+    INT           tail ; /* number of records written to the file */
+    int           done ; /* T => solver finished, drain the ring and stop */
+    int       threaded ; /* T => records written by the writer thread,
+                            F => written by the solver when the ring is full*/
+#ifdef CG_TRACE_THREAD
+    pthread_t   thread ; /* writer thread */
+    pthread_mutex_t lock ; /* only used to wake the writer or the solver */
+    pthread_cond_t  wake ; /* wakes the writer: ring half full or done */
+    pthread_cond_t  room ; /* wakes the solver: the writer freed records */
+#endif
+} cg_tracer ;
+
 typedef struct cg_com_struct /* common variables */
 {
     /* parameters computed by the code */
     INT              n ; /* problem dimension, saved for reference */
     INT             nf ; /* number of function evaluations */
     INT             ng ; /* number of gradient evaluations */
+    INT             nh ; /* number of Hessian-vector products */
+    INT         nfirst ; /* number of times first line search trial accepted*/
     int         QuadOK ; /* T (quadratic step successful) */
     int       UseCubic ; /* T (use cubic step) F (use secant step) */
     int           neps ; /* number of time eps updated */
+    int      neps_eval ; /* neps at the previous evaluation */
+    INT Nf [CG_NORIGIN] ; /* function evaluations by origin */
+    INT Ng [CG_NORIGIN] ; /* gradient evaluations by origin */
     int       PertRule ; /* T => estimated error in function value is eps*Ck,
                             F => estimated error in function value is eps */
     int          QuadF ; /* T => function appears to be quadratic */
@@ -43,8 +187,73 @@ typedef struct cg_com_struct /* common variables */
                                 do not change user's AWolfe, this value can be
                                 changed based on AWolfeFac */
     int          Wolfe ; /* T (means code reached the Wolfe part of cg_line */
+    int       FuncLine ; /* T (gradient expensive, use cg_lineF) */
     double         rho ; /* either Parm->rho or Parm->nan_rho */
     double    alphaold ; /* previous value for stepsize alpha */
+    INT           iter ; /* current cg iteration */
+    INT         ntrial ; /* total number of line search trials recorded */
+    cg_trial Trial [CG_NTRIAL] ; /* ring buffer with the most recent trials */
+    cg_tracer  *Tracer ; /* trace writer, NULL => no trace */
+    int         Timing ; /* T (measure the time of each part) */
+    int         tphase ; /* part being timed, CG_TKERNEL, ..., CG_TSUB */
+    double       tlast ; /* time when tphase started */
+    double      tstart ; /* time when cg_descent started */
+    double Time [CG_TNPHASE] ; /* time spent in each part */
+    int       Counters ; /* T (some hardware counter is open) */
+    int  pfd [CG_NCOUNT] ; /* file descriptors of the counters, -1 = closed */
+    long long pval [CG_NCOUNT] ; /* counter values when tphase started */
+    double Count [CG_NCOUNT][CG_TNPHASE] ; /* counts in each part */
+    int       Roofline ; /* T (count the kernel work by iteration type) */
+    double   roof_time ; /* time outside the user routines at the end of
+                            the previous iteration */
+    cg_roofline   Roof ; /* kernel work by iteration type */
+    int        Precond ; /* T (search directions use P*g) */
+    double         *Pg ; /* P*g when Precond is T */
+    double       *Diag ; /* diagonal P, PrecondDiag or the automatic scaling */
+    int       AutoDiag ; /* T (Diag is learned from the steps) */
+    INT          ndiag ; /* number of updates of the automatic scaling */
+    double     diag_nu ; /* running average of sum |s_i y_i| / s'y */
+    int       diag_off ; /* T (the scaling was replaced by P = I) */
+    int       AdaptMem ; /* T (the memory is adapted, Parm->AdaptMemory) */
+    int           memA ; /* memory chosen by cg_adapt */
+    int        memAmax ; /* largest memory, the work array is sized for it */
+    int      adapt_dir ; /* +1 (grow) or -1 (shrink) at the next change */
+    INT    adapt_start ; /* iteration at the start of the window */
+    double     adapt_g ; /* log |g| at the start of the window */
+    double  adapt_rate ; /* decrease of log |g| per second in the previous
+                            window, -INF until measured */
+    double  adapt_time ; /* total time at the start of the window */
+    double  adapt_user ; /* time in value, grad, valgrad at the start */
+    double   adapt_sub ; /* time in the memory linear algebra at the start */
+    int         Sparse ; /* T (sparse mode, Parm->sparsegrad with memory 0) */
+    INT            *gi ; /* sparse mode: indices of the nonzeros of g */
+    INT           *gti ; /* indices of the nonzeros of gtemp */
+    INT            *di ; /* indices of the support of d */
+    INT            ngi ; /* number of indices in gi */
+    INT           ngti ; /* number of indices in gti */
+    INT            ndi ; /* number of indices in di */
+    char        *dmark ; /* dmark [i] = 1 if i is in di */
+    char        *gmark ; /* marks the indices of gti in cg_sparse_ykyk */
+    int             FD ; /* T (finite difference gradient, see cg_fdgrad) */
+    INT            nfd ; /* calls of value or FDElements by cg_fdgrad */
+    int     fd_nthread ; /* threads that evaluate the perturbed points */
+    INT      fd_ncolor ; /* number of groups of variables */
+    INT     *fd_colptr ; /* group c: fd_order [fd_colptr [c] ... [c+1]-1],
+                            NULL => group c is variable c */
+    INT      *fd_order ; /* variables sorted by group */
+    INT       *fd_vptr ; /* elements of variable j: fd_velt [fd_vptr [j]],
+                            ..., fd_velt [fd_vptr [j+1]-1] */
+    INT       *fd_velt ;
+    double       *fd_h ; /* steps of the variables */
+    double      *fd_F0 ; /* element values at x */
+    double    *fd_work ; /* per thread: x with a perturbed group, and the
+                            element values at x + h and x - h */
+    FILE       *record ; /* RecordFile, NULL => evaluations not recorded */
+    FILE       *replay ; /* ReplayFile, NULL => no replay or replay ended */
+    INT          ncall ; /* number of calls of value, grad, and valgrad */
+    INT        nreplay ; /* calls answered from the replay file */
+    INT        diverge ; /* call where the replay diverged, 0 = none,
+                            -1 = no replay */
     double          *x ; /* current iterate */
     double      *xtemp ; /* x + alpha*d */
     double          *d ; /* current search direction */
@@ -53,6 +262,8 @@ typedef struct cg_com_struct /* common variables */
     double   (*cg_value) (double *, INT) ; /* f = cg_value (x, n) */
     void      (*cg_grad) (double *, double *, INT) ; /* cg_grad (g, x, n) */
     double (*cg_valgrad) (double *, double *, INT) ; /* f = cg_valgrad (g,x,n)*/
+    void  (*cg_hessvec) (double *, double *, double *, INT) ; /* Hd = H(x)*d */
+    INT (*cg_sparsegrad) (double *, INT *, double *, INT) ; /* sparse g */
     cg_parameter *Parm ; /* user parameters */
 } cg_com ;
 
@@ -88,13 +299,289 @@ PRIVATE int cg_contract
     cg_com  *Com  /* cg com structure */
 ) ;
 
+PRIVATE int cg_lineF
+(
+    cg_com   *Com  /* cg com structure */
+) ;
+
 PRIVATE int cg_evaluate
 (
     char    *what, /* fg = evaluate func and grad, g = grad only,f = func only*/
     char     *nan, /* y means check function/derivative values for nan */
+    int    origin, /* CG_START, ..., CG_QUAD, where the evaluation is made */
+    cg_com   *Com
+) ;
+
+PRIVATE int cg_eval
+(
+    char    *what, /* fg = evaluate func and grad, g = grad only,f = func only*/
+    char     *nan, /* y means check function/derivative values for nan */
+    cg_com   *Com
+) ;
+
+PRIVATE double cg_fvalue
+(
+    double     *x, /* evaluation point */
+    cg_com   *Com
+) ;
+
+PRIVATE void cg_fgrad
+(
+    double     *g, /* gradient at x */
+    double     *x, /* evaluation point */
+    cg_com   *Com
+) ;
+
+PRIVATE double cg_fvalgrad
+(
+    double     *g, /* gradient at x */
+    double     *x, /* evaluation point */
+    cg_com   *Com
+) ;
+
+PRIVATE int cg_fdsetup
+(
+    cg_com   *Com
+) ;
+
+PRIVATE double cg_fdgrad
+(
+    double     *g, /* gradient at x */
+    double     *x, /* evaluation point */
+    int     needf, /* T (return f (x)) */
+    cg_com   *Com
+) ;
+
+PRIVATE int cg_clock
+(
+    int     phase, /* part of cg_descent that starts, CG_TKERNEL, ... */
+    cg_com   *Com
+) ;
+
+PRIVATE double cg_wtime (void) ;
+
+PRIVATE void cg_roof
+(
+    int      type,
+    cg_com   *Com
+) ;
+
+PRIVATE double cg_bandwidth
+(
+    INT      n
+) ;
+
+PRIVATE void cg_perf_open
+(
+    cg_com   *Com
+) ;
+
+PRIVATE void cg_perf_charge
+(
+    int     phase, /* part that is charged, CG_TKERNEL, ... */
+    cg_com   *Com
+) ;
+
+PRIVATE void cg_perf_close
+(
+    cg_com   *Com
+) ;
+
+PRIVATE void cg_perf_stats
+(
+    cg_timing   *T, /* counts in each part */
+    double      *C, /* Com->Count [k] */
+    int        fd   /* -1 => counter not opened */
+) ;
+
+PRIVATE void cg_record
+(
+    int     phase, /* CG_START, CG_EXPAND, ..., CG_ARMIJO */
+    int      what, /* 1 = f, 2 = df, 3 = f and df evaluated */
+    double      a, /* left side of bracketing interval */
+    double      b, /* right side of bracketing interval */
+    cg_com   *Com
+) ;
+
+PRIVATE void cg_flight
+(
+    FILE    *file, /* output file */
+    int    status, /* return status of cg_descent */
+    cg_com   *Com
+) ;
+
+PRIVATE void cg_jnum
+(
+    FILE *file, /* output file */
+    double   x  /* number to print, nan or inf => null */
+) ;
+
+PRIVATE cg_tracer *cg_trace_open
+(
+    char *TraceFile  /* name of the trace file */
+) ;
+
+PRIVATE void cg_trace_push
+(
+    cg_trace   *R, /* record to queue */
+    cg_tracer  *T  /* trace writer */
+) ;
+
+PRIVATE void cg_trace_iter
+(
+    double    alpha, /* accepted stepsize */
+    double        f, /* function value */
+    double    gnorm, /* gradient sup-norm */
+    double    dphi0, /* derivative along new search direction */
+    int    Subspace, /* T (iteration in the subspace) */
+    int        memk, /* number of vectors in memory */
+    cg_com     *Com
+) ;
+
+PRIVATE void cg_trace_flush
+(
+    cg_tracer  *T, /* trace writer */
+    INT      head  /* write the records before head */
+) ;
+
+#ifdef CG_TRACE_THREAD
+PRIVATE void *cg_trace_writer
+(
+    void *Data  /* trace writer */
+) ;
+#endif
+
+PRIVATE void cg_trace_close
+(
+    cg_tracer  *T  /* trace writer */
+) ;
+
+PRIVATE FILE *cg_replay_open
+(
+    char    *File, /* name of the record or replay file */
+    int     write, /* T => RecordFile, F => ReplayFile */
+    cg_com   *Com
+) ;
+
+PRIVATE int cg_replay_read
+(
+    int      what, /* 1 = value, 2 = grad, 3 = valgrad */
+    double     *f, /* recorded function value */
+    double     *g, /* recorded gradient */
+    double     *x, /* evaluation point */
+    cg_com   *Com
+) ;
+
+PRIVATE void cg_replay_write
+(
+    int      what, /* 1 = value, 2 = grad, 3 = valgrad */
+    double      f, /* function value */
+    double     *g, /* gradient */
+    double     *x, /* evaluation point */
+    cg_com   *Com
+) ;
+
+PRIVATE void cg_replay_stop
+(
+    char  *reason, /* why the replay diverged */
     cg_com   *Com
 ) ;
 
+PRIVATE unsigned long long cg_digest
+(
+    double     *x, /* vector */
+    INT         n  /* length of x */
+) ;
+
+PRIVATE double cg_autodiag
+(
+    double     *d, /* search direction, s = alpha*d */
+    double     *g, /* old gradient */
+    double *gtemp, /* new gradient, y = gtemp - g */
+    double  alpha, /* step size */
+    double     sy, /* s'y */
+    cg_com   *Com
+) ;
+
+PRIVATE double cg_precond
+(
+    double    *Pg, /* P*g */
+    double     *g, /* vector to precondition */
+    cg_com   *Com
+) ;
+
+PRIVATE INT cg_newton
+(
+    double     *d, /* output: search direction */
+    double     *g, /* gradient at x */
+    double gnorm2, /* ||g||^2 */
+    double     *w, /* work array of length 3n */
+    cg_com   *Com
+) ;
+
+PRIVATE double cg_hess
+(
+    double   *HdHd, /* ||Hd||^2 */
+    double     *dd, /* ||d||^2 */
+    cg_com    *Com
+) ;
+
+PRIVATE void cg_adapt
+(
+    double   gnorm, /* |g| at the current iterate */
+    cg_com    *Com
+) ;
+
+PRIVATE double cg_bns
+(
+    double        *d, /* output: search direction -Hg */
+    double        *g, /* gradient */
+    double    gnorm2, /* ||g||^2 */
+    double   *dnorm2, /* output: ||d||^2 */
+    double    *scale, /* initial matrix scale*I, updated unless hscale
+                         is given or y'y = 0 */
+    double    hscale, /* > 0 => use this scale */
+    double       *Sk, /* s vectors, mem by n, circular */
+    double       *Yk, /* y vectors */
+    double      *Bns, /* 2*mem*mem + 6*mem work, kept between calls */
+    int        mlast, /* newest pair */
+    int         memk, /* number of pairs */
+    int          mem, /* size of the memory */
+    int        shift, /* number of oldest pairs dropped since the previous
+                         call, 1 when the oldest pair was replaced */
+    INT            n
+) ;
+
+PRIVATE void cg_bns_dots
+(
+    double       *Sg, /* output: s_k'g for the pairs from oldest to newest */
+    double       *Yg, /* output: y_k'g */
+    double       *sy, /* output: s'y of the newest pair */
+    double       *yy, /* output: y'y of the newest pair */
+    double        *g, /* gradient */
+    double       *Sk, /* s vectors, mem by n, circular */
+    double       *Yk, /* y vectors */
+    int        mlast, /* newest pair */
+    int         memk, /* number of pairs */
+    int          mem, /* size of the memory */
+    INT            n
+) ;
+
+PRIVATE double cg_bns_dir
+(
+    double        *d, /* output: d = -(gamma*g + S*p - gamma*Y*u) */
+    double        *g, /* gradient */
+    double     gamma, /* scale of the initial matrix */
+    double        *p, /* coefficients of the s vectors, oldest first */
+    double        *u, /* coefficients of the y vectors, oldest first */
+    double       *Sk, /* s vectors, mem by n, circular */
+    double       *Yk, /* y vectors */
+    int        mlast, /* newest pair */
+    int         memk, /* number of pairs */
+    int          mem, /* size of the memory */
+    INT            n
+) ;
+
 PRIVATE double cg_cubic
 (
     double  a,
@@ -258,6 +745,43 @@ PRIVATE void cg_Yk
     INT        n  /* length of the vectors */
 ) ;
 
+PRIVATE void cg_sparse_step
+(
+    double   alpha, /* stepsize */
+    cg_com    *Com
+) ;
+
+PRIVATE double cg_sparse_dot
+(
+    cg_com    *Com
+) ;
+
+PRIVATE void cg_sparse_copy
+(
+    cg_com    *Com
+) ;
+
+PRIVATE double cg_sparse_restart
+(
+    double *gnorm2, /* 2-norm of g */
+    int       copy, /* T (first set g = gtemp) */
+    cg_com    *Com
+) ;
+
+PRIVATE double cg_sparse_ykyk
+(
+    double   *Ykyk,
+    double   *Ykgk,
+    cg_com    *Com
+) ;
+
+PRIVATE double cg_sparse_d
+(
+    double    beta,
+    double *gnorm2, /* 2-norm of g */
+    cg_com    *Com
+) ;
+
 PRIVATE void cg_printParms
 (
     cg_parameter  *Parm
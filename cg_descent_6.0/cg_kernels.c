@@ -0,0 +1,243 @@
+/* Microbenchmark of the vector kernels of cg_descent. The kernels are
+   PRIVATE, so cg_descent.c is included in this file. Each kernel is called
+   once to warm up, then the number of calls is doubled until a batch
+   takes at least mintime seconds, and the best of three batches gives the
+   time per call. The vector length n goes from 10 to nmax by factors of
+   about sqrt (10). cg_matvec (y = A*x and y = A'*x with A of size n by mem)
+   and cg_trisolve (mem by mem) also go over mem = 3, 5, 11, 25, 50, 100
+   up to memmax, skipping matrices with more than 2.5e7 elements. So do
+   the L-BFGS direction with mem pairs by the two-loop recursion
+   (lbfgs_twoloop, the cg_dot and cg_daxpy passes of cg_descent) and by
+   the compact representation (lbfgs_compact, cg_bns_dots and cg_bns_dir,
+   Parm.LBFGSCompact); their bytes are the same minimal traffic, reading
+   the pairs and g once and writing d once, so GB/s compares the times.
+
+   cg_kernels [-n nmax] [-m memmax] [-c cpu] [-t mintime]
+
+   defaults: nmax = 1e7, memmax = 100, mintime = .02, no pinning. -c pins
+   the process to the given cpu (Linux). nmax = 1e8 needs about 3.2 GB.
+   The output has one CSV line per kernel and size:
+
+   kernel,blas,n,mem,calls,seconds,GB/s,GFLOP/s
+
+   where seconds is the time per call, blas is 1 when compiled with
+   -DCG_USE_BLAS (target CG_KERNELS_BLAS), and the bytes are the minimal
+   memory traffic of the kernel (each vector read or written once). */
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#endif
+#include "cg_descent.c"
+
+#define NKMEM 6
+
+volatile double cg_sink ; /* keeps the results of the reductions alive */
+
+/* =========================================================================
+   ==== cg_kernel ==========================================================
+   =========================================================================
+   Call kernel k, calls times
+   ========================================================================= */
+PRIVATE void cg_kernel
+(
+    int          k, /* kernel number, see Name in main */
+    INT      calls, /* number of calls */
+    double     **v, /* four vectors of length n */
+    double      *A, /* n by mem matrix, n by 2*mem for the L-BFGS kernels */
+    double      *R, /* mem by mem upper triangular matrix */
+    double      *z, /* vector of length mem */
+    INT          n,
+    int        mem
+)
+{
+    INT c ;
+    int j ;
+    double s, t, u, *Y ;
+    s = ZERO ;
+    Y = A + n*mem ;
+    for (c = 0; c < calls; c++)
+    {
+        switch ( k )
+        {
+            case 0: s += cg_dot (v [0], v [1], n) ; break ;
+            case 1: cg_daxpy (v [0], v [1], 1.e-9, n) ; break ;
+            case 2: cg_step (v [2], v [0], v [1], .5, n) ; break ;
+            case 3: s += cg_update_2 (v [0], v [1], v [2], n) ; break ;
+            case 4: s += cg_update_inf (v [0], v [1], v [2], n) ; break ;
+            case 5: s += cg_update_inf2 (v [0], v [1], v [2], &t, n) ; break ;
+            case 6: s += cg_update_ykyk (v [0], v [1], &t, &u, n) ; break ;
+            case 7: s += cg_update_d (v [2], v [1], .5, &t, n) ; break ;
+            case 8: cg_Yk (v [3], v [0], v [1], &t, n) ; s += t ; break ;
+            case 9: cg_matvec (v [0], A, z, mem, n, TRUE) ; break ;
+            case 10: cg_matvec (z, A, v [0], mem, n, FALSE) ; s += z [0];break;
+            case 11: cg_trisolve (z, R, mem, mem, TRUE) ; s += z [0] ; break ;
+            case 12: cg_trisolve (z, R, mem, mem, FALSE) ; s += z [0] ; break ;
+            case 13: /* two-loop recursion, s'y = 1 and scale = 1 */
+                cg_copy (v [2], v [0], n) ;
+                for (j = mem-1; j >= 0; j--)
+                {
+                    z [j] = cg_dot (A+j*n, v [2], n) ;
+                    cg_daxpy (v [2], Y+j*n, -z [j], n) ;
+                }
+                for (j = 0; j < mem; j++)
+                {
+                    t = cg_dot (Y+j*n, v [2], n) ;
+                    cg_daxpy (v [2], A+j*n, z [j]-t, n) ;
+                }
+                s += v [2][0] ;
+                break ;
+            case 14: /* compact representation, the two blocked passes */
+                cg_bns_dots (R, R+mem, &t, &u, v [0], A, Y, mem-1, mem, mem,
+                             n) ;
+                s += cg_bns_dir (v [2], v [0], ONE, z, z, A, Y, mem-1, mem,
+                                 mem, n) ;
+                break ;
+        }
+    }
+    cg_sink = s ;
+}
+
+int main (int argc, char **argv)
+{
+    int a, blas, cpu, i, k, m, mem, memmax, Mem [NKMEM] = {3,5,11,25,50,100};
+    INT calls, j, l, n, nmax ;
+    double bytes, flops, best, t, tmin, mintime, *v [4], *A, *R, *z ;
+    char *Name [] = {"cg_dot", "cg_daxpy", "cg_step", "cg_update_2",
+                     "cg_update_inf", "cg_update_inf2", "cg_update_ykyk",
+                     "cg_update_d", "cg_Yk", "cg_matvec_Ax", "cg_matvec_Atx",
+                     "cg_trisolve_Rx", "cg_trisolve_Rtx", "lbfgs_twoloop",
+                     "lbfgs_compact"} ;
+    /* bytes and flops per vector element (k < 9) */
+    double Bytes [9] = {16, 24, 24, 24, 24, 24, 24, 24, 32} ;
+    double Flops [9] = { 2,  2,  2,  2,  1,  3,  6,  6,  3} ;
+
+    nmax = 10000000 ;
+    memmax = 100 ;
+    cpu = -1 ;
+    mintime = .02 ;
+    for (a = 1; a+1 < argc; a += 2)
+    {
+        if      ( !strcmp (argv [a], "-n") ) nmax = (INT) atof (argv [a+1]) ;
+        else if ( !strcmp (argv [a], "-m") ) memmax = atoi (argv [a+1]) ;
+        else if ( !strcmp (argv [a], "-c") ) cpu = atoi (argv [a+1]) ;
+        else if ( !strcmp (argv [a], "-t") ) mintime = atof (argv [a+1]) ;
+    }
+#ifdef NOBLAS
+    blas = 0 ;
+#else
+    blas = 1 ;
+#endif
+    if ( cpu >= 0 )
+    {
+#ifdef __linux__
+        cpu_set_t set ;
+        CPU_ZERO (&set) ;
+        CPU_SET (cpu, &set) ;
+        if ( sched_setaffinity (0, sizeof (set), &set) )
+        {
+            fprintf (stderr, "could not pin to cpu %i\n", cpu) ;
+        }
+#else
+        fprintf (stderr, "cpu pinning is only supported on Linux\n") ;
+#endif
+    }
+
+    for (i = 0; i < 4; i++)
+    {
+        v [i] = (double *) malloc (nmax*sizeof (double)) ;
+        if ( v [i] == NULL )
+        {
+            fprintf (stderr, "out of memory, reduce nmax\n") ;
+            return (1) ;
+        }
+        for (j = 0; j < nmax; j++) v [i][j] = 1. + 1.e-3*((j + i) % 7) ;
+    }
+    /* R also holds the 2*mem results of cg_bns_dots */
+    R = (double *) malloc (MAX (memmax*memmax, 2*memmax)*sizeof (double)) ;
+    z = (double *) malloc (memmax*sizeof (double)) ;
+    for (i = 0; i < memmax; i++) z [i] = ONE ;
+
+    printf ("kernel,blas,n,mem,calls,seconds,GB/s,GFLOP/s\n") ;
+    for (k = 0; k < 15; k++)
+    {
+        for (m = 0; m < NKMEM; m++)
+        {
+            mem = (k < 9) ? 0 : Mem [m] ;
+            if ( mem > memmax ) break ;
+            for (i = 0; ; i++)
+            {
+                /* n = 10, 32, 100, 316, ... */
+                n = (INT) (pow (10., 1. + .5*i) + .5) ;
+                if ( k == 11 || k == 12 ) n = mem ; /* only depends on mem */
+                if ( n > nmax ) break ;
+                if ( (k == 9 || k == 10) && (n*mem > 25000000) ) break ;
+                if ( (k >= 13) && (2*n*mem > 25000000) ) break ;
+                A = NULL ;
+                if ( k == 9 || k == 10 || k >= 13 )
+                {
+                    l = (k >= 13) ? 2*n*mem : n*mem ;
+                    A = (double *) malloc (l*sizeof (double)) ;
+                    for (j = 0; j < l; j++) A [j] = 1.e-3*(j % 11) ;
+                }
+                if ( k == 11 || k == 12 )
+                {
+                    /* R = I with leading dimension mem, so that z does not
+                       underflow over repeated solves */
+                    for (j = 0; j < mem*mem; j++) R [j] = ZERO ;
+                    for (j = 0; j < mem; j++) R [j*mem+j] = ONE ;
+                }
+                cg_kernel (k, 1, v, A, R, z, n, mem) ; /* warm up */
+                calls = 1 ;
+                for (;;)
+                {
+                    t = cg_wtime () ;
+                    cg_kernel (k, calls, v, A, R, z, n, mem) ;
+                    t = cg_wtime () - t ;
+                    if ( t >= mintime ) break ;
+                    calls *= 2 ;
+                }
+                best = t ;
+                for (a = 0; a < 2; a++)
+                {
+                    t = cg_wtime () ;
+                    cg_kernel (k, calls, v, A, R, z, n, mem) ;
+                    t = cg_wtime () - t ;
+                    best = MIN (best, t) ;
+                }
+                tmin = best/calls ;
+                if ( k < 9 )
+                {
+                    bytes = Bytes [k]*n ;
+                    flops = Flops [k]*n ;
+                }
+                else if ( k < 11 )
+                {
+                    bytes = 8.*((double) n*mem + n + mem) ;
+                    flops = 2.*n*mem ;
+                }
+                else if ( k < 13 )
+                {
+                    bytes = 8.*(.5*mem*(mem+1) + mem) ;
+                    flops = (double) mem*mem ;
+                }
+                else
+                {
+                    bytes = 8.*(2.*n*mem + 2.*n) ;
+                    flops = 8.*n*mem ;
+                }
+                printf ("%s,%i,%ld,%i,%ld,%.6e,%.4f,%.4f\n", Name [k], blas,
+                        (long) n, mem, (long) calls, tmin, 1.e-9*bytes/tmin,
+                        1.e-9*flops/tmin) ;
+                fflush (stdout) ;
+                free (A) ;
+                if ( k == 11 || k == 12 ) break ;
+            }
+            if ( k < 9 ) break ;
+        }
+    }
+    for (i = 0; i < 4; i++) free (v [i]) ;
+    free (R) ;
+    free (z) ;
+    return (0) ;
+}
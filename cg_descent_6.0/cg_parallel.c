@@ -0,0 +1,422 @@
+/* =========================================================================
+   ============================ CG_PARALLEL ================================
+   =========================================================================
+   Drivers that run several cg_descent at the same time. When the code is
+   compiled with OpenMP, the runs are distributed over the threads,
+   otherwise they are performed one after the other. The user's value,
+   grad, and valgrad routines are called from several threads at once, so
+   they must not modify shared data.
+
+   cg_multistart runs cg_descent from a set of starting guesses. The best
+   function value found by any start is shared by all the starts and a
+   start is abandoned when it is not expected to improve on it.
+
+   cg_portfolio runs several parameter configurations (for example
+   memory = 0, limited memory CG, and L-BFGS) on the same problem. The
+   first configuration that converges wins and the others are cancelled. */
+
+#include <math.h>
+#include <time.h>
+#include "cg_user.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define PRIVATE static
+
+typedef struct cg_multi_struct /* data shared by the starts */
+{
+    double        fbest ; /* best function value found by all starts */
+    cg_parameter  *Parm ; /* user parameters with the abandon rule */
+} cg_multi ;
+
+typedef struct cg_race_struct /* data of one configuration in a portfolio */
+{
+    int         *winner ; /* winning configuration shared by all, -1 = none */
+    cg_parameter  *Parm ; /* parameters of the configuration */
+} cg_race ;
+
+PRIVATE int cg_abandon_start
+(
+    void     *Data, /* cg_multi structure shared by the starts */
+    INT       iter, /* iteration number */
+    double       f, /* function value of the start */
+    double   gnorm, /* gradient sup-norm */
+    double   alpha, /* last stepsize */
+    double   dphi0  /* derivative along the new search direction */
+) ;
+
+PRIVATE int cg_cancel_race
+(
+    void     *Data, /* cg_race structure of the configuration */
+    INT       iter, /* iteration number */
+    double       f, /* function value */
+    double   gnorm, /* gradient sup-norm */
+    double   alpha, /* last stepsize */
+    double   dphi0  /* derivative along the new search direction */
+) ;
+
+PRIVATE double cg_wtime (void) ;
+
+/* =========================================================================
+   ==== cg_multistart ======================================================
+   =========================================================================
+   Run cg_descent from the nstart starting guesses stored in x. The statistics
+   of start k are returned in Stats [k] and its status in status [k], where
+   status 13 means that the start was abandoned. The starts run at the same
+   time, so UParm->TraceFile, FlightFile, and RecordFile are ignored (the
+   failed line searches of the starts are printed with the final statistics
+   when UParm->PrintFinal is T).
+   ========================================================================= */
+int cg_multistart /* return index of the best start: the smallest f among
+                     the starts with status 0 or 1, if there are none, the
+                     smallest f among all the starts, -1 => no f evaluated */
+(
+    double            *x, /* input: start k is x+k*n, k = 0, ..., nstart-1
+                             output: x+k*n is the final iterate of start k */
+    INT                n, /* problem dimension */
+    int           nstart, /* number of starting guesses */
+    int          *status, /* status of each start (13 = abandoned), can be
+                             NULL */
+    cg_stats      *Stats, /* statistics of each start, can be NULL */
+    cg_parameter  *UParm, /* user parameters, NULL = use default parameters */
+    double      grad_tol, /* convergence tolerance, see cg_descent */
+    double        (*value) (double *, INT),  /* f = value (x, n) */
+    void           (*grad) (double *, double *, INT), /* grad (g, x, n) */
+    double      (*valgrad) (double *, double *, INT)  /* f = valgrad (g,x,n)*/
+)
+{
+    int k, best, conv, *s ;
+    double *f ;
+    cg_parameter ParmStruc ;
+    cg_multi Multi ;
+
+    if ( nstart <= 0 ) return (-1) ;
+    if ( UParm == NULL )
+    {
+        cg_default (&ParmStruc) ;
+        UParm = &ParmStruc ;
+    }
+    f = (double *) malloc (nstart*sizeof (double)) ;
+    s = (int *) malloc (nstart*sizeof (int)) ;
+    if ( (f == NULL) || (s == NULL) )
+    {
+        free (f) ;
+        free (s) ;
+        return (-1) ;
+    }
+    Multi.fbest = INF ;
+    Multi.Parm = UParm ;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,1)
+#endif
+    for (k = 0; k < nstart; k++)
+    {
+        cg_parameter Parm ;
+        cg_stats Stat ;
+
+        Parm = *UParm ;
+        Parm.TraceFile = NULL ;  /* the starts would write the same files */
+        Parm.FlightFile = NULL ;
+        Parm.RecordFile = NULL ;
+        Parm.monitor = cg_abandon_start ;
+        Parm.MonitorData = &Multi ;
+        s [k] = cg_descent (x+k*n, n, &Stat, &Parm, grad_tol,
+                            value, grad, valgrad, NULL) ;
+        f [k] = INF ;
+        if ( (s [k] < 10) || (s [k] == 13) ) /* f was evaluated */
+        {
+            f [k] = Stat.f ;
+#ifdef _OPENMP
+#pragma omp critical (cg_multi)
+#endif
+            {
+                if ( Stat.f < Multi.fbest ) Multi.fbest = Stat.f ;
+            }
+        }
+        if ( Stats != NULL ) Stats [k] = Stat ;
+        if ( status != NULL ) status [k] = s [k] ;
+    }
+
+    /* the best start that converged, otherwise the best start */
+    best = -1 ;
+    conv = FALSE ;
+    for (k = 0; k < nstart; k++)
+    {
+        if ( f [k] == INF ) continue ;
+        if ( (s [k] == 0) || (s [k] == 1) )
+        {
+            if ( !conv || (f [k] < f [best]) ) best = k ;
+            conv = TRUE ;
+        }
+        else if ( !conv && ((best < 0) || (f [k] < f [best])) ) best = k ;
+    }
+
+    if ( UParm->PrintFinal )
+    {
+        printf ("\nmultistart: %i starts, best start: %i", nstart, best) ;
+        if ( best >= 0 ) printf (" f: %13.6e", f [best]) ;
+        printf ("\n") ;
+    }
+    free (f) ;
+    free (s) ;
+    return (best) ;
+}
+
+/* =========================================================================
+   ==== cg_abandon_start ===================================================
+   =========================================================================
+   Monitor routine of a start in cg_multistart. The function value of the
+   start updates the shared best value fbest, then the abandon rule is
+   checked. The user's monitor routine, if any, is called first.
+   ========================================================================= */
+PRIVATE int cg_abandon_start
+(
+    void     *Data, /* cg_multi structure shared by the starts */
+    INT       iter, /* iteration number */
+    double       f, /* function value of the start */
+    double   gnorm, /* gradient sup-norm */
+    double   alpha, /* last stepsize */
+    double   dphi0  /* derivative along the new search direction */
+)
+{
+    double fbest ;
+    cg_multi *Multi ;
+    cg_parameter *Parm ;
+
+    Multi = (cg_multi *) Data ;
+    Parm = Multi->Parm ;
+    if ( Parm->monitor != NULL )
+    {
+        if ( Parm->monitor (Parm->MonitorData, iter, f, gnorm, alpha, dphi0) )
+        {
+            return (1) ;
+        }
+    }
+#ifdef _OPENMP
+#pragma omp critical (cg_multi)
+#endif
+    {
+        if ( f < Multi->fbest ) Multi->fbest = f ;
+        fbest = Multi->fbest ;
+    }
+    if ( Parm->abandon != NULL )
+    {
+        return (Parm->abandon (fbest, iter, f, gnorm, alpha, dphi0)) ;
+    }
+    if ( (Parm->AbandonIter < 0) || (iter < Parm->AbandonIter) ) return (0) ;
+    if ( f + Parm->AbandonFac*alpha*dphi0 >
+         fbest + Parm->AbandonTol*fabs (fbest) ) return (1) ;
+    return (0) ;
+}
+
+/* =========================================================================
+   ==== cg_portfolio =======================================================
+   =========================================================================
+   Run the nconfig parameter configurations Parms [0], ..., Parms [nconfig-1]
+   at the same time from the starting guess x. The first configuration that
+   converges (status 0 or 1) wins, the others are cancelled (status 13) at
+   the end of their current iteration. With OpenMP, each configuration has
+   its own thread; without OpenMP, the configurations are run one after the
+   other, so the first one wins if it converges. TraceFile, FlightFile, and
+   RecordFile of the configurations are ignored. If LogFile is not NULL,
+   a line describing the race is appended to it:
+
+   portfolio n: 1000 nconfig: 3 winner: 1 memory: 11 LBFGS: 0 iter: 41
+   nfunc: 83 ngrad: 47 f: -1.2e+03 time: 1.5e-02
+
+   (on one line) so that the winners collected over many problems can be
+   used to choose the default configuration of a workload.
+   ========================================================================= */
+int cg_portfolio /* return index of the winning configuration,
+                    -1 => no configuration converged */
+(
+    double            *x, /* input: starting guess, output: final iterate of
+                             the winner, or if there is no winner, of the
+                             configuration with the smallest f */
+    INT                n, /* problem dimension */
+    int          nconfig, /* number of configurations */
+    cg_parameter  *Parms, /* array of nconfig configurations, NULL => three
+                             default configurations with memory = 0,
+                             memory = 11, and memory = 11 with LBFGS */
+    int          *status, /* status of each configuration (13 = cancelled),
+                             can be NULL */
+    cg_stats      *Stats, /* statistics of each configuration, can be NULL */
+    double      grad_tol, /* convergence tolerance, see cg_descent */
+    double        (*value) (double *, INT),  /* f = value (x, n) */
+    void           (*grad) (double *, double *, INT), /* grad (g, x, n) */
+    double      (*valgrad) (double *, double *, INT), /* f = valgrad (g,x,n)*/
+    char        *LogFile  /* file where the result is appended, NULL = none */
+)
+{
+    int k, best, winner, *s ;
+    INT i ;
+    double time, *f, *xk ;
+    cg_parameter Default [3] ;
+    cg_stats *St ;
+    FILE *file ;
+
+    if ( Parms == NULL )
+    {
+        for (k = 0; k < 3; k++) cg_default (Default+k) ;
+        Default [0].memory = 0 ;
+        Default [2].LBFGS = TRUE ;
+        Parms = Default ;
+        nconfig = 3 ;
+    }
+    if ( nconfig <= 0 ) return (-1) ;
+    xk = (double *) malloc (nconfig*n*sizeof (double)) ;
+    f = (double *) malloc (nconfig*sizeof (double)) ;
+    s = (int *) malloc (nconfig*sizeof (int)) ;
+    St = (cg_stats *) malloc (nconfig*sizeof (cg_stats)) ;
+    if ( (xk == NULL) || (f == NULL) || (s == NULL) || (St == NULL) )
+    {
+        free (xk) ;
+        free (f) ;
+        free (s) ;
+        free (St) ;
+        return (-1) ;
+    }
+    for (k = 0; k < nconfig; k++)
+    {
+        for (i = 0; i < n; i++) xk [k*n+i] = x [i] ;
+    }
+    winner = -1 ;
+    time = cg_wtime () ;
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nconfig) schedule(static,1)
+#endif
+    for (k = 0; k < nconfig; k++)
+    {
+        cg_parameter Parm ;
+        cg_race Race ;
+
+        Race.winner = &winner ;
+        Race.Parm = Parms+k ;
+        Parm = Parms [k] ;
+        Parm.TraceFile = NULL ;  /* the configurations would share the files */
+        Parm.FlightFile = NULL ;
+        Parm.RecordFile = NULL ;
+        Parm.monitor = cg_cancel_race ;
+        Parm.MonitorData = &Race ;
+        s [k] = cg_descent (xk+k*n, n, St+k, &Parm, grad_tol,
+                            value, grad, valgrad, NULL) ;
+        f [k] = INF ;
+        if ( (s [k] < 10) || (s [k] == 13) ) f [k] = St [k].f ;
+        if ( (s [k] == 0) || (s [k] == 1) )
+        {
+#ifdef _OPENMP
+#pragma omp critical (cg_race)
+#endif
+            {
+                if ( winner < 0 ) winner = k ;
+            }
+        }
+    }
+    time = cg_wtime () - time ;
+
+    /* without a winner, return the configuration with the smallest f */
+    best = winner ;
+    if ( best < 0 )
+    {
+        for (k = 0; k < nconfig; k++)
+        {
+            if ( f [k] == INF ) continue ;
+            if ( (best < 0) || (f [k] < f [best]) ) best = k ;
+        }
+    }
+    if ( best >= 0 )
+    {
+        for (i = 0; i < n; i++) x [i] = xk [best*n+i] ;
+    }
+
+    for (k = 0; k < nconfig; k++)
+    {
+        if ( status != NULL ) status [k] = s [k] ;
+        if ( Stats != NULL ) Stats [k] = St [k] ;
+    }
+    if ( (LogFile != NULL) && (best >= 0) )
+    {
+        file = fopen (LogFile, "a") ;
+        if ( file != NULL )
+        {
+            fprintf (file, "portfolio n: %ld nconfig: %i winner: %i "
+                     "memory: %i LBFGS: %i iter: %ld nfunc: %ld ngrad: %ld "
+                     "f: %e time: %e\n", (long) n, nconfig, winner,
+                     Parms [best].memory, Parms [best].LBFGS,
+                     (long) St [best].iter, (long) St [best].nfunc,
+                     (long) St [best].ngrad, St [best].f, time) ;
+            fclose (file) ;
+        }
+    }
+    if ( Parms [0].PrintFinal )
+    {
+        if ( winner >= 0 )
+        {
+            printf ("\nportfolio winner: configuration %i (memory: %i "
+                    "LBFGS: %i) time: %e\n", winner, Parms [winner].memory,
+                    Parms [winner].LBFGS, time) ;
+        }
+        else printf ("\nportfolio: no configuration converged\n") ;
+    }
+
+    free (xk) ;
+    free (f) ;
+    free (s) ;
+    free (St) ;
+    return (winner) ;
+}
+
+/* =========================================================================
+   ==== cg_cancel_race =====================================================
+   =========================================================================
+   Monitor routine of a configuration in cg_portfolio, stop when another
+   configuration has won. The user's monitor routine is called first.
+   ========================================================================= */
+PRIVATE int cg_cancel_race
+(
+    void     *Data, /* cg_race structure of the configuration */
+    INT       iter, /* iteration number */
+    double       f, /* function value */
+    double   gnorm, /* gradient sup-norm */
+    double   alpha, /* last stepsize */
+    double   dphi0  /* derivative along the new search direction */
+)
+{
+    int winner ;
+    cg_race *Race ;
+    cg_parameter *Parm ;
+
+    Race = (cg_race *) Data ;
+    Parm = Race->Parm ;
+    if ( Parm->monitor != NULL )
+    {
+        if ( Parm->monitor (Parm->MonitorData, iter, f, gnorm, alpha, dphi0) )
+        {
+            return (1) ;
+        }
+    }
+#ifdef _OPENMP
+#pragma omp critical (cg_race)
+#endif
+    {
+        winner = *(Race->winner) ;
+    }
+    return (winner >= 0) ;
+}
+
+/* =========================================================================
+   ==== cg_wtime ===========================================================
+   =========================================================================
+   Wall clock time in seconds, processor time without OpenMP
+   ========================================================================= */
+PRIVATE double cg_wtime (void)
+{
+#ifdef _OPENMP
+    return (omp_get_wtime ()) ;
+#else
+    return ((double) clock ()/CLOCKS_PER_SEC) ;
+#endif
+}
@@ -0,0 +1,331 @@
+/* Preconditioner benchmark: ill-conditioned problems are solved with
+   memory = 0, limited memory CG, and L-BFGS, each without a preconditioner,
+   with the preconditioner of the problem (Parm.PrecondDiag or
+   Parm.precond), and with the automatic diagonal scaling (Parm.AutoDiag).
+   The iteration and evaluation counts are printed with the ratio of the
+   iterations without a preconditioner to the iterations with one. The
+   stopping rule is |g|_infty <= max (1e-6, 1e-8 times the initial
+   |g|_infty) (StopRule with StopFac = 1e-8 and grad_tol = 1e-6), and at
+   most 50n iterations are done (status 2).
+
+   cg_prec [n]
+
+   n is the problem dimension (default 1000). The problems are
+
+   scaledquad  f = sum c_i ((x_i-1)^2/2 + (x_i-1)^4/4), c_i from 1 to 1e6,
+               diagonal preconditioner 1/c_i
+   scaledexp   the problem of driver1.c in the variables y_i = x_i/s_i,
+               s_i from 10^-1.5 to 10^1.5, diagonal preconditioner given by the
+               inverse of the Hessian diagonal at the solution
+   pde1d       -u'' + exp (u) = 10 on (0, 1) with zero boundary values,
+               f = sum (u_i+1 - u_i)^2/(2h) + h sum (exp (u_i) - 10 u_i),
+               the condition number grows like n^2; the preconditioner
+               routine solves with the tridiagonal matrix A/h + h I */
+
+#include <math.h>
+#include "cg_user.h"
+
+#define NPROB 3
+#define NCONFIG 3
+
+static double *C ;     /* scaling of scaledquad and scaledexp */
+
+static double quad_value (double *x, INT n) ;
+static void quad_grad (double *g, double *x, INT n) ;
+static double quad_valgrad (double *g, double *x, INT n) ;
+static double exp_value (double *x, INT n) ;
+static void exp_grad (double *g, double *x, INT n) ;
+static double exp_valgrad (double *g, double *x, INT n) ;
+static double pde_value (double *x, INT n) ;
+static void pde_grad (double *g, double *x, INT n) ;
+static double pde_valgrad (double *g, double *x, INT n) ;
+static void pde_precond (double *Pg, double *g, INT n, void *Data) ;
+
+int main (int argc, char **argv)
+{
+    int k, p, pre, status ;
+    INT i, n, iter [3] ;
+    double *x, *diag, *work, h ;
+    cg_parameter Parm ;
+    cg_stats Stats ;
+    char *name [NPROB] = {"scaledquad", "scaledexp", "pde1d"} ;
+    char *config [NCONFIG] = {"cg", "lmcg", "lbfgs"} ;
+    char *precond [3] = {"no", "yes", "auto"} ;
+
+    n = 1000 ;
+    if ( argc > 1 ) n = atol (argv [1]) ;
+    x = (double *) malloc (n*sizeof (double)) ;
+    diag = (double *) malloc (n*sizeof (double)) ;
+    work = (double *) malloc (2*n*sizeof (double)) ;
+    C = (double *) malloc (n*sizeof (double)) ;
+
+    printf ("problem       n config precond status   iter  nfunc  ngrad"
+            "        time  iter ratio\n") ;
+    for (p = 0; p < NPROB; p++)
+    {
+        /* scaling and diagonal preconditioner */
+        for (i = 0; i < n; i++)
+        {
+            h = (n > 1) ? ((double) i)/(n-1) : 0. ;
+            if ( p == 0 )
+            {
+                C [i] = pow (10., 6.*h) ;
+                diag [i] = 1./C [i] ;
+            }
+            else if ( p == 1 )
+            {
+                C [i] = pow (10., 3.*h - 1.5) ;
+                diag [i] = 1./(C [i]*C [i]*sqrt (i+1.)) ;
+            }
+        }
+        for (k = 0; k < NCONFIG; k++)
+        {
+            for (pre = 0; pre < 3; pre++)
+            {
+                cg_default (&Parm) ;
+                Parm.PrintFinal = FALSE ;
+                Parm.Timing = TRUE ;
+                Parm.memory = (k == 0) ? 0 : 11 ;
+                Parm.LBFGS = (k == 2) ;
+                Parm.StopFac = 1.e-8 ; /* |g| <= max (1e-6, 1e-8 |g0|) */
+                Parm.maxit = 50*n ;
+                if ( pre == 2 ) Parm.AutoDiag = TRUE ;
+                else if ( pre == 1 )
+                {
+                    if ( p < 2 ) Parm.PrecondDiag = diag ;
+                    else
+                    {
+                        Parm.precond = pde_precond ;
+                        Parm.PrecondData = work ;
+                    }
+                }
+                for (i = 0; i < n; i++) x [i] = 0. ;
+                if ( p == 0 )
+                {
+                    status = cg_descent (x, n, &Stats, &Parm, 1.e-6,
+                                quad_value, quad_grad, quad_valgrad, NULL) ;
+                }
+                else if ( p == 1 )
+                {
+                    status = cg_descent (x, n, &Stats, &Parm, 1.e-6,
+                                exp_value, exp_grad, exp_valgrad, NULL) ;
+                }
+                else
+                {
+                    status = cg_descent (x, n, &Stats, &Parm, 1.e-6,
+                                pde_value, pde_grad, pde_valgrad, NULL) ;
+                }
+                iter [pre] = Stats.iter ;
+                printf ("%-10s %4ld %6s %7s %6i %6ld %6ld %6ld %11.4e",
+                        name [p], (long) n, config [k], precond [pre],
+                        status, (long) Stats.iter, (long) Stats.nfunc,
+                        (long) Stats.ngrad, Stats.time.total) ;
+                if ( pre && (iter [pre] > 0) )
+                {
+                    printf ("  %10.2f", ((double) iter [0])/iter [pre]) ;
+                }
+                printf ("\n") ;
+            }
+        }
+    }
+    free (x) ;
+    free (diag) ;
+    free (work) ;
+    free (C) ;
+    return (0) ;
+}
+
+/* scaledquad: f = sum c_i ((x_i-1)^2/2 + (x_i-1)^4/4) */
+static double quad_value
+(
+    double   *x,
+    INT       n
+)
+{
+    double f, t ;
+    INT i ;
+    f = 0. ;
+    for (i = 0; i < n; i++)
+    {
+        t = (x [i] - 1.)*(x [i] - 1.) ;
+        f += C [i]*(.5*t + .25*t*t) ;
+    }
+    return (f) ;
+}
+
+static void quad_grad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    double t ;
+    INT i ;
+    for (i = 0; i < n; i++)
+    {
+        t = x [i] - 1. ;
+        g [i] = C [i]*(t + t*t*t) ;
+    }
+}
+
+static double quad_valgrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    double f, t, t2 ;
+    INT i ;
+    f = 0. ;
+    for (i = 0; i < n; i++)
+    {
+        t = x [i] - 1. ;
+        t2 = t*t ;
+        f += C [i]*(.5*t2 + .25*t2*t2) ;
+        g [i] = C [i]*(t + t*t2) ;
+    }
+    return (f) ;
+}
+
+/* scaledexp: f = sum exp (s_i y_i) - sqrt (i) s_i y_i */
+static double exp_value
+(
+    double   *x,
+    INT       n
+)
+{
+    double f, t ;
+    INT i ;
+    f = 0. ;
+    for (i = 0; i < n; i++)
+    {
+        t = C [i]*x [i] ;
+        f += exp (t) - sqrt (i+1.)*t ;
+    }
+    return (f) ;
+}
+
+static void exp_grad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    for (i = 0; i < n; i++)
+    {
+        g [i] = C [i]*(exp (C [i]*x [i]) - sqrt (i+1.)) ;
+    }
+}
+
+static double exp_valgrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    double ex, f, t ;
+    INT i ;
+    f = 0. ;
+    for (i = 0; i < n; i++)
+    {
+        t = C [i]*x [i] ;
+        ex = exp (t) ;
+        f += ex - sqrt (i+1.)*t ;
+        g [i] = C [i]*(ex - sqrt (i+1.)) ;
+    }
+    return (f) ;
+}
+
+/* pde1d: f = sum (u_i+1 - u_i)^2/(2h) + h sum (exp (u_i) - 10 u_i) */
+static double pde_value
+(
+    double   *x,
+    INT       n
+)
+{
+    double f, h, t ;
+    INT i ;
+    h = 1./(n+1) ;
+    f = .5*(x [0]*x [0] + x [n-1]*x [n-1])/h ;
+    for (i = 0; i < n; i++)
+    {
+        if ( i < n-1 )
+        {
+            t = x [i+1] - x [i] ;
+            f += .5*t*t/h ;
+        }
+        f += h*(exp (x [i]) - 10.*x [i]) ;
+    }
+    return (f) ;
+}
+
+static void pde_grad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    pde_valgrad (g, x, n) ;
+}
+
+static double pde_valgrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    double ex, f, h, l, r, t ;
+    INT i ;
+    h = 1./(n+1) ;
+    f = .5*(x [0]*x [0] + x [n-1]*x [n-1])/h ;
+    for (i = 0; i < n; i++)
+    {
+        l = (i > 0) ? x [i-1] : 0. ;
+        r = (i < n-1) ? x [i+1] : 0. ;
+        if ( i < n-1 )
+        {
+            t = r - x [i] ;
+            f += .5*t*t/h ;
+        }
+        ex = exp (x [i]) ;
+        f += h*(ex - 10.*x [i]) ;
+        g [i] = (2.*x [i] - l - r)/h + h*(ex - 10.) ;
+    }
+    return (f) ;
+}
+
+/* Pg = (A/h + h I)^{-1} g, A = tridiag (-1, 2, -1), by the Thomas algorithm;
+   Data is a work array of length 2n */
+static void pde_precond
+(
+    double   *Pg,
+    double    *g,
+    INT        n,
+    void   *Data
+)
+{
+    double a, b, h, m, *c, *w ;
+    INT i ;
+    c = (double *) Data ;
+    w = c + n ;
+    h = 1./(n+1) ;
+    a = -1./h ;        /* off diagonal */
+    b = 2./h + h ;     /* diagonal */
+    c [0] = a/b ;
+    w [0] = g [0]/b ;
+    for (i = 1; i < n; i++)
+    {
+        m = b - a*c [i-1] ;
+        c [i] = a/m ;
+        w [i] = (g [i] - a*w [i-1])/m ;
+    }
+    Pg [n-1] = w [n-1] ;
+    for (i = n-2; i >= 0; i--) Pg [i] = w [i] - c [i]*Pg [i+1] ;
+}
@@ -0,0 +1,537 @@
+/* =========================================================================
+   =============================== CG_PSEP =================================
+   =========================================================================
+   Partially separable objectives
+
+       f (x) = sum_e f_e (x_e),
+
+   where the element function f_e only depends on the few variables x_e
+   listed with the element (finite element energies, residuals of a factor
+   graph). The elements are registered with cg_psep_add and the problem is
+   solved by cg_psep_descent, which calls cg_descent with value, grad, and
+   valgrad routines that evaluate the elements and assemble f and g:
+
+   - The elements are colored, so that two elements of the same color
+     never share a variable. The colors are assembled one after the other
+     and the elements of a color in parallel (OpenMP), so each thread adds
+     its element gradients into g without atomics or private copies of g.
+     The sums do not depend on the number of threads: g_i is accumulated
+     in the order of the colors and f in the order of the elements.
+
+   - The value and gradient of each element are kept from the previous
+     evaluation, together with the evaluation point. An element is only
+     evaluated again when one of its variables changed. In the line search
+     the trial points x + alpha*d only differ where d is nonzero, so the
+     elements that do not touch the support of d are not evaluated again,
+     and a gradient requested at the point of the previous value only
+     costs the gradients of the elements.
+
+   The element functions are called from several threads at once, so they
+   must not modify shared data. Several problems can be solved at the same
+   time in different threads (for example by cg_multistart through
+   cg_psep_eval), but one cg_psep object is used by one solve at a time. */
+
+#include <math.h>
+#include "cg_user.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define PRIVATE static
+#define MAX(a,b) (((a) > (b)) ? (a) : (b))
+
+#if defined (__GNUC__)
+#define CG_TLS __thread
+#elif defined (_MSC_VER)
+#define CG_TLS __declspec (thread)
+#else
+#define CG_TLS
+#endif
+
+#define CG_PSEP_F 1     /* the element value is up to date */
+#define CG_PSEP_G 2     /* the element gradient is up to date */
+#define CG_PSEP_CHUNK 64/* elements handed to a thread at a time */
+
+struct cg_psep_struct
+{
+    INT              n ; /* number of variables */
+    INT           nelt ; /* number of elements */
+    INT         maxelt ; /* size of the element arrays */
+    INT         maxvar ; /* size of vars */
+    int          maxne ; /* largest number of variables of an element */
+    int          ready ; /* T (colors and caches are set up for the
+                            current elements) */
+    cg_element   *func ; /* element functions */
+    void        **Data ; /* their data */
+    INT           *ptr ; /* variables of element e are vars [ptr [e]], ...,
+                            vars [ptr [e+1]-1] */
+    INT          *vars ;
+    int         ncolor ; /* number of colors */
+    INT        *colptr ; /* elements of color c are order [colptr [c]], ...,
+                            order [colptr [c+1]-1] */
+    INT         *order ;
+    double         *fe ; /* element values at xs */
+    double         *ge ; /* element gradients at xs, stored like vars */
+    unsigned char *state ; /* CG_PSEP_F and CG_PSEP_G of each element */
+    double         *xs ; /* point of the previous evaluation */
+    unsigned char  *chg ; /* T (variable changed since the evaluation) */
+    int        nthread ; /* threads with room in xbuf */
+    double       *xbuf ; /* maxne values of the element variables per
+                            thread */
+    INT          neval ; /* number of element evaluations */
+    INT         nreuse ; /* element values or gradients taken from the
+                            previous evaluation */
+} ;
+
+/* the problem solved by cg_psep_descent in this thread, used by the
+   value, grad, and valgrad routines given to cg_descent */
+PRIVATE CG_TLS cg_psep *cg_psep_cur = NULL ;
+
+PRIVATE int cg_psep_setup
+(
+    cg_psep         *P  /* objective */
+) ;
+
+PRIVATE double cg_psep_value
+(
+    double          *x,
+    INT              n
+) ;
+
+PRIVATE void cg_psep_grad
+(
+    double          *g,
+    double          *x,
+    INT              n
+) ;
+
+PRIVATE double cg_psep_valgrad
+(
+    double          *g,
+    double          *x,
+    INT              n
+) ;
+
+/* =========================================================================
+   ==== cg_psep_new ========================================================
+   =========================================================================
+   Create an objective with n variables and no elements
+   ========================================================================= */
+cg_psep *cg_psep_new /* return the objective, NULL => out of memory */
+(
+    INT              n  /* number of variables */
+)
+{
+    cg_psep *P ;
+    P = (cg_psep *) malloc (sizeof (cg_psep)) ;
+    if ( P == NULL ) return (NULL) ;
+    P->n = n ;
+    P->nelt = P->maxelt = P->maxvar = 0 ;
+    P->maxne = 0 ;
+    P->ready = FALSE ;
+    P->func = NULL ;
+    P->Data = NULL ;
+    P->ptr = (INT *) malloc (sizeof (INT)) ;
+    P->vars = NULL ;
+    P->ncolor = 0 ;
+    P->colptr = P->order = NULL ;
+    P->fe = P->ge = P->xs = P->xbuf = NULL ;
+    P->state = P->chg = NULL ;
+    P->nthread = 0 ;
+    P->neval = P->nreuse = 0 ;
+    if ( P->ptr == NULL )
+    {
+        free (P) ;
+        return (NULL) ;
+    }
+    P->ptr [0] = 0 ;
+    return (P) ;
+}
+
+/* =========================================================================
+   ==== cg_psep_add ========================================================
+   =========================================================================
+   Add the element func with the variables vars [0], ..., vars [ne-1]. The
+   element function gets the values of these variables, in this order.
+   ========================================================================= */
+INT cg_psep_add /* return the number of the element (0, 1, ...),
+                   -1 => out of memory or an index outside [0, n) */
+(
+    cg_psep         *P, /* objective */
+    cg_element    func, /* element function */
+    void         *Data, /* passed to func, can be NULL */
+    int             ne, /* number of variables of the element */
+    INT          *vars  /* indices of the variables */
+)
+{
+    int j ;
+    INT e, k, m ;
+    void *p ;
+    if ( ne < 0 ) return (-1) ;
+    for (j = 0; j < ne; j++)
+    {
+        if ( (vars [j] < 0) || (vars [j] >= P->n) ) return (-1) ;
+    }
+    e = P->nelt ;
+    if ( e == P->maxelt ) /* double the element arrays */
+    {
+        m = 2*P->maxelt + 64 ;
+        p = realloc (P->func, m*sizeof (cg_element)) ;
+        if ( p == NULL ) return (-1) ;
+        P->func = (cg_element *) p ;
+        p = realloc (P->Data, m*sizeof (void *)) ;
+        if ( p == NULL ) return (-1) ;
+        P->Data = (void **) p ;
+        p = realloc (P->ptr, (m+1)*sizeof (INT)) ;
+        if ( p == NULL ) return (-1) ;
+        P->ptr = (INT *) p ;
+        P->maxelt = m ;
+    }
+    k = P->ptr [e] ;
+    if ( k + ne > P->maxvar )
+    {
+        m = 2*P->maxvar + ne + 256 ;
+        p = realloc (P->vars, m*sizeof (INT)) ;
+        if ( p == NULL ) return (-1) ;
+        P->vars = (INT *) p ;
+        P->maxvar = m ;
+    }
+    for (j = 0; j < ne; j++) P->vars [k+j] = vars [j] ;
+    P->func [e] = func ;
+    P->Data [e] = Data ;
+    P->ptr [e+1] = k + ne ;
+    P->maxne = MAX (P->maxne, ne) ;
+    P->nelt = e + 1 ;
+    P->ready = FALSE ;
+    return (e) ;
+}
+
+/* =========================================================================
+   ==== cg_psep_descent ====================================================
+   =========================================================================
+   Minimize the partially separable objective P with cg_descent
+   ========================================================================= */
+int cg_psep_descent /* return the status of cg_descent, 10 => out of
+                       memory */
+(
+    double          *x, /* input: starting guess, output: the solution */
+    cg_stats    *Stats, /* structure with statistics, can be NULL */
+    cg_parameter *UParm,/* user parameters, NULL = use default parameters */
+    double    grad_tol, /* convergence tolerance, see cg_descent */
+    cg_psep         *P  /* objective */
+)
+{
+    int status ;
+    cg_psep *Psave ;
+    if ( cg_psep_setup (P) ) return (10) ;
+    Psave = cg_psep_cur ;
+    cg_psep_cur = P ;
+    status = cg_descent (x, P->n, Stats, UParm, grad_tol, cg_psep_value,
+                         cg_psep_grad, cg_psep_valgrad, NULL) ;
+    cg_psep_cur = Psave ;
+    if ( (UParm != NULL) && UParm->PrintFinal )
+    {
+        printf ("elements: %ld colors: %i element evaluations: %ld "
+                "reused: %ld\n", (long) P->nelt, P->ncolor, (long) P->neval,
+                (long) P->nreuse) ;
+    }
+    return (status) ;
+}
+
+/* =========================================================================
+   ==== cg_psep_eval =======================================================
+   =========================================================================
+   Evaluate f (x) and, when g is not NULL, g (x). Only the elements with a
+   variable that changed since the previous evaluation are evaluated.
+   ========================================================================= */
+double cg_psep_eval /* return f (x), nan => out of memory */
+(
+    double          *g, /* output: gradient, NULL => only f */
+    double          *x, /* evaluation point */
+    cg_psep         *P  /* objective */
+)
+{
+    int need, nthread ;
+    INT e, n, neval, nreuse ;
+    double f ;
+    if ( cg_psep_setup (P) ) return (log (-1.)) ;
+    n = P->n ;
+    need = (g == NULL) ? CG_PSEP_F : CG_PSEP_F | CG_PSEP_G ;
+
+    /* room for the element variables of each thread */
+#ifdef _OPENMP
+    nthread = omp_get_max_threads () ;
+#else
+    nthread = 1 ;
+#endif
+    if ( nthread > P->nthread )
+    {
+        free (P->xbuf) ;
+        P->xbuf = (double *) malloc (nthread*MAX (P->maxne, 1)*
+                                     sizeof (double)) ;
+        P->nthread = (P->xbuf == NULL) ? 0 : nthread ;
+        if ( P->xbuf == NULL ) return (log (-1.)) ;
+    }
+
+    neval = nreuse = 0 ;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        int c, j, ne ;
+        INT e1, k, l, q ;
+        double *xe, *ge ;
+#ifdef _OPENMP
+        xe = P->xbuf + omp_get_thread_num ()*P->maxne ;
+#else
+        xe = P->xbuf ;
+#endif
+        /* mark the variables that changed */
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+        for (l = 0; l < n; l++)
+        {
+            P->chg [l] = (x [l] != P->xs [l]) ;
+            P->xs [l] = x [l] ;
+            if ( g != NULL ) g [l] = 0. ;
+        }
+
+        /* the elements of a color share no variable, so their gradients
+           are added into g without conflicts */
+        for (c = 0; c < P->ncolor; c++)
+        {
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,CG_PSEP_CHUNK) reduction(+:neval,nreuse)
+#endif
+            for (k = P->colptr [c]; k < P->colptr [c+1]; k++)
+            {
+                e1 = P->order [k] ;
+                q = P->ptr [e1] ;
+                ne = (int) (P->ptr [e1+1] - q) ;
+                for (j = 0; j < ne; j++)
+                {
+                    if ( P->chg [P->vars [q+j]] )
+                    {
+                        P->state [e1] = 0 ;
+                        break ;
+                    }
+                }
+                if ( (P->state [e1] & need) != need )
+                {
+                    for (j = 0; j < ne; j++) xe [j] = x [P->vars [q+j]] ;
+                    ge = (g == NULL) ? NULL : P->ge + q ;
+                    P->fe [e1] = P->func [e1] (ge, xe, ne, P->Data [e1]) ;
+                    P->state [e1] = (unsigned char) need ;
+                    neval++ ;
+                }
+                else nreuse++ ;
+                if ( g != NULL )
+                {
+                    ge = P->ge + q ;
+                    for (j = 0; j < ne; j++) g [P->vars [q+j]] += ge [j] ;
+                }
+            }
+        }
+    }
+    P->neval += neval ;
+    P->nreuse += nreuse ;
+
+    /* sum in the order of the elements, independent of the threads */
+    f = 0. ;
+    for (e = 0; e < P->nelt; e++) f += P->fe [e] ;
+    return (f) ;
+}
+
+/* =========================================================================
+   ==== cg_psep_info =======================================================
+   =========================================================================
+   Return the number of colors, and the number of element evaluations and
+   of element results reused from the previous evaluation, summed over
+   all the evaluations so far
+   ========================================================================= */
+void cg_psep_info
+(
+    cg_psep         *P, /* objective */
+    int        *ncolor, /* output: number of colors, can be NULL */
+    INT         *neval, /* output: element evaluations, can be NULL */
+    INT        *nreuse  /* output: element results reused, can be NULL */
+)
+{
+    if ( ncolor != NULL ) *ncolor = P->ncolor ;
+    if ( neval != NULL ) *neval = P->neval ;
+    if ( nreuse != NULL ) *nreuse = P->nreuse ;
+}
+
+/* =========================================================================
+   ==== cg_psep_free =======================================================
+   =========================================================================
+   Free the objective
+   ========================================================================= */
+void cg_psep_free
+(
+    cg_psep         *P  /* objective */
+)
+{
+    if ( P == NULL ) return ;
+    free (P->func) ;
+    free (P->Data) ;
+    free (P->ptr) ;
+    free (P->vars) ;
+    free (P->colptr) ;
+    free (P->order) ;
+    free (P->fe) ;
+    free (P->ge) ;
+    free (P->state) ;
+    free (P->xs) ;
+    free (P->chg) ;
+    free (P->xbuf) ;
+    free (P) ;
+}
+
+/* =========================================================================
+   ==== cg_psep_setup ======================================================
+   =========================================================================
+   Color the elements and allocate the caches when elements were added.
+   The greedy coloring gives each element, in the order they were added,
+   the smallest color not used by an element sharing one of its variables.
+   ========================================================================= */
+PRIVATE int cg_psep_setup /* return 0 (ok) or 1 (out of memory) */
+(
+    cg_psep         *P  /* objective */
+)
+{
+    int c, *color ;
+    INT e, e2, i, k, l, n, nelt, nvar, *vptr, *velt, *mark ;
+    if ( P->ready ) return (0) ;
+    n = P->n ;
+    nelt = P->nelt ;
+    nvar = P->ptr [nelt] ;
+    free (P->colptr) ;
+    free (P->order) ;
+    free (P->fe) ;
+    free (P->ge) ;
+    free (P->state) ;
+    free (P->xs) ;
+    free (P->chg) ;
+    free (P->xbuf) ;
+    P->nthread = 0 ;
+    P->xbuf = NULL ;
+    P->colptr = (INT *) malloc ((nelt+1)*sizeof (INT)) ;
+    P->order = (INT *) malloc ((nelt+1)*sizeof (INT)) ;
+    P->fe = (double *) malloc ((nelt+1)*sizeof (double)) ;
+    P->ge = (double *) malloc ((nvar+1)*sizeof (double)) ;
+    P->state = (unsigned char *) calloc (nelt+1, sizeof (unsigned char)) ;
+    P->xs = (double *) calloc (n+1, sizeof (double)) ;
+    P->chg = (unsigned char *) malloc ((n+1)*sizeof (unsigned char)) ;
+    color = (int *) malloc ((nelt+1)*sizeof (int)) ;
+    vptr = (INT *) calloc (n+1, sizeof (INT)) ;
+    velt = (INT *) malloc ((nvar+1)*sizeof (INT)) ;
+    mark = (INT *) malloc ((nelt+1)*sizeof (INT)) ;
+    if ( (P->colptr == NULL) || (P->order == NULL) || (P->fe == NULL) ||
+         (P->ge == NULL) || (P->state == NULL) || (P->xs == NULL) ||
+         (P->chg == NULL) || (color == NULL) || (vptr == NULL) ||
+         (velt == NULL) || (mark == NULL) )
+    {
+        free (color) ;
+        free (vptr) ;
+        free (velt) ;
+        free (mark) ;
+        return (1) ;
+    }
+
+    /* elements of each variable: velt [vptr [i]], ..., velt [vptr [i+1]-1] */
+    for (k = 0; k < nvar; k++) vptr [P->vars [k]]++ ;
+    for (i = 0, l = 0; i < n; i++)
+    {
+        k = vptr [i] ;
+        vptr [i] = l ;
+        l += k ;
+    }
+    vptr [n] = l ;
+    for (e = 0; e < nelt; e++)
+    {
+        for (k = P->ptr [e]; k < P->ptr [e+1]; k++)
+        {
+            velt [vptr [P->vars [k]]++] = e ;
+        }
+    }
+    for (i = n; i > 0; i--) vptr [i] = vptr [i-1] ;
+    vptr [0] = 0 ;
+
+    /* greedy coloring, mark [c] = e when color c is used by a neighbor
+       of element e */
+    P->ncolor = 0 ;
+    for (e = 0; e < nelt; e++)
+    {
+        color [e] = -1 ;
+        mark [e] = -1 ;
+    }
+    for (e = 0; e < nelt; e++)
+    {
+        for (k = P->ptr [e]; k < P->ptr [e+1]; k++)
+        {
+            i = P->vars [k] ;
+            for (l = vptr [i]; l < vptr [i+1]; l++)
+            {
+                e2 = velt [l] ;
+                if ( color [e2] >= 0 ) mark [color [e2]] = e ;
+            }
+        }
+        for (c = 0; mark [c] == e; c++) ;
+        color [e] = c ;
+        P->ncolor = MAX (P->ncolor, c+1) ;
+    }
+
+    /* sort the elements by color, in their order within a color */
+    for (c = 0; c <= P->ncolor; c++) P->colptr [c] = 0 ;
+    for (e = 0; e < nelt; e++) P->colptr [color [e]+1]++ ;
+    for (c = 0; c < P->ncolor; c++) P->colptr [c+1] += P->colptr [c] ;
+    for (e = 0; e < nelt; e++) P->order [P->colptr [color [e]]++] = e ;
+    for (c = P->ncolor; c > 0; c--) P->colptr [c] = P->colptr [c-1] ;
+    P->colptr [0] = 0 ;
+
+    free (color) ;
+    free (vptr) ;
+    free (velt) ;
+    free (mark) ;
+    P->ready = TRUE ;
+    return (0) ;
+}
+
+/* =========================================================================
+   ==== cg_psep_value, cg_psep_grad, cg_psep_valgrad =======================
+   =========================================================================
+   The routines given to cg_descent by cg_psep_descent
+   ========================================================================= */
+PRIVATE double cg_psep_value
+(
+    double          *x,
+    INT              n
+)
+{
+    (void) n ;
+    return (cg_psep_eval (NULL, x, cg_psep_cur)) ;
+}
+
+PRIVATE void cg_psep_grad
+(
+    double          *g,
+    double          *x,
+    INT              n
+)
+{
+    (void) n ;
+    cg_psep_eval (g, x, cg_psep_cur) ;
+}
+
+PRIVATE double cg_psep_valgrad
+(
+    double          *g,
+    double          *x,
+    INT              n
+)
+{
+    (void) n ;
+    return (cg_psep_eval (g, x, cg_psep_cur)) ;
+}
@@ -0,0 +1,545 @@
+/* =========================================================================
+   ============================== CG_TEST ==================================
+   =========================================================================
+   Unconstrained test problems for cg_descent, see cg_test.h. Each problem
+   is coded once as name_fg (g, x, n) which returns the function value and,
+   when g is not NULL, stores the gradient in g. The value, grad, and
+   valgrad routines passed to cg_descent are generated from name_fg by
+   CG_TEST_WRAP. */
+
+#include <math.h>
+#include "cg_test.h"
+
+#define PRIVATE static
+
+#define CG_TEST_WRAP(name)                                                    \
+PRIVATE double name##_value (double *x, INT n)                                \
+{                                                                             \
+    return (name##_fg (NULL, x, n)) ;                                         \
+}                                                                             \
+PRIVATE void name##_grad (double *g, double *x, INT n)                        \
+{                                                                             \
+    name##_fg (g, x, n) ;                                                     \
+}                                                                             \
+PRIVATE double name##_valgrad (double *g, double *x, INT n)                   \
+{                                                                             \
+    return (name##_fg (g, x, n)) ;                                            \
+}
+
+/* =========================================================================
+   ==== extended Rosenbrock (MGH 21) =======================================
+   =========================================================================
+   f = sum 100 (x_2i - x_2i-1^2)^2 + (1 - x_2i-1)^2, n even
+   ========================================================================= */
+PRIVATE double rosenbrock_fg
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    double f, t1, t2 ;
+    f = 0. ;
+    for (i = 0; i < n; i += 2)
+    {
+        t1 = x [i+1] - x [i]*x [i] ;
+        t2 = 1. - x [i] ;
+        f += 100.*t1*t1 + t2*t2 ;
+        if ( g != NULL )
+        {
+            g [i] = -400.*x [i]*t1 - 2.*t2 ;
+            g [i+1] = 200.*t1 ;
+        }
+    }
+    return (f) ;
+}
+
+PRIVATE void rosenbrock_start
+(
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    for (i = 0; i < n; i += 2)
+    {
+        x [i] = -1.2 ;
+        x [i+1] = 1. ;
+    }
+}
+
+/* =========================================================================
+   ==== extended Powell singular (MGH 22) ==================================
+   =========================================================================
+   f = sum (x1 + 10 x2)^2 + 5 (x3 - x4)^2 + (x2 - 2 x3)^4 + 10 (x1 - x4)^4
+   over blocks of 4 variables, n multiple of 4, singular Hessian at the
+   solution
+   ========================================================================= */
+PRIVATE double powell_fg
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    double a, b, c, d, f ;
+    f = 0. ;
+    for (i = 0; i < n; i += 4)
+    {
+        a = x [i] + 10.*x [i+1] ;
+        b = x [i+2] - x [i+3] ;
+        c = x [i+1] - 2.*x [i+2] ;
+        d = x [i] - x [i+3] ;
+        f += a*a + 5.*b*b + c*c*c*c + 10.*d*d*d*d ;
+        if ( g != NULL )
+        {
+            g [i] = 2.*a + 40.*d*d*d ;
+            g [i+1] = 20.*a + 4.*c*c*c ;
+            g [i+2] = 10.*b - 8.*c*c*c ;
+            g [i+3] = -10.*b - 40.*d*d*d ;
+        }
+    }
+    return (f) ;
+}
+
+PRIVATE void powell_start
+(
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    for (i = 0; i < n; i += 4)
+    {
+        x [i] = 3. ;
+        x [i+1] = -1. ;
+        x [i+2] = 0. ;
+        x [i+3] = 1. ;
+    }
+}
+
+/* =========================================================================
+   ==== trigonometric (MGH 26) =============================================
+   =========================================================================
+   f = sum r_i^2, r_i = n - sum_j cos x_j + i (1 - cos x_i) - sin x_i
+   ========================================================================= */
+PRIVATE double trig_fg
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    double c, f, r, s, R ;
+    s = 0. ;
+    for (i = 0; i < n; i++) s += cos (x [i]) ;
+    f = R = 0. ;
+    for (i = 0; i < n; i++)
+    {
+        c = cos (x [i]) ;
+        r = n - s + (i+1)*(1. - c) - sin (x [i]) ;
+        f += r*r ;
+        R += r ;
+        if ( g != NULL ) g [i] = r ; /* save r_i */
+    }
+    if ( g != NULL )
+    {
+        for (i = 0; i < n; i++)
+        {
+            c = cos (x [i]) ;
+            s = sin (x [i]) ;
+            g [i] = 2.*(s*R + g [i]*((i+1)*s - c)) ;
+        }
+    }
+    return (f) ;
+}
+
+PRIVATE void trig_start
+(
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    for (i = 0; i < n; i++) x [i] = 1./n ;
+}
+
+/* =========================================================================
+   ==== Broyden tridiagonal (MGH 30) =======================================
+   =========================================================================
+   f = sum r_i^2, r_i = (3 - 2 x_i) x_i - x_i-1 - 2 x_i+1 + 1, x_0 = x_n+1 = 0
+   ========================================================================= */
+PRIVATE double broyden_fg
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    double f, r, rprev, xl, xr ;
+    f = 0. ;
+    rprev = 0. ;
+    for (i = 0; i < n; i++)
+    {
+        xl = (i > 0)   ? x [i-1] : 0. ;
+        xr = (i < n-1) ? x [i+1] : 0. ;
+        r = (3. - 2.*x [i])*x [i] - xl - 2.*xr + 1. ;
+        f += r*r ;
+        if ( g != NULL )
+        {
+            /* dr_i/dx_i-1 = -1 and dr_i-1/dx_i = -2 */
+            g [i] = 2.*r*(3. - 4.*x [i]) - 4.*rprev ;
+            if ( i > 0 ) g [i-1] -= 2.*r ;
+        }
+        rprev = r ;
+    }
+    return (f) ;
+}
+
+PRIVATE void broyden_start
+(
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    for (i = 0; i < n; i++) x [i] = -1. ;
+}
+
+/* =========================================================================
+   ==== penalty function I (MGH 23) ========================================
+   =========================================================================
+   f = 1e-5 sum (x_i - 1)^2 + (sum x_i^2 - 1/4)^2
+   ========================================================================= */
+PRIVATE double penalty_fg
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    double a, f, s, t ;
+    a = 1.e-5 ;
+    f = s = 0. ;
+    for (i = 0; i < n; i++)
+    {
+        t = x [i] - 1. ;
+        f += t*t ;
+        s += x [i]*x [i] ;
+    }
+    s -= .25 ;
+    if ( g != NULL )
+    {
+        for (i = 0; i < n; i++) g [i] = 2.*a*(x [i] - 1.) + 4.*s*x [i] ;
+    }
+    return (a*f + s*s) ;
+}
+
+PRIVATE void penalty_start
+(
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    for (i = 0; i < n; i++) x [i] = i + 1 ;
+}
+
+/* =========================================================================
+   ==== variably dimensioned (MGH 25) ======================================
+   =========================================================================
+   f = sum (x_i - 1)^2 + s^2 + s^4, s = sum i (x_i - 1)
+   ========================================================================= */
+PRIVATE double vardim_fg
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    double f, s, t ;
+    f = s = 0. ;
+    for (i = 0; i < n; i++)
+    {
+        t = x [i] - 1. ;
+        f += t*t ;
+        s += (i+1)*t ;
+    }
+    if ( g != NULL )
+    {
+        t = 2.*s + 4.*s*s*s ;
+        for (i = 0; i < n; i++) g [i] = 2.*(x [i] - 1.) + t*(i+1) ;
+    }
+    return (f + s*s + s*s*s*s) ;
+}
+
+PRIVATE void vardim_start
+(
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    for (i = 0; i < n; i++) x [i] = 1. - (double) (i+1)/n ;
+}
+
+/* =========================================================================
+   ==== discrete boundary value (MGH 28) ===================================
+   =========================================================================
+   f = sum r_i^2, r_i = 2 x_i - x_i-1 - x_i+1 + h^2 (x_i + t_i + 1)^3/2,
+   h = 1/(n+1), t_i = i h, x_0 = x_n+1 = 0. This is the finite difference
+   discretization of the boundary value problem u'' = (u + t + 1)^3/2,
+   u (0) = u (1) = 0.
+   ========================================================================= */
+PRIVATE double bdvalue_fg
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    double f, h, h2, r, rprev, u, xl, xr ;
+    h = 1./(n + 1) ;
+    h2 = h*h ;
+    f = rprev = 0. ;
+    for (i = 0; i < n; i++)
+    {
+        xl = (i > 0)   ? x [i-1] : 0. ;
+        xr = (i < n-1) ? x [i+1] : 0. ;
+        u = x [i] + (i+1)*h + 1. ;
+        r = 2.*x [i] - xl - xr + .5*h2*u*u*u ;
+        f += r*r ;
+        if ( g != NULL )
+        {
+            g [i] = 2.*r*(2. + 1.5*h2*u*u) - 2.*rprev ;
+            if ( i > 0 ) g [i-1] -= 2.*r ;
+        }
+        rprev = r ;
+    }
+    return (f) ;
+}
+
+PRIVATE void bdvalue_start
+(
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    double t ;
+    for (i = 0; i < n; i++)
+    {
+        t = (double) (i+1)/(n+1) ;
+        x [i] = t*(t - 1.) ;
+    }
+}
+
+/* =========================================================================
+   ==== nonlinear elliptic PDE =============================================
+   =========================================================================
+   Energy of -Laplacian u + u^3 = 1 on the unit square, u = 0 on the
+   boundary, discretized on an m by m interior grid (n = m^2) with the
+   5-point stencil:
+   f = sum over grid edges (u_p - u_q)^2/2 + h^2 sum (u_p^4/4 - u_p)
+   ========================================================================= */
+PRIVATE double pde_fg
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    INT i, j, k, m ;
+    double f, h2, t, u ;
+    m = (INT) (sqrt ((double) n) + .5) ;
+    h2 = 1./((m + 1)*(m + 1)) ;
+    f = 0. ;
+    if ( g != NULL ) for (k = 0; k < n; k++) g [k] = 0. ;
+    for (j = 0; j < m; j++)
+    {
+        for (i = 0; i < m; i++)
+        {
+            k = j*m + i ;
+            u = x [k] ;
+            f += h2*(.25*u*u*u*u - u) ;
+            /* edges to the right and above (t = u at the boundary), the
+               boundary edges to the left and below are added next */
+            t = (i < m-1) ? u - x [k+1] : u ;
+            f += .5*t*t ;
+            if ( g != NULL )
+            {
+                g [k] += t + h2*(u*u*u - 1.) ;
+                if ( i < m-1 ) g [k+1] -= t ;
+            }
+            t = (j < m-1) ? u - x [k+m] : u ;
+            f += .5*t*t ;
+            if ( g != NULL )
+            {
+                g [k] += t ;
+                if ( j < m-1 ) g [k+m] -= t ;
+            }
+            if ( i == 0 )
+            {
+                f += .5*u*u ;
+                if ( g != NULL ) g [k] += u ;
+            }
+            if ( j == 0 )
+            {
+                f += .5*u*u ;
+                if ( g != NULL ) g [k] += u ;
+            }
+        }
+    }
+    return (f) ;
+}
+
+PRIVATE void pde_start
+(
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    for (i = 0; i < n; i++) x [i] = 1. ;
+}
+
+/* =========================================================================
+   ==== TRIDIA (CUTEr) =====================================================
+   =========================================================================
+   f = (x_1 - 1)^2 + sum_{i>=2} i (2 x_i - x_i-1)^2, ill-conditioned quadratic
+   ========================================================================= */
+PRIVATE double tridia_fg
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    double e, f ;
+    e = x [0] - 1. ;
+    f = e*e ;
+    if ( g != NULL ) g [0] = 2.*e ;
+    for (i = 1; i < n; i++)
+    {
+        e = 2.*x [i] - x [i-1] ;
+        f += (i+1)*e*e ;
+        if ( g != NULL )
+        {
+            g [i] = 4.*(i+1)*e ;
+            g [i-1] -= 2.*(i+1)*e ;
+        }
+    }
+    return (f) ;
+}
+
+PRIVATE void tridia_start
+(
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    for (i = 0; i < n; i++) x [i] = 1. ;
+}
+
+/* =========================================================================
+   ==== exponential (driver1.c) ============================================
+   =========================================================================
+   f = sum exp (x_i) - sqrt (i) x_i, the example of the User's Guide
+   ========================================================================= */
+PRIVATE double expsqrt_fg
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    double f, t ;
+    f = 0. ;
+    for (i = 0; i < n; i++)
+    {
+        t = exp (x [i]) ;
+        f += t - sqrt (i+1.)*x [i] ;
+        if ( g != NULL ) g [i] = t - sqrt (i+1.) ;
+    }
+    return (f) ;
+}
+
+PRIVATE void expsqrt_start
+(
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    for (i = 0; i < n; i++) x [i] = 1. ;
+}
+
+CG_TEST_WRAP (rosenbrock)
+CG_TEST_WRAP (powell)
+CG_TEST_WRAP (trig)
+CG_TEST_WRAP (broyden)
+CG_TEST_WRAP (penalty)
+CG_TEST_WRAP (vardim)
+CG_TEST_WRAP (bdvalue)
+CG_TEST_WRAP (pde)
+CG_TEST_WRAP (tridia)
+CG_TEST_WRAP (expsqrt)
+
+cg_problem cg_problems [] =
+{
+    {"rosenbrock", 2, FALSE, rosenbrock_start, rosenbrock_value,
+                              rosenbrock_grad, rosenbrock_valgrad},
+    {"powell",     4, FALSE, powell_start, powell_value, powell_grad,
+                              powell_valgrad},
+    {"trig",       1, FALSE, trig_start, trig_value, trig_grad, trig_valgrad},
+    {"broyden",    1, FALSE, broyden_start, broyden_value, broyden_grad,
+                              broyden_valgrad},
+    {"penalty",    1, FALSE, penalty_start, penalty_value, penalty_grad,
+                              penalty_valgrad},
+    {"vardim",     1, FALSE, vardim_start, vardim_value, vardim_grad,
+                              vardim_valgrad},
+    {"bdvalue",    1, FALSE, bdvalue_start, bdvalue_value, bdvalue_grad,
+                              bdvalue_valgrad},
+    {"pde",        1, TRUE,  pde_start, pde_value, pde_grad, pde_valgrad},
+    {"tridia",     1, FALSE, tridia_start, tridia_value, tridia_grad,
+                              tridia_valgrad},
+    {"expsqrt",    1, FALSE, expsqrt_start, expsqrt_value, expsqrt_grad,
+                              expsqrt_valgrad},
+    {NULL,         0, FALSE, NULL, NULL, NULL, NULL}
+} ;
+
+/* =========================================================================
+   ==== cg_test_dim ========================================================
+   =========================================================================
+   Return the largest valid dimension <= n for problem P (at least the
+   smallest valid dimension)
+   ========================================================================= */
+INT cg_test_dim
+(
+    cg_problem  *P, /* test problem */
+    INT          n  /* requested dimension */
+)
+{
+    INT m ;
+    if ( P->square )
+    {
+        m = (INT) sqrt ((double) n) ;
+        while ( (m+1)*(m+1) <= n ) m++ ;
+        while ( m*m > n ) m-- ;
+        if ( m < 1 ) m = 1 ;
+        n = m*m ;
+    }
+    n -= n % P->nmul ;
+    if ( n < P->nmul ) n = P->nmul ;
+    return (n) ;
+}
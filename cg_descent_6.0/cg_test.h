@@ -0,0 +1,29 @@
+/* =========================================================================
+   ============================== CG_TEST ==================================
+   =========================================================================
+   Library of classic unconstrained test problems with scalable dimension
+   (More, Garbow, and Hillstrom, ACM TOMS 7 (1981), and the CUTEr set).
+   Each problem provides value, grad, and a fused valgrad routine in the
+   form expected by cg_descent, and a routine giving the starting guess.
+   cg_problems is terminated by an entry with name = NULL. */
+
+#include "cg_user.h"
+
+typedef struct cg_problem_struct /* test problem */
+{
+    char               *name ; /* name of the problem */
+    int                 nmul ; /* the dimension is a multiple of nmul */
+    int               square ; /* T => the dimension is a perfect square */
+    void (*start) (double *, INT) ;           /* start (x, n) */
+    double (*value) (double *, INT) ;         /* f = value (x, n) */
+    void (*grad) (double *, double *, INT) ;  /* grad (g, x, n) */
+    double (*valgrad) (double *, double *, INT) ; /* f = valgrad (g, x, n) */
+} cg_problem ;
+
+extern cg_problem cg_problems [] ;
+
+INT cg_test_dim /* return the largest valid dimension <= n for problem P */
+(
+    cg_problem  *P, /* test problem */
+    INT          n  /* requested dimension */
+) ;
@@ -43,9 +43,39 @@ typedef struct cg_parameter_struct /* user controlled parameters */
        F => only use L-BFGS when memory >= n */
     int LBFGS ;
 
+    /* T => the L-BFGS direction uses the compact representation of Byrd,
+            Nocedal, and Schnabel: two blocked passes over the memory per
+            iteration in place of the four passes of the two-loop
+            recursion, the same direction up to rounding. Not used with
+            a preconditioner
+       F => two-loop recursion */
+    int LBFGSCompact ;
+
     /* number of vectors stored in memory */
     int memory ;
 
+    /* T => the number of vectors used from the memory is adapted during
+            the solve, starting from memory and staying between 3 and
+            MemoryMax. At the end of each window of MAX (10, 2*mem)
+            iterations, the decrease of log |g| per second is compared
+            with that of the previous window; the memory keeps growing or
+            shrinking while the rate improves and turns around when it
+            gets worse. The memory is not increased while the time of the
+            memory linear algebra exceeds AdaptCost times the time of the
+            user's routines. Limited memory CG applies a new size when its
+            memory restarts in the full space. Turns on the timing.
+       F => the memory is fixed */
+    int AdaptMemory ;
+    int MemoryMax ;
+    double AdaptCost ;
+
+    /* T => the rate of a memory size is the decrease of log |g| per
+            weighted evaluation (ValueCost*nfunc + GradCost*ngrad) and the
+            AdaptCost test is skipped, so the memory sizes and the
+            iterations do not depend on the timing
+       F => the rate is per second */
+    int AdaptEvals ;
+
     /* SubCheck and SubSkip control the frequency with which the subspace
        condition is checked. It is checked for SubCheck*mem iterations and
        if not satisfied, then it is skipped for Subskip*mem iterations
@@ -159,6 +189,165 @@ typedef struct cg_parameter_struct /* user controlled parameters */
     /* after encountering nan, decay factor for stepsize */
     double nan_decay ;
 
+    /* optional Hessian times vector routine, hessvec (Hd, d, x, n) sets
+       Hd = H(x)*d where H is the Hessian of the cost at x.  If not NULL, the
+       curvature d'Hd gives the exact quadratic step along the search
+       direction (replacing the QuadStep probe), it is used to test whether
+       the cost is quadratic, and it gives the L-BFGS and subspace scaling */
+    void (*hessvec) (double *, double *, double *, INT) ;
+
+    /* optional sparse gradient routine, nnz = sparsegrad (g, ind, x, n).
+       On input g is zero; the routine stores the entries of the gradient
+       at x that can be nonzero, puts their indices in ind [0], ...,
+       ind [nnz-1] (no repeats, any order), and returns nnz. If not NULL
+       and memory = 0 (no preconditioner, no hessvec, not Newton),
+       cg_descent runs in the sparse mode: the gradient only comes from
+       sparsegrad (grad and valgrad are not used, f comes from value),
+       and the vector operations of an iteration only run over the
+       nonzeros of g and the support of d, so their cost does not grow
+       with n. The support of d is the union of the supports of g since
+       the last restart. */
+    INT (*sparsegrad) (double *, INT *, double *, INT) ;
+
+    /* finite difference gradient, used when grad and valgrad are both NULL
+       (and there is no sparse mode). FDCentral = T => central differences
+       (error O(h^2), two evaluations per variable), F => forward
+       differences (error O(h), one evaluation per variable and one at x).
+       The step of x_j is h_j = FDStep*max (|x_j|, 1); FDStep = 0 => the
+       square root of the machine epsilon for forward and its cube root
+       for central differences. FDThreads is the number of threads that
+       evaluate the perturbed points when compiled with OpenMP, 0 => the
+       OpenMP default (without OpenMP, one thread is used); with more than
+       one thread, value (or FDElements) must be thread safe. */
+    int FDCentral ;
+    double FDStep ;
+    int FDThreads ;
+
+    /* optional sparsity of the finite differences, f = sum_e F_e (x) where
+       FDElements (F, x, n) stores the FDnelt element values in F and the
+       variables of element e are FDidx [FDptr [e]], ...,
+       FDidx [FDptr [e+1]-1]. Variables that share no element are
+       perturbed together, so a gradient costs one evaluation of the
+       elements per group instead of one value per variable. */
+    void (*FDElements) (double *, double *, INT) ;
+    INT FDnelt ;
+    INT *FDptr ;
+    INT *FDidx ;
+
+    /* T => truncated Newton mode (requires hessvec, memory is ignored).
+       The search direction approximately solves H d = -g by linear CG on
+       Hessian-vector products starting from d = 0, the line search starts
+       from the Newton step alpha = 1. The inner iteration stops when
+       ||H d + g|| <= eta ||g|| (2-norms) with eta = min (NewtonEta,
+       sqrt (||g||)), after NewtonMaxit iterations, or at a direction of
+       nonpositive curvature (d = -g if this is the first direction) */
+    int Newton ;
+    double NewtonEta ;
+    INT NewtonMaxit ;
+
+    /* the last line search trials are always recorded. When cg_descent
+       fails with status 3 through 8, they are written as one JSON line
+       appended to the file FlightFile. NULL => print the JSON line with
+       the final statistics (PrintFinal or PrintLevel >= 1) */
+    char *FlightFile ;
+
+    /* relative cost of a function value and of a gradient, used for the
+       weighted cost in cg_stats (a valgrad call counts as one of each) */
+    double ValueCost ;
+    double GradCost ;
+
+    /* GradCost >= FuncLineFac*ValueCost => the line search uses function
+       values only (Armijo backtracking with quadratic fit) and evaluates
+       the gradient once at the accepted step */
+    double FuncLineFac ;
+
+    /* T => the initial stepsize is predicted from the accepted steps of the
+       previous iterations: alpha = alpha_old*(dphi0_old/dphi0)*r where the
+       log of the correction r is a running average learned during the solve.
+       Once the standard deviation of log (r) is <= PredictTol, the predicted
+       step replaces the QuadStep probe whenever the measured cost (ValueCost
+       and GradCost) of the iterations started from the prediction is lower.
+       PredictRate is the smallest weight of a new value in the averages. */
+    int    PredictStep ;
+    double PredictTol ;
+    double PredictRate ;
+
+    /* optional routine called at the end of each iteration as
+       monitor (MonitorData, iter, f, gnorm, alpha, dphi0) where alpha is the
+       last stepsize and dphi0 is the derivative along the new search
+       direction. A nonzero return value stops cg_descent with status 13 */
+    int (*monitor) (void *, INT, double, double, double, double) ;
+    void *MonitorData ;
+
+    /* cg_multistart abandons a start after AbandonIter iterations when
+       f + AbandonFac*alpha*dphi0 > fbest + AbandonTol*|fbest| where
+       alpha*dphi0 (< 0) estimates the decrease in the next iteration and
+       fbest is the best function value found by all the starts.
+       AbandonIter < 0 => never abandon a start. If abandon is not NULL, it
+       replaces this rule: abandon (fbest, iter, f, gnorm, alpha, dphi0)
+       nonzero => abandon the start */
+    INT    AbandonIter ;
+    double AbandonFac ;
+    double AbandonTol ;
+    int (*abandon) (double, INT, double, double, double, double) ;
+
+    /* if not NULL, a binary trace is written to the file TraceFile: one
+       cg_trace record for each iteration and for each line search trial.
+       The records are queued in a ring buffer and written by a background
+       thread (when compiled with CG_TRACE_THREAD). cg_trace_json converts
+       the trace to JSON lines */
+    char *TraceFile ;
+
+    /* if RecordFile is not NULL, each call of value, grad, and valgrad is
+       written to RecordFile: a digest of x, f, and g. If ReplayFile is not
+       NULL, the values are read from a file written by RecordFile instead of
+       calling the user's routines, as long as the evaluation points match
+       the recording. At the first difference, the divergence is reported
+       (Stats->replay_diverge) and the user's routines are used from then on.
+       The two can be combined to record a replayed run */
+    char *RecordFile ;
+    char *ReplayFile ;
+
+    /* preconditioner P, symmetric positive definite, approximating the
+       inverse Hessian: the search directions use P*g in place of g (the
+       CG beta and the L-BFGS initial matrix scale*P). Limited memory CG
+       only does its full space iterations, since the subspace tests
+       measure g in the Euclidean norm. If precond is not NULL,
+       precond (Pg, g, n, PrecondData) stores P*g in Pg; otherwise if
+       PrecondDiag is not NULL, P = diag (PrecondDiag). P must not change
+       during a call of cg_descent */
+    void (*precond) (double *, double *, INT, void *) ;
+    void *PrecondData ;
+    double *PrecondDiag ;
+
+    /* T => automatic diagonal scaling when neither precond nor PrecondDiag
+       is given. P = inv (B) where the diagonal B estimates the Hessian: it
+       starts from y'y/s'y times I and is updated with the diagonal of the
+       BFGS update after each step with s'y > 0. Each element changes by at
+       most a factor of 100 per update. P replaces the scalar L-BFGS scale
+       and the identity in the CG direction. When the steps show that the
+       Hessian is far from diagonal (on average sum |s_i y_i| > 2 s'y),
+       P = I is used for the rest of the run */
+    int AutoDiag ;
+
+    /* T => measure the time (monotonic clock) spent in the user routines,
+       the vector kernels, the line search, and the subspace and L-BFGS
+       linear algebra, returned in Stats->time */
+    int Timing ;
+
+    /* T => also count CPU cycles, instructions, and last level cache misses
+       in each part of cg_descent with the Linux perf_event_open hardware
+       counters, returned in Stats->cycles, instr, and misses. Counters
+       that are not permitted or not available are skipped (Timing is still
+       done) */
+    int Counters ;
+
+    /* T => count the bytes moved and the flops of the vector kernels for
+       each type of iteration and print a roofline summary with the final
+       statistics, comparing the rate with the bandwidth of cg_daxpy on
+       vectors of length n; returned in Stats->roof (implies Timing) */
+    int Roofline ;
+
 /*============================================================================
        technical parameters which the user probably should not touch
   ----------------------------------------------------------------------------*/
@@ -186,6 +375,47 @@ typedef struct cg_parameter_struct /* user controlled parameters */
                                 nearly quadratic before a restart */
 } cg_parameter ;
 
+typedef struct cg_timing_struct /* seconds spent in each part of cg_descent,
+                                   zero unless Parm->Timing is T */
+{
+    double         total ; /* total time in cg_descent */
+    double         value ; /* time in value */
+    double          grad ; /* time in grad */
+    double       valgrad ; /* time in valgrad */
+    double       hessvec ; /* time in hessvec */
+    double        kernel ; /* vector operations (steps, dot products, and
+                              direction updates) and remaining bookkeeping */
+    double          line ; /* line search logic (cg_line, cg_contract,
+                              cg_lineF) without the evaluations */
+    double           sub ; /* subspace and L-BFGS linear algebra */
+} cg_timing ;
+
+/* iteration types of the roofline summary, Parm->Roofline */
+#define CG_RSETUP 0 /* work before the first and after the last iteration */
+#define CG_RCG    1 /* memory = 0, the original CG_DESCENT */
+#define CG_RFULL  2 /* limited memory CG, full space iteration */
+#define CG_RSUB   3 /* limited memory CG, subspace iteration */
+#define CG_RLBFGS 4 /* L-BFGS */
+#define CG_RNEWTON 5 /* truncated Newton */
+#define CG_NROOF  6
+
+typedef struct cg_roofline_struct /* work of the vector kernels by iteration
+                                     type, zero unless Parm->Roofline is T */
+{
+    INT    iter [CG_NROOF] ; /* number of iterations of each type */
+    double bytes [CG_NROOF] ; /* bytes read and written by the kernels, each
+                                 vector counted once per pass */
+    double flops [CG_NROOF] ; /* floating point operations of the kernels */
+    double  time [CG_NROOF] ; /* time outside the user routines */
+    double        bandwidth ; /* bytes/sec of cg_daxpy on vectors of length n */
+} cg_roofline ;
+
+/* number of origins of an evaluation: 0 start of the line search,
+   1 expansion, 2 secant, 3 cubic, 4 bisection, 5 cg_contract, 6 first trial
+   after eps was increased, 7 Armijo trial of cg_lineF, 8 starting point,
+   9 quadratic step, 10 retry after a nan or inf */
+#define CG_NORIGIN 11
+
 typedef struct cg_stats_struct /* statistics returned to user */
 {
     double               f ; /*function value at solution */
@@ -195,8 +425,73 @@ typedef struct cg_stats_struct /* statistics returned to user */
     INT             NumSub ; /* total number subspaces */
     INT              nfunc ; /* number of function evaluations */
     INT              ngrad ; /* number of gradient evaluations */
+    INT              nhess ; /* number of Hessian-vector products */
+    INT          IterInner ; /* inner CG iterations of the truncated Newton
+                                mode, the outer iterations are iter */
+    int             memory ; /* memory in use at the end, set by the
+                                adaptation when Parm->AdaptMemory is T */
+    INT            nfdeval ; /* value or FDElements calls of the finite
+                                differences (grad and valgrad are NULL) */
+    INT           nfdgroup ; /* groups of variables perturbed together */
+    INT            nreplay ; /* evaluations taken from Parm->ReplayFile */
+    INT     replay_diverge ; /* call of value, grad, or valgrad where the
+                                replay diverged (counting from 1),
+                                0 => replay did not diverge, -1 => no replay
+                                or the file could not be used */
+    INT nfunc_origin [CG_NORIGIN] ; /* function evaluations by origin */
+    INT ngrad_origin [CG_NORIGIN] ; /* gradient evaluations by origin */
+    double            cost ; /* ValueCost*nfunc + GradCost*ngrad */
+    INT             nfirst ; /* number of iterations where the first
+                                line search trial was accepted */
+    cg_timing         time ; /* time breakdown when Parm->Timing is T */
+    int           ncounter ; /* number of hardware counters opened when
+                                Parm->Counters is T, 0 => none available */
+    cg_timing       cycles ; /* CPU cycles in each part of cg_descent */
+    cg_timing        instr ; /* instructions in each part */
+    cg_timing       misses ; /* last level cache misses in each part, the
+                                memory traffic is about 64 bytes per miss.
+                                A counter that was not opened is -1 in
+                                every part */
+    cg_roofline       roof ; /* kernel work when Parm->Roofline is T */
 } cg_stats ;
 
+/* the trace file starts with the 8 characters CGTRACE1 and an int giving
+   sizeof (cg_trace), followed by the records */
+#define CG_TRACE_ITER  1 /* record written at the end of an iteration */
+#define CG_TRACE_TRIAL 2 /* record written for a line search trial */
+
+typedef struct cg_trace_struct /* record in the trace file */
+{
+    int           type ; /* CG_TRACE_ITER or CG_TRACE_TRIAL */
+    int          phase ; /* trial: line search phase (0 = start, 1 = expand,
+                            2 = secant, 3 = cubic, 4 = bisection,
+                            5 = contract, 6 = eps, 7 = armijo)
+                            iteration: T (iteration was in the subspace) */
+    int           what ; /* trial: 1 = f, 2 = df, 3 = f and df evaluated
+                            iteration: number of vectors in memory */
+    int         AWolfe ; /* T (approximate Wolfe line search) */
+    INT           iter ; /* cg iteration */
+    INT             nf ; /* number of function evaluations so far */
+    INT             ng ; /* number of gradient evaluations so far */
+    double       alpha ; /* trial: trial stepsize, iteration: accepted step */
+    double           f ; /* function value */
+    double          df ; /* trial: derivative at alpha
+                            iteration: derivative along new search direction*/
+    double       gnorm ; /* iteration: gradient sup-norm */
+    double           a ; /* trial: left side of bracketing interval */
+    double           b ; /* trial: right side of bracketing interval */
+    double         eps ; /* trial: current value of eps */
+} cg_trace ;
+
+/* element function of a partially separable objective (cg_psep.c): return
+   the value of the element at xe [0], ..., xe [ne-1], the values of its
+   variables, and when ge is not NULL, store its gradient in ge [0], ...,
+   ge [ne-1]. Data is the pointer given to cg_psep_add. */
+typedef double (*cg_element) (double *ge, double *xe, int ne, void *Data) ;
+
+/* partially separable objective, the elements are added by cg_psep_add */
+typedef struct cg_psep_struct cg_psep ;
+
 /* prototypes */
 
 int cg_descent /*  return:
@@ -231,3 +526,99 @@ void cg_default /* set default parameter values */
 (
     cg_parameter   *Parm
 ) ;
+
+int cg_multistart /* return index of the best start: the smallest f among
+                     the starts with status 0 or 1, if there are none, the
+                     smallest f among all the starts, -1 => no f evaluated */
+(
+    double            *x, /* input: start k is x+k*n, k = 0, ..., nstart-1
+                             output: x+k*n is the final iterate of start k */
+    INT                n, /* problem dimension */
+    int           nstart, /* number of starting guesses */
+    int          *status, /* status of each start (13 = abandoned), can be
+                             NULL */
+    cg_stats      *Stats, /* statistics of each start, can be NULL */
+    cg_parameter  *UParm, /* user parameters, NULL = use default parameters */
+    double      grad_tol, /* convergence tolerance, see cg_descent */
+    double        (*value) (double *, INT),  /* f = value (x, n) */
+    void           (*grad) (double *, double *, INT), /* grad (g, x, n) */
+    double      (*valgrad) (double *, double *, INT)  /* f = valgrad (g,x,n)*/
+) ;
+
+int cg_portfolio /* return index of the winning configuration,
+                    -1 => no configuration converged */
+(
+    double            *x, /* input: starting guess, output: final iterate of
+                             the winner, or if there is no winner, of the
+                             configuration with the smallest f */
+    INT                n, /* problem dimension */
+    int          nconfig, /* number of configurations */
+    cg_parameter  *Parms, /* array of nconfig configurations, NULL => three
+                             default configurations with memory = 0,
+                             memory = 11, and memory = 11 with LBFGS */
+    int          *status, /* status of each configuration (13 = cancelled),
+                             can be NULL */
+    cg_stats      *Stats, /* statistics of each configuration, can be NULL */
+    double      grad_tol, /* convergence tolerance, see cg_descent */
+    double        (*value) (double *, INT),  /* f = value (x, n) */
+    void           (*grad) (double *, double *, INT), /* grad (g, x, n) */
+    double      (*valgrad) (double *, double *, INT), /* f = valgrad (g,x,n)*/
+    char        *LogFile  /* file where the result is appended, NULL = none */
+) ;
+
+cg_psep *cg_psep_new /* return an objective without elements,
+                        NULL => out of memory */
+(
+    INT                n  /* number of variables */
+) ;
+
+INT cg_psep_add /* return the number of the element (0, 1, ...),
+                   -1 => out of memory or an index outside [0, n) */
+(
+    cg_psep           *P, /* objective */
+    cg_element      func, /* element function */
+    void           *Data, /* passed to func, can be NULL */
+    int               ne, /* number of variables of the element */
+    INT            *vars  /* indices of the variables */
+) ;
+
+int cg_psep_descent /* return the status of cg_descent, 10 => out of
+                       memory */
+(
+    double            *x, /* input: starting guess, output: the solution */
+    cg_stats      *Stats, /* structure with statistics, can be NULL */
+    cg_parameter  *UParm, /* user parameters, NULL = use default parameters */
+    double      grad_tol, /* convergence tolerance, see cg_descent */
+    cg_psep           *P  /* objective */
+) ;
+
+double cg_psep_eval /* return f (x), nan => out of memory */
+(
+    double            *g, /* output: gradient, NULL => only f */
+    double            *x, /* evaluation point */
+    cg_psep           *P  /* objective */
+) ;
+
+void cg_psep_info
+(
+    cg_psep           *P, /* objective */
+    int          *ncolor, /* output: number of colors, can be NULL */
+    INT           *neval, /* output: element evaluations, can be NULL */
+    INT          *nreuse  /* output: element results reused, can be NULL */
+) ;
+
+void cg_psep_free
+(
+    cg_psep           *P  /* objective */
+) ;
+
+int cg_trace_json /* convert a trace file to JSON lines, return:
+                      0 (success)
+                      1 (trace file could not be opened)
+                      2 (not a trace file or written with another INT)
+                      3 (JSON file could not be opened)
+                      4 (truncated record or unknown type or phase) */
+(
+    char  *TraceFile, /* trace written by cg_descent (Parm->TraceFile) */
+    char   *JsonFile  /* output, one JSON object per line, NULL = stdout */
+) ;
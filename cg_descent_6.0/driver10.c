@@ -0,0 +1,258 @@
+/* Partially separable objective (cg_psep.c). The variables are the values
+   x_ij at the nodes of a p by p grid and the objective is the sum of one
+   element per grid edge and one element per node,
+
+       f = sum_edges (sqrt (1 + (x_a - x_b)^2) - 1)
+         + sum_nodes log (cosh (x_a)),
+
+   whose minimizer is x = 0. The elements are registered with cg_psep_add
+   and cg_psep_descent assembles f and g from them, in parallel when
+   compiled with OpenMP. The same problem is also solved with a hand
+   written valgrad. Two starts are used: random values at all the nodes,
+   and x = 0 except for a 5 by 5 patch where x = 1, as after a local change
+   of a solved problem. From the second start, g and d are zero away from
+   the patch until the change spreads over the grid, so most elements are
+   not evaluated again. With p = 300 and one thread:
+
+   start     objective  iter nfunc ngrad  elt evals   reused     time
+   random    valgrad      30    59    33          -        -    0.27
+   random    psep         30    59    33   16433400        0    0.48
+   patch     valgrad      28    55    31          -        -    0.11
+   patch     psep         28    55    31     319884 15035916    0.21
+
+   The iterations and evaluations of the two objectives agree, and they
+   do not depend on the number of threads. These elements cost a few
+   flops, so the gathers and scatters of cg_psep make it slower than the
+   hand written loop on one thread; its gains come from the threads, from
+   expensive elements, and from the reused elements after a local change. */
+
+#include <math.h>
+#include "cg_user.h"
+
+#define P 300
+
+double myvalue
+(
+    double   *x,
+    INT       n
+) ;
+
+void mygrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+) ;
+
+double myvalgrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+) ;
+
+double edge
+(
+    double   *ge,
+    double   *xe,
+    int       ne,
+    void   *Data
+) ;
+
+double node
+(
+    double   *ge,
+    double   *xe,
+    int       ne,
+    void   *Data
+) ;
+
+int main (void)
+{
+    int s, k ;
+    INT i, j, n, v [2], neval, nreuse, neval0, nreuse0 ;
+    double *x ;
+    cg_parameter Parm ;
+    cg_stats Stats ;
+    cg_psep *Obj ;
+    char *start [2] = {"random", "patch"} ;
+
+    n = P*P ;
+    x = (double *) malloc (n*sizeof (double)) ;
+
+    /* the elements in the order of myvalgrad: node, right edge, upper edge */
+    Obj = cg_psep_new (n) ;
+    for (i = 0; i < P; i++)
+    {
+        for (j = 0; j < P; j++)
+        {
+            v [0] = i*P + j ;
+            cg_psep_add (Obj, node, NULL, 1, v) ;
+            if ( j < P-1 )
+            {
+                v [1] = v [0] + 1 ;
+                cg_psep_add (Obj, edge, NULL, 2, v) ;
+            }
+            if ( i < P-1 )
+            {
+                v [1] = v [0] + P ;
+                cg_psep_add (Obj, edge, NULL, 2, v) ;
+            }
+        }
+    }
+
+    cg_default (&Parm) ;
+    Parm.PrintFinal = FALSE ;
+    Parm.Timing = TRUE ;
+    printf ("start     objective  iter nfunc ngrad  elt evals   reused"
+            "     time\n") ;
+    for (s = 0; s < 2; s++)
+    {
+        for (k = 0; k < 2; k++)
+        {
+            srand (1) ;
+            for (i = 0; i < n; i++)
+            {
+                if ( s == 0 ) x [i] = 2.*rand ()/RAND_MAX - 1. ;
+                else x [i] = ((i/P < 5) && (i%P < 5)) ? 1. : 0. ;
+            }
+            if ( k == 0 )
+            {
+                cg_descent (x, n, &Stats, &Parm, 1.e-8, myvalue, mygrad,
+                            myvalgrad, NULL) ;
+                printf ("%-9s valgrad  %5ld %5ld %5ld          -        - "
+                        "%7.2f\n", start [s], (long) Stats.iter,
+                        (long) Stats.nfunc, (long) Stats.ngrad,
+                        Stats.time.total) ;
+            }
+            else
+            {
+                cg_psep_info (Obj, NULL, &neval0, &nreuse0) ;
+                cg_psep_descent (x, &Stats, &Parm, 1.e-8, Obj) ;
+                cg_psep_info (Obj, NULL, &neval, &nreuse) ;
+                printf ("%-9s psep     %5ld %5ld %5ld %10ld %8ld %7.2f\n",
+                        start [s], (long) Stats.iter, (long) Stats.nfunc,
+                        (long) Stats.ngrad, (long) (neval - neval0),
+                        (long) (nreuse - nreuse0), Stats.time.total) ;
+            }
+        }
+    }
+    cg_psep_free (Obj) ;
+    free (x) ;
+    return (0) ;
+}
+
+double edge
+(
+    double   *ge,
+    double   *xe,
+    int       ne,
+    void   *Data
+)
+{
+    double t, r ;
+    (void) ne ;
+    (void) Data ;
+    t = xe [0] - xe [1] ;
+    r = sqrt (1. + t*t) ;
+    if ( ge != NULL )
+    {
+        ge [0] = t/r ;
+        ge [1] = -t/r ;
+    }
+    return (r - 1.) ;
+}
+
+double node
+(
+    double   *ge,
+    double   *xe,
+    int       ne,
+    void   *Data
+)
+{
+    (void) ne ;
+    (void) Data ;
+    if ( ge != NULL ) ge [0] = tanh (xe [0]) ;
+    return (log (cosh (xe [0]))) ;
+}
+
+double myvalue
+(
+    double   *x,
+    INT       n
+)
+{
+    double f, t ;
+    INT i, j, a ;
+    (void) n ;
+    f = 0. ;
+    for (i = 0; i < P; i++)
+    {
+        for (j = 0; j < P; j++)
+        {
+            a = i*P + j ;
+            f += log (cosh (x [a])) ;
+            if ( j < P-1 )
+            {
+                t = x [a] - x [a+1] ;
+                f += sqrt (1. + t*t) - 1. ;
+            }
+            if ( i < P-1 )
+            {
+                t = x [a] - x [a+P] ;
+                f += sqrt (1. + t*t) - 1. ;
+            }
+        }
+    }
+    return (f) ;
+}
+
+void mygrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    myvalgrad (g, x, n) ;
+}
+
+double myvalgrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    double f, r, t ;
+    INT i, j, a ;
+    f = 0. ;
+    for (a = 0; a < n; a++) g [a] = 0. ;
+    for (i = 0; i < P; i++)
+    {
+        for (j = 0; j < P; j++)
+        {
+            a = i*P + j ;
+            f += log (cosh (x [a])) ;
+            g [a] += tanh (x [a]) ;
+            if ( j < P-1 )
+            {
+                t = x [a] - x [a+1] ;
+                r = sqrt (1. + t*t) ;
+                f += r - 1. ;
+                g [a] += t/r ;
+                g [a+1] -= t/r ;
+            }
+            if ( i < P-1 )
+            {
+                t = x [a] - x [a+P] ;
+                r = sqrt (1. + t*t) ;
+                f += r - 1. ;
+                g [a] += t/r ;
+                g [a+P] -= t/r ;
+            }
+        }
+    }
+    return (f) ;
+}
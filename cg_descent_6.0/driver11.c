@@ -0,0 +1,152 @@
+/* Sparse mode. When most entries of the gradient are zero, as in models
+   whose terms only involve the few variables that moved away from zero,
+   the routine Parm.sparsegrad returns the nonzeros of g with their
+   indices, and the vector operations of cg_descent (memory = 0) only run
+   over the nonzeros of g and the support of d. The test problem is a
+   chain of n = 1e6 variables pulled toward 10 spikes c_k = 1,
+
+       f = sum log (cosh (x_i - c_i)) + .25 sum (x_i+1 - x_i)^2,
+
+   starting from x = 0. The gradient is nonzero near the spikes only, and
+   the support grows by one neighbor per iteration until it converges.
+   Below, the problem is solved with the dense grad, then in the sparse
+   mode. The routines of the user still take O(n) time to find the
+   nonzeros; "engine" is the time outside them (Stats.time.total minus
+   the time in value and grad), which no longer grows with n:
+
+   mode     iter nfunc ngrad         f        total   engine
+   dense      15    28    19  2.085e+00        0.610    0.173
+   sparse     15    28    19  2.085e+00        0.354    0.016
+
+   The two modes take the same steps, only the engine time changes. */
+
+#include <math.h>
+#include "cg_user.h"
+
+#define N 1000000
+#define NSPIKE 10
+
+double myvalue
+(
+    double   *x,
+    INT       n
+) ;
+
+void mygrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+) ;
+
+INT mysparsegrad
+(
+    double    *g,
+    INT     *ind,
+    double    *x,
+    INT        n
+) ;
+
+int main (void)
+{
+    int k ;
+    double *x, user ;
+    INT i ;
+    cg_parameter Parm ;
+    cg_stats Stats ;
+    char *mode [2] = {"dense", "sparse"} ;
+
+    x = (double *) malloc (N*sizeof (double)) ;
+    cg_default (&Parm) ;
+    Parm.PrintFinal = FALSE ;
+    Parm.Timing = TRUE ;
+    Parm.memory = 0 ;
+    printf ("mode     iter nfunc ngrad         f        total   engine\n") ;
+    for (k = 0; k < 2; k++)
+    {
+        for (i = 0; i < N; i++) x [i] = 0. ;
+        Parm.sparsegrad = (k == 0) ? NULL : mysparsegrad ;
+        cg_descent (x, N, &Stats, &Parm, 1.e-8, myvalue, mygrad, NULL, NULL);
+        user = Stats.time.value + Stats.time.grad + Stats.time.valgrad ;
+        printf ("%-7s %5ld %5ld %5ld %10.3e %12.3f %8.3f\n", mode [k],
+                (long) Stats.iter, (long) Stats.nfunc, (long) Stats.ngrad,
+                Stats.f, Stats.time.total, Stats.time.total - user) ;
+    }
+    free (x) ;
+    return (0) ;
+}
+
+/* c_i = 1 at the spikes, 0 elsewhere */
+double spike
+(
+    INT       i
+)
+{
+    return ((i % (N/NSPIKE) == N/(2*NSPIKE)) ? 1. : 0.) ;
+}
+
+double myvalue
+(
+    double   *x,
+    INT       n
+)
+{
+    double f, t ;
+    INT i ;
+    f = 0. ;
+    for (i = 0; i < n; i++)
+    {
+        f += log (cosh (x [i] - spike (i))) ;
+        if ( i < n-1 )
+        {
+            t = x [i+1] - x [i] ;
+            f += .25*t*t ;
+        }
+    }
+    return (f) ;
+}
+
+void mygrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    for (i = 0; i < n; i++)
+    {
+        g [i] = tanh (x [i] - spike (i)) ;
+        if ( i > 0 )   g [i] += .5*(x [i] - x [i-1]) ;
+        if ( i < n-1 ) g [i] += .5*(x [i] - x [i+1]) ;
+    }
+}
+
+/* the nonzeros of the gradient of mygrad */
+INT mysparsegrad
+(
+    double    *g,
+    INT     *ind,
+    double    *x,
+    INT        n
+)
+{
+    INT i, nnz ;
+    double t ;
+    nnz = 0 ;
+    for (i = 0; i < n; i++)
+    {
+        /* g [i] can only be nonzero next to a nonzero x or at a spike */
+        if ( (x [i] == 0.) && ((i == 0) || (x [i-1] == 0.)) &&
+             ((i == n-1) || (x [i+1] == 0.)) && (spike (i) == 0.) ) continue ;
+        t = tanh (x [i] - spike (i)) ;
+        if ( i > 0 )   t += .5*(x [i] - x [i-1]) ;
+        if ( i < n-1 ) t += .5*(x [i] - x [i+1]) ;
+        if ( t != 0. )
+        {
+            g [i] = t ;
+            ind [nnz++] = i ;
+        }
+    }
+    return (nnz) ;
+}
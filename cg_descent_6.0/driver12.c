@@ -0,0 +1,168 @@
+/* Finite difference gradient. When grad and valgrad are both NULL,
+   cg_descent approximates the gradient by finite differences of value.
+   Parm.FDCentral selects central differences, Parm.FDThreads evaluates
+   the perturbed points in parallel (OpenMP), and when f is a sum of
+   elements that each depend on a few variables, Parm.FDElements with the
+   pattern FDnelt, FDptr, FDidx lets variables that share no element be
+   perturbed together. The test problem is the chained Rosenbrock
+   function with n = 200,
+
+       f = sum_{i < n-1} 100 (x_i+1 - x_i^2)^2 + (1 - x_i)^2,
+
+   whose elements (x_i, x_i+1) only need 2 groups, the even and the odd
+   variables. It is solved with the analytic gradient, then with forward
+   and central differences of value, and with forward and central
+   differences of the elements. With one thread:
+
+   gradient       iter nfunc ngrad  fd evals groups          f     time
+   analytic       1192  2379  1214         -      -  1.495e-14    0.005
+   forward        1219  2527  1331    267531    200  8.201e-11    0.109
+   central        1190  2387  1200    481195    200  4.867e-13    0.197
+   forward elt    1203  2467  1285      3855      2  8.207e-11    0.008
+   central elt    1205  2417  1215      6070      2  5.089e-13    0.009
+
+   A forward difference gradient costs n+1 values and a central one 2n
+   (one more when f is needed at the same point), against 3 and 4 or 5
+   evaluations of the elements with the groups. The iterations differ
+   from the analytic gradient since the differences are not exact; the
+   central differences reach a smaller f. The counts do not depend on the
+   number of threads. */
+
+#include <math.h>
+#include "cg_user.h"
+
+#define N 200
+
+double myvalue
+(
+    double   *x,
+    INT       n
+) ;
+
+void mygrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+) ;
+
+void myelements
+(
+    double    *F,
+    double    *x,
+    INT        n
+) ;
+
+int main (void)
+{
+    int k ;
+    INT i, *ptr, *idx ;
+    double *x ;
+    cg_parameter Parm ;
+    cg_stats Stats ;
+    char *name [5] = {"analytic", "forward", "central", "forward elt",
+                      "central elt"} ;
+
+    x = (double *) malloc (N*sizeof (double)) ;
+
+    /* element i has the variables i and i+1 */
+    ptr = (INT *) malloc (N*sizeof (INT)) ;
+    idx = (INT *) malloc (2*(N-1)*sizeof (INT)) ;
+    for (i = 0; i < N-1; i++)
+    {
+        ptr [i] = 2*i ;
+        idx [2*i] = i ;
+        idx [2*i+1] = i+1 ;
+    }
+    ptr [N-1] = 2*(N-1) ;
+
+    cg_default (&Parm) ;
+    Parm.PrintFinal = FALSE ;
+    Parm.Timing = TRUE ;
+    printf ("gradient       iter nfunc ngrad  fd evals groups          f"
+            "     time\n") ;
+    for (k = 0; k < 5; k++)
+    {
+        for (i = 0; i < N; i++) x [i] = (i % 2) ? 1. : -1.2 ;
+        Parm.FDCentral = (k == 2) || (k == 4) ;
+        if ( k >= 3 )
+        {
+            Parm.FDElements = myelements ;
+            Parm.FDnelt = N-1 ;
+            Parm.FDptr = ptr ;
+            Parm.FDidx = idx ;
+        }
+        cg_descent (x, N, &Stats, &Parm, 1.e-6, myvalue,
+                    (k == 0) ? mygrad : NULL, NULL, NULL) ;
+        if ( k == 0 )
+        {
+            printf ("%-11s %7ld %5ld %5ld         -      - %10.3e %8.3f\n",
+                    name [k], (long) Stats.iter, (long) Stats.nfunc,
+                    (long) Stats.ngrad, Stats.f, Stats.time.total) ;
+        }
+        else
+        {
+            printf ("%-11s %7ld %5ld %5ld %9ld %6ld %10.3e %8.3f\n",
+                    name [k], (long) Stats.iter, (long) Stats.nfunc,
+                    (long) Stats.ngrad, (long) Stats.nfdeval,
+                    (long) Stats.nfdgroup, Stats.f, Stats.time.total) ;
+        }
+    }
+    free (x) ;
+    free (ptr) ;
+    free (idx) ;
+    return (0) ;
+}
+
+void myelements
+(
+    double    *F,
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    double s, t ;
+    for (i = 0; i < n-1; i++)
+    {
+        s = x [i+1] - x [i]*x [i] ;
+        t = 1. - x [i] ;
+        F [i] = 100.*s*s + t*t ;
+    }
+}
+
+double myvalue
+(
+    double   *x,
+    INT       n
+)
+{
+    INT i ;
+    double f, s, t ;
+    f = 0. ;
+    for (i = 0; i < n-1; i++)
+    {
+        s = x [i+1] - x [i]*x [i] ;
+        t = 1. - x [i] ;
+        f += 100.*s*s + t*t ;
+    }
+    return (f) ;
+}
+
+void mygrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    double s ;
+    for (i = 0; i < n; i++) g [i] = 0. ;
+    for (i = 0; i < n-1; i++)
+    {
+        s = x [i+1] - x [i]*x [i] ;
+        g [i] += -400.*s*x [i] - 2.*(1. - x [i]) ;
+        g [i+1] += 200.*s ;
+    }
+}
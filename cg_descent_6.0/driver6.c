@@ -0,0 +1,169 @@
+/* When the user can evaluate the product between the Hessian of the cost
+   and a vector (for example, with automatic differentiation), the routine
+   is passed to cg_descent through the hessvec element of the parameter
+   structure. At the start of each iteration, the code computes the
+   curvature d'Hd along the search direction d. The exact minimizer of the
+   quadratic model, -g'd/d'Hd, replaces the QuadStep interpolation as
+   the initial stepsize in the line search, so the function or gradient
+   evaluation needed to form the interpolant is avoided. The curvature is
+   also used to decide when the cost is nearly quadratic and to scale the
+   L-BFGS and subspace directions. For the test problem, the Hessian is
+   the diagonal matrix with entries exp (x_i). Below, we solve the problem
+   twice, first without the Hessian, then with it. Notice the reduction in
+   the number of function and gradient evaluations.
+
+   Termination status: 0
+   Convergence tolerance for gradient satisfied
+
+   maximum norm for gradient:  5.562050e-09
+   function value:            -6.530787e+02
+
+   iterations:                      30
+   function evaluations:            51
+   gradient evaluations:            43
+   ===================================
+
+   Termination status: 0
+   Convergence tolerance for gradient satisfied
+
+   maximum norm for gradient:  6.404416e-09
+   function value:            -6.530787e+02
+
+   iterations:                      28
+   function evaluations:            31
+   gradient evaluations:            31
+   Hessian-vector products:         28
+   =================================== */
+
+#include <math.h>
+#include "cg_user.h"
+
+double myvalue
+(
+    double   *x,
+    INT       n
+) ;
+
+void mygrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+) ;
+
+double myvalgrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+) ;
+
+void myhessvec
+(
+    double   *Hd,
+    double    *d,
+    double    *x,
+    INT        n
+) ;
+
+int main (void)
+{
+    double *x ;
+    INT i, n ;
+    cg_parameter Parm ;
+
+    /* allocate space for solution */
+    n = 100 ;
+    x = (double *) malloc (n*sizeof (double)) ;
+
+    /* set starting guess */
+    for (i = 0; i < n; i++) x [i] = 1. ;
+
+    cg_default (&Parm) ;    /* set default parameter values */
+    Parm.PrintFinal = TRUE ;
+
+    /* run the code without the Hessian */
+    cg_descent(x, n, NULL, &Parm, 1.e-8, myvalue, mygrad, myvalgrad, NULL) ;
+
+    /* set starting guess */
+    for (i = 0; i < n; i++) x [i] = 1. ;
+    Parm.hessvec = myhessvec ; /* provide the Hessian-vector product */
+
+    /* run the code */
+    cg_descent(x, n, NULL, &Parm, 1.e-8, myvalue, mygrad, myvalgrad, NULL) ;
+
+    free (x) ; /* free workspace */
+}
+
+double myvalue
+(
+    double   *x,
+    INT       n
+)
+{
+    double f, t ;
+    INT i ;
+    f = 0. ;
+    for (i = 0; i < n; i++)
+    {
+        t = i+1 ;
+        t = sqrt (t) ;
+        f += exp (x [i]) - t*x [i] ;
+    }
+    return (f) ;
+}
+
+void mygrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    double t ;
+    INT i ;
+    for (i = 0; i < n; i++)
+    {
+        t = i + 1 ;
+        t = sqrt (t) ;
+        g [i] = exp (x [i]) -  t ;
+    }
+    return ;
+}
+
+double myvalgrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    double ex, f, t ;
+    INT i ;
+    f = (double) 0 ;
+    for (i = 0; i < n; i++)
+    {
+        t = i + 1 ;
+        t = sqrt (t) ;
+        ex = exp (x [i]) ;
+        f += ex - t*x [i] ;
+        g [i] = ex -  t ;
+    }
+    return (f) ;
+}
+
+void myhessvec
+(
+    double   *Hd,
+    double    *d,
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    for (i = 0; i < n; i++)
+    {
+        Hd [i] = exp (x [i])*d [i] ;
+    }
+    return ;
+}
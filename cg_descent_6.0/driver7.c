@@ -0,0 +1,156 @@
+/* The test problem has 2^n local minimizers, each component x_i is near -1
+   or near +1 and the components near -1 give the smaller cost. cg_multistart
+   (in cg_parallel.c) runs cg_descent from nstart random starting guesses.
+   When compiled with OpenMP, the starts are run in parallel. The best
+   function value found so far is shared by all the starts. After
+   AbandonIter iterations, a start is abandoned (status 13) when its cost,
+   reduced by AbandonFac times the predicted decrease in the next iteration,
+   is still larger than the best cost. Since the starts are distributed over
+   the threads dynamically, the output may vary a little with the number of
+   threads. With one thread:
+
+   start status iter nfunc ngrad        f
+       0      0   16    32    18   8.404944e-01
+       1      0   17    34    19   8.404944e-01
+       2      0   13    27    14  -3.151526e+00
+       3     13   11    25    14  -1.566669e-01
+       4     13   10    23    14  -1.572304e-01
+       5      0   20    42    26  -3.151526e+00
+       6     13   10    23    14   8.405516e-01
+       7     13   10    26    18   1.231695e+00
+       8     13   10    21    11  -1.575107e-01
+       9     13   10    21    11   2.836505e+00
+      10     13   10    21    11  -1.575101e-01
+      11     13   10    21    11  -2.153521e+00
+      12     13   10    21    11  -1.575101e-01
+      13     13   10    21    11  -1.155516e+00
+      14     13   10    23    14  -1.568424e-01
+      15     13   10    22    12  -2.153504e+00
+      16     13   10    22    12  -1.575107e-01
+      17     13   10    21    11  -1.575107e-01
+      18     13   10    23    15   6.218546e-01
+      19     13   10    21    11   3.834510e+00
+
+   best start: 2 f: -3.151526e+00
+   abandoned starts: 16 function evaluations: 490 gradient evaluations: 278
+
+   Without abandoning starts (AbandonIter = -1), the same best start is
+   found with 675 function and 397 gradient evaluations. */
+
+#include <math.h>
+#include "cg_user.h"
+
+double myvalue
+(
+    double   *x,
+    INT       n
+) ;
+
+void mygrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+) ;
+
+double myvalgrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+) ;
+
+int main (void)
+{
+    double *x ;
+    INT i, n, nf, ng ;
+    int k, best, nabandon, nstart, *status ;
+    cg_stats *Stats ;
+    cg_parameter Parm ;
+
+    /* allocate space for the starting guesses */
+    n = 10 ;
+    nstart = 20 ;
+    x = (double *) malloc (nstart*n*sizeof (double)) ;
+    status = (int *) malloc (nstart*sizeof (int)) ;
+    Stats = (cg_stats *) malloc (nstart*sizeof (cg_stats)) ;
+
+    /* random starting guesses in [-2, 2] */
+    srand (1) ;
+    for (i = 0; i < nstart*n; i++) x [i] = 4.*rand ()/RAND_MAX - 2. ;
+
+    cg_default (&Parm) ;
+    best = cg_multistart (x, n, nstart, status, Stats, &Parm, 1.e-8,
+                          myvalue, mygrad, myvalgrad) ;
+
+    printf ("start status iter nfunc ngrad        f\n") ;
+    nabandon = 0 ;
+    nf = ng = 0 ;
+    for (k = 0; k < nstart; k++)
+    {
+        printf ("%5i %6i %4ld %5ld %5ld %14.6e\n", k, status [k],
+                Stats [k].iter, Stats [k].nfunc, Stats [k].ngrad, Stats [k].f);
+        if ( status [k] == 13 ) nabandon++ ;
+        nf += Stats [k].nfunc ;
+        ng += Stats [k].ngrad ;
+    }
+    printf ("\nbest start: %i f: %e\n", best, Stats [best].f) ;
+    printf ("abandoned starts: %i function evaluations: %ld gradient "
+            "evaluations: %ld\n", nabandon, nf, ng) ;
+
+    free (x) ;
+    free (status) ;
+    free (Stats) ;
+    return (0) ;
+}
+
+double myvalue
+(
+    double   *x,
+    INT       n
+)
+{
+    double f, t ;
+    INT i ;
+    f = 0. ;
+    for (i = 0; i < n; i++)
+    {
+        t = x [i]*x [i] - 1. ;
+        f += t*t + .5*x [i] ;
+    }
+    return (f) ;
+}
+
+void mygrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    INT i ;
+    for (i = 0; i < n; i++)
+    {
+        g [i] = 4.*x [i]*(x [i]*x [i] - 1.) + .5 ;
+    }
+    return ;
+}
+
+double myvalgrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    double f, t ;
+    INT i ;
+    f = 0. ;
+    for (i = 0; i < n; i++)
+    {
+        t = x [i]*x [i] - 1. ;
+        f += t*t + .5*x [i] ;
+        g [i] = 4.*x [i]*t + .5 ;
+    }
+    return (f) ;
+}
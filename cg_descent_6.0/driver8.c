@@ -0,0 +1,131 @@
+/* cg_portfolio (in cg_parallel.c) runs several parameter configurations
+   of cg_descent on the same problem at the same time. With Parms = NULL,
+   the configurations are memory = 0 (the original CG_DESCENT), memory = 11
+   (limited memory CG), and L-BFGS with memory = 11. The first configuration
+   that converges wins, the others are cancelled (status 13). When a file
+   name is given on the command line, a line describing the race is
+   appended to it. The test problem is an ill-conditioned quadratic with a
+   small quartic term. The three configurations need a similar number of
+   iterations, but an L-BFGS or limited memory iteration costs more than an
+   iteration of memory = 0, so the winner is decided by the time per
+   iteration. Compiled with OpenMP, a run gave:
+
+   config status  iter nfunc ngrad        f
+        0      0  1187  1415  2148   4.835874e-18
+        1     13  1135  1363  2044   3.331931e-17
+        2     13  1010  1232  1800   5.358007e-15
+
+   winner: 0 (memory: 0 LBFGS: 0)
+
+   The iterations of the cancelled configurations depend on the timing of
+   the threads. Without OpenMP, the configurations are run one after the
+   other, memory = 0 wins and the other two are cancelled after their
+   first iteration. */
+
+#include <math.h>
+#include "cg_user.h"
+
+double myvalue
+(
+    double   *x,
+    INT       n
+) ;
+
+void mygrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+) ;
+
+double myvalgrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+) ;
+
+int main (int argc, char **argv)
+{
+    double *x ;
+    INT i, n ;
+    int k, winner, status [3] ;
+    cg_stats Stats [3] ;
+    char *LogFile ;
+
+    /* allocate space for solution */
+    n = 1000 ;
+    x = (double *) malloc (n*sizeof (double)) ;
+
+    /* set starting guess */
+    for (i = 0; i < n; i++) x [i] = 1. ;
+
+    LogFile = NULL ;
+    if ( argc > 1 ) LogFile = argv [1] ;
+    winner = cg_portfolio (x, n, 3, NULL, status, Stats, 1.e-8,
+                           myvalue, mygrad, myvalgrad, LogFile) ;
+
+    printf ("config status  iter nfunc ngrad        f\n") ;
+    for (k = 0; k < 3; k++)
+    {
+        printf ("%6i %6i %5ld %5ld %5ld %14.6e\n", k, status [k],
+                Stats [k].iter, Stats [k].nfunc, Stats [k].ngrad, Stats [k].f);
+    }
+    if ( winner >= 0 )
+    {
+        printf ("\nwinner: %i (memory: %i LBFGS: %i)\n", winner,
+                (winner == 0) ? 0 : 11, winner == 2) ;
+    }
+    else printf ("\nno configuration converged\n") ;
+
+    free (x) ;
+    return (0) ;
+}
+
+double myvalue
+(
+    double   *x,
+    INT       n
+)
+{
+    double c, f ;
+    INT i ;
+    f = 0. ;
+    for (i = 0; i < n; i++)
+    {
+        c = pow (10., 4.*i/(n-1)) ;
+        f += .5*c*x [i]*x [i] + .01*pow (x [i], 4) ;
+        if ( i > 0 ) f += .1*x [i]*x [i-1] ;
+    }
+    return (f) ;
+}
+
+void mygrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    double c ;
+    INT i ;
+    for (i = 0; i < n; i++)
+    {
+        c = pow (10., 4.*i/(n-1)) ;
+        g [i] = c*x [i] + .04*pow (x [i], 3) ;
+        if ( i > 0 )     g [i] += .1*x [i-1] ;
+        if ( i < n - 1 ) g [i] += .1*x [i+1] ;
+    }
+    return ;
+}
+
+double myvalgrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    mygrad (g, x, n) ;
+    return (myvalue (x, n)) ;
+}
@@ -0,0 +1,183 @@
+/* Truncated Newton mode. When Hessian-vector products cost about as much
+   as a gradient, setting Parm.Newton = TRUE replaces the nonlinear CG
+   direction by an approximate Newton direction: linear CG on the products
+   H*p solves H d = -g until the relative residual is below
+   min (NewtonEta, sqrt (||g||)). The usual line search, starting from the
+   Newton step alpha = 1, globalizes the method. The test problem is the
+   discretization of -u'' + exp (u) = 10 on (0, 1) with zero boundary
+   values,
+
+       f = sum (u_i+1 - u_i)^2/(2h) + h sum (exp (u_i) - 10 u_i),
+
+   with n = 1000 and h = 1/(n+1); the condition number of the Hessian
+   grows like n^2. Below, we solve the problem twice, first with the
+   default CG_DESCENT, then in the truncated Newton mode. The Newton mode
+   needs two orders of magnitude fewer outer iterations and gradient
+   evaluations; the work moves to the Hessian-vector products, one per
+   inner CG iteration.
+
+   Termination status: 0
+   Convergence tolerance for gradient satisfied
+
+   maximum norm for gradient:  9.327603e-09
+   function value:            -1.974539e+00
+
+   iterations:                    2058
+   function evaluations:          2600
+   gradient evaluations:          3810
+   ===================================
+
+   Termination status: 0
+   Convergence tolerance for gradient satisfied
+
+   maximum norm for gradient:  2.374620e-13
+   function value:            -1.974539e+00
+
+   iterations:                       7
+   function evaluations:             9
+   gradient evaluations:            10
+   Hessian-vector products:       2103
+   inner CG iterations:           2103
+   =================================== */
+
+#include <math.h>
+#include "cg_user.h"
+
+double myvalue
+(
+    double   *x,
+    INT       n
+) ;
+
+void mygrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+) ;
+
+double myvalgrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+) ;
+
+void myhessvec
+(
+    double   *Hd,
+    double    *d,
+    double    *x,
+    INT        n
+) ;
+
+int main (void)
+{
+    double *x ;
+    INT i, n ;
+    cg_parameter Parm ;
+
+    /* allocate space for solution */
+    n = 1000 ;
+    x = (double *) malloc (n*sizeof (double)) ;
+
+    /* set starting guess */
+    for (i = 0; i < n; i++) x [i] = 0. ;
+
+    cg_default (&Parm) ;    /* set default parameter values */
+    Parm.PrintFinal = TRUE ;
+
+    /* run the code without the Hessian */
+    cg_descent(x, n, NULL, &Parm, 1.e-8, myvalue, mygrad, myvalgrad, NULL) ;
+
+    /* set starting guess */
+    for (i = 0; i < n; i++) x [i] = 0. ;
+    Parm.hessvec = myhessvec ; /* provide the Hessian-vector product */
+    Parm.Newton = TRUE ;       /* truncated Newton mode */
+
+    /* run the code */
+    cg_descent(x, n, NULL, &Parm, 1.e-8, myvalue, mygrad, myvalgrad, NULL) ;
+
+    free (x) ; /* free workspace */
+}
+
+double myvalue
+(
+    double   *x,
+    INT       n
+)
+{
+    double f, h, t ;
+    INT i ;
+    h = 1./(n+1) ;
+    f = .5*(x [0]*x [0] + x [n-1]*x [n-1])/h ;
+    for (i = 0; i < n; i++)
+    {
+        if ( i < n-1 )
+        {
+            t = x [i+1] - x [i] ;
+            f += .5*t*t/h ;
+        }
+        f += h*(exp (x [i]) - 10.*x [i]) ;
+    }
+    return (f) ;
+}
+
+void mygrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    myvalgrad (g, x, n) ;
+    return ;
+}
+
+double myvalgrad
+(
+    double    *g,
+    double    *x,
+    INT        n
+)
+{
+    double ex, f, h, l, r, t ;
+    INT i ;
+    h = 1./(n+1) ;
+    f = .5*(x [0]*x [0] + x [n-1]*x [n-1])/h ;
+    for (i = 0; i < n; i++)
+    {
+        l = (i > 0) ? x [i-1] : 0. ;
+        r = (i < n-1) ? x [i+1] : 0. ;
+        if ( i < n-1 )
+        {
+            t = r - x [i] ;
+            f += .5*t*t/h ;
+        }
+        ex = exp (x [i]) ;
+        f += h*(ex - 10.*x [i]) ;
+        g [i] = (2.*x [i] - l - r)/h + h*(ex - 10.) ;
+    }
+    return (f) ;
+}
+
+/* H = tridiag (-1, 2, -1)/h + h diag (exp (x)) */
+void myhessvec
+(
+    double   *Hd,
+    double    *d,
+    double    *x,
+    INT        n
+)
+{
+    double h, l, r ;
+    INT i ;
+    h = 1./(n+1) ;
+    for (i = 0; i < n; i++)
+    {
+        l = (i > 0) ? d [i-1] : 0. ;
+        r = (i < n-1) ? d [i+1] : 0. ;
+        Hd [i] = (2.*d [i] - l - r)/h + h*exp (x [i])*d [i] ;
+    }
+    return ;
+}
@@ -0,0 +1,29 @@
+/* Convert a trace written by cg_descent (parameter TraceFile) to JSON
+   lines, one object per iteration or line search trial:
+
+   trace2json trace.bin            (print to the screen)
+   trace2json trace.bin trace.json (write to a file)
+
+   For example, the trace of driver1.c with Parm.TraceFile = "trace.bin"
+   starts with
+
+   {"type":"iter","iter":0,"nfunc":1,"ngrad":1,"alpha":0,"f":...}
+   {"type":"trial","iter":1,"nfunc":2,"ngrad":1,"phase":"start",...} */
+
+#include "cg_user.h"
+
+int main (int argc, char **argv)
+{
+    int status ;
+    if ( argc < 2 )
+    {
+        printf ("usage: %s TraceFile [JsonFile]\n", argv [0]) ;
+        return (1) ;
+    }
+    status = cg_trace_json (argv [1], (argc > 2) ? argv [2] : NULL) ;
+    if      ( status == 1 ) printf ("cannot open %s\n", argv [1]) ;
+    else if ( status == 2 ) printf ("%s is not a cg_descent trace\n", argv[1]);
+    else if ( status == 3 ) printf ("cannot open %s\n", argv [2]) ;
+    else if ( status == 4 ) printf ("%s is corrupt or truncated\n", argv[1]);
+    return (status) ;
+}